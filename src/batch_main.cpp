@@ -0,0 +1,388 @@
+// Headless batch renderer: traces every scene file in a directory on the CPU
+// and writes an image per scene plus a CSV summary. No window or GL context.
+//
+// Usage: RayTracerNG_Batch <scene-dir> [--out <dir>] [--threads <n>] [--no-images] [--write-binary]
+//
+// Binary scene files (*.rtscene, see scene_binary.hpp) are memory-mapped and
+// traced in place. JSON and CSV scenes (*.json, *.csv, see scene_text.hpp)
+// are streamed in. --write-binary saves each resolved parameter scene as
+// <name>.rtscene in the output directory.
+//
+// Scene files (*.scene) are key = value lines; '#' starts a comment.
+//   width = 1280            height = 720
+//   light = -500 0          main = 0 0
+//   rays = 720              reflections = 1
+//   obstacles = 25          seed = 7        (random layout, as in the app)
+//   obstacle = 120 -40 30   (explicit obstacle: x y [radius]; repeatable,
+//                            replaces the random layout when present)
+//   wall = -300 200 -300 50 (wall segment: x0 y0 x1 y1; repeatable)
+//   room = 1                (adds the app's room walls for width x height)
+//   glass = 1.5             (index of refraction of every obstacle; 0 for mirrors)
+//   dispersion = 0.02       (Cauchy B of the glass in um^2; traces wavelength bins)
+#include "scene_layout.hpp"
+#include "tracer.hpp"
+#include "software_raster.hpp"
+#include "scene_binary.hpp"
+#include "scene_text.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Matches LightSource::RAY_INTENSITY
+constexpr float RAY_INTENSITY = 0.9f;
+
+struct BatchOptions {
+    fs::path sceneDir;
+    fs::path outDir{"batch_out"};
+    unsigned int threads{0};  // 0 = hardware concurrency
+    bool writeImages{true};
+    bool writeBinary{false};
+};
+
+struct BatchJob {
+    SceneDescription scene;
+    int randomObstacles{0};
+    unsigned int seed{1};
+    bool roomWalls{false};
+    float glassIor{ObstacleStore::OPAQUE};
+    float dispersion{0.0f};
+};
+
+struct BatchResult {
+    std::string name;
+    bool ok{false};
+    std::string error;
+    size_t obstacles{0};
+    int rays{0};
+    size_t segments{0};
+    size_t mainHits{0};
+    size_t obstacleHits{0};
+    size_t wallHits{0};
+    size_t misses{0};
+    uint64_t intersectionTests{0};
+    double traceMs{0.0};
+    double totalMs{0.0};
+};
+
+void printUsage() {
+    std::cerr << "Usage: RayTracerNG_Batch <scene-dir> [--out <dir>] [--threads <n>] [--no-images] [--write-binary]" << std::endl;
+}
+
+BatchOptions parseArguments(int argc, char** argv) {
+    BatchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            options.outDir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "--no-images") {
+            options.writeImages = false;
+        } else if (arg == "--write-binary") {
+            options.writeBinary = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.sceneDir.empty()) {
+            options.sceneDir = arg;
+        } else {
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    if (options.sceneDir.empty()) {
+        throw std::runtime_error("No scene directory given");
+    }
+    return options;
+}
+
+BatchJob loadSceneFile(const fs::path& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file: " + path.string());
+    }
+
+    BatchJob job;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": expected key = value");
+            }
+            continue;
+        }
+
+        std::string key;
+        std::istringstream(line.substr(0, equals)) >> key;
+        std::istringstream value(line.substr(equals + 1));
+
+        bool parsed = true;
+        if (key == "width") {
+            parsed = static_cast<bool>(value >> job.scene.width);
+        } else if (key == "height") {
+            parsed = static_cast<bool>(value >> job.scene.height);
+        } else if (key == "light") {
+            parsed = static_cast<bool>(value >> job.scene.lightPosition.x >> job.scene.lightPosition.y);
+        } else if (key == "main") {
+            parsed = static_cast<bool>(value >> job.scene.mainPosition.x >> job.scene.mainPosition.y);
+        } else if (key == "rays") {
+            parsed = static_cast<bool>(value >> job.scene.rayCount) && job.scene.rayCount > 0;
+        } else if (key == "reflections") {
+            int enabled = 0;
+            parsed = static_cast<bool>(value >> enabled);
+            job.scene.reflections = enabled != 0;
+        } else if (key == "obstacles") {
+            parsed = static_cast<bool>(value >> job.randomObstacles) && job.randomObstacles >= 0;
+        } else if (key == "seed") {
+            parsed = static_cast<bool>(value >> job.seed);
+        } else if (key == "obstacle") {
+            glm::vec2 position;
+            float radius = SceneLayout::OBSTACLE_RADIUS;
+            parsed = static_cast<bool>(value >> position.x >> position.y);
+            value >> radius;
+            job.scene.obstacles.add(position, radius, glm::vec3(0.5f));
+        } else if (key == "wall") {
+            glm::vec2 from;
+            glm::vec2 to;
+            parsed = static_cast<bool>(value >> from.x >> from.y >> to.x >> to.y);
+            job.scene.walls.addSegment(from, to);
+        } else if (key == "room") {
+            int enabled = 0;
+            parsed = static_cast<bool>(value >> enabled);
+            job.roomWalls = enabled != 0;
+        } else if (key == "glass") {
+            parsed = static_cast<bool>(value >> job.glassIor) && job.glassIor >= 0.0f;
+        } else if (key == "dispersion") {
+            parsed = static_cast<bool>(value >> job.dispersion) && job.dispersion >= 0.0f;
+        } else {
+            throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": unknown key '" + key + "'");
+        }
+
+        if (!parsed) {
+            throw std::runtime_error(path.string() + ":" + std::to_string(lineNumber) + ": invalid value for '" + key + "'");
+        }
+    }
+    return job;
+}
+
+// Light, main object and settings come from scene; obstacles are passed
+// separately so mapped files can be drawn without copying them
+void renderImage(const SceneDescription& scene, const CircleView& obstacles, const glm::vec3* obstacleColors,
+                 const std::vector<TraceSegment>& segments, const fs::path& path) {
+    RasterImage image(static_cast<int>(scene.width), static_cast<int>(scene.height));
+
+    // Same draw order as Scene::render: light, rays, walls, obstacles, main object
+    image.fillCircle(scene.lightPosition, scene.lightRadius, scene.lightColor);
+    for (const auto& segment : segments) {
+        image.drawLine(segment.origin, segment.end, segment.color, segment.color * segment.attenuation, segment.depth > 0);
+    }
+    scene.walls.forEachOutlineLine(0.1f, [&](const glm::vec2& from, const glm::vec2& to) {
+        image.drawLine(from, to, glm::vec3(0.75f, 0.8f, 0.9f));
+    });
+    for (size_t i = 0; i < obstacles.count; ++i) {
+        image.fillCircle(glm::vec2(obstacles.x[i], obstacles.y[i]), obstacles.radius[i], obstacleColors[i]);
+    }
+    image.fillCircle(scene.mainPosition, scene.mainRadius, scene.mainColor);
+
+    image.writePPM(path.string());
+}
+
+BatchResult runScene(const fs::path& path, const BatchOptions& options) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    BatchResult result;
+    result.name = path.stem().string();
+
+    // Parameter scenes are resolved into a description; binary scenes are
+    // mapped and their obstacle arrays referenced directly
+    SceneDescription scene;
+    std::unique_ptr<MappedScene> mapped;
+    CircleView obstacles;
+    const glm::vec3* obstacleColors = nullptr;
+    const float* obstacleIors = nullptr;
+    if (path.extension() == ".rtscene") {
+        mapped = std::make_unique<MappedScene>(path.string());
+        scene = mapped->toDescription(false);
+        obstacles = mapped->obstacles();
+        obstacleColors = mapped->obstacleColors();
+        obstacleIors = mapped->obstacleIors();
+    } else if (SceneText::isTextScenePath(path.string())) {
+        scene = SceneText::load(path.string());
+        obstacles = scene.obstacles.view();
+        obstacleColors = scene.obstacles.colors();
+        obstacleIors = scene.obstacles.iors();
+    } else {
+        BatchJob job = loadSceneFile(path);
+        scene = std::move(job.scene);
+        if (job.roomWalls) {
+            SceneLayout::addRoomWalls(scene.walls, scene.width, scene.height);
+        }
+        if (scene.obstacles.empty() && job.randomObstacles > 0) {
+            int placed = SceneLayout::generateObstacles(scene, job.randomObstacles, job.seed);
+            if (placed < job.randomObstacles) {
+                std::cerr << path.string() << ": only " << placed << " of " << job.randomObstacles
+                          << " obstacles fit" << std::endl;
+            }
+        }
+        if (job.glassIor > 0.0f) {
+            for (size_t i = 0; i < scene.obstacles.size(); ++i) {
+                scene.obstacles.setIor(i, job.glassIor);
+            }
+        }
+        scene.dispersion = job.dispersion;
+        if (options.writeBinary) {
+            SceneBinary::write((options.outDir / (result.name + ".rtscene")).string(), scene);
+        }
+        obstacles = scene.obstacles.view();
+        obstacleColors = scene.obstacles.colors();
+        obstacleIors = scene.obstacles.iors();
+    }
+
+    TraceScene traceScene;
+    traceScene.lightOrigin = scene.lightPosition;
+    traceScene.mainPosition = scene.mainPosition;
+    traceScene.mainRadius = scene.mainRadius;
+    traceScene.obstacles = obstacles;
+    traceScene.obstacleIor = obstacleIors;
+    traceScene.obstacleColors = obstacleColors;
+    traceScene.occluders = scene.walls.view();
+    traceScene.mainReflectance = Tracer::reflectance(scene.mainColor);
+
+    TraceSettings settings;
+    settings.rayCount = scene.rayCount;
+    settings.reflections = scene.reflections;
+    settings.primaryColor = scene.lightColor * RAY_INTENSITY;
+    settings.dispersion = scene.dispersion;
+
+    std::vector<TraceSegment> segments;
+    Tracer tracer(TraceKernel::Simd);  // One scene per thread, so no threads within the trace
+    auto traceStart = Clock::now();
+    tracer.trace(traceScene, settings, segments);
+    auto traceEnd = Clock::now();
+
+    result.obstacles = obstacles.count;
+    result.rays = scene.rayCount;
+    result.segments = segments.size();
+    result.intersectionTests = tracer.getLastStats().intersectionTests;
+    for (const auto& segment : segments) {
+        std::size_t index;
+        switch (Tracer::classifyHit(traceScene, segment.hitId, index)) {
+            case TraceHitKind::None: ++result.misses; break;
+            case TraceHitKind::MainObject: ++result.mainHits; break;
+            case TraceHitKind::Obstacle: ++result.obstacleHits; break;
+            default: ++result.wallHits; break;
+        }
+    }
+
+    if (options.writeImages) {
+        renderImage(scene, obstacles, obstacleColors, segments, options.outDir / (result.name + ".ppm"));
+    }
+
+    result.ok = true;
+    result.traceMs = std::chrono::duration<double, std::milli>(traceEnd - traceStart).count();
+    result.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+void writeSummary(const std::vector<BatchResult>& results, const fs::path& path) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open summary for writing: " + path.string());
+    }
+    file << "scene,status,obstacles,rays,segments,main_hits,obstacle_hits,wall_hits,misses,intersection_tests,trace_ms,total_ms\n";
+    for (const auto& r : results) {
+        file << r.name << "," << (r.ok ? "ok" : "error") << ","
+             << r.obstacles << "," << r.rays << "," << r.segments << ","
+             << r.mainHits << "," << r.obstacleHits << "," << r.wallHits << "," << r.misses << "," << r.intersectionTests << ","
+             << r.traceMs << "," << r.totalMs << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        BatchOptions options;
+        try {
+            options = parseArguments(argc, argv);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            printUsage();
+            return 2;
+        }
+
+        std::vector<fs::path> scenes;
+        for (const auto& entry : fs::directory_iterator(options.sceneDir)) {
+            const fs::path extension = entry.path().extension();
+            if (entry.is_regular_file() && (extension == ".scene" || extension == ".rtscene" ||
+                                            SceneText::isTextScenePath(entry.path().string()))) {
+                scenes.push_back(entry.path());
+            }
+        }
+        std::sort(scenes.begin(), scenes.end());
+        if (scenes.empty()) {
+            std::cerr << "No scene files found in " << options.sceneDir.string() << std::endl;
+            return 1;
+        }
+        fs::create_directories(options.outDir);
+
+        unsigned int threadCount = options.threads ? options.threads : std::thread::hardware_concurrency();
+        threadCount = std::max(1u, std::min<unsigned int>(threadCount, static_cast<unsigned int>(scenes.size())));
+
+        // Workers pull scene indices until the list is exhausted; results are
+        // stored by index so the summary order does not depend on scheduling.
+        std::vector<BatchResult> results(scenes.size());
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t i = next++; i < scenes.size(); i = next++) {
+                try {
+                    results[i] = runScene(scenes[i], options);
+                }
+                catch (const std::exception& e) {
+                    results[i].name = scenes[i].stem().string();
+                    results[i].error = e.what();
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threadCount; ++t) {
+            workers.emplace_back(worker);
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+
+        int failures = 0;
+        for (const auto& r : results) {
+            if (!r.ok) {
+                std::cerr << r.name << ": " << r.error << std::endl;
+                ++failures;
+            }
+        }
+        writeSummary(results, options.outDir / "summary.csv");
+
+        std::cout << "Processed " << results.size() << " scenes on " << threadCount << " threads ("
+                  << failures << " failed), output in " << options.outDir.string() << std::endl;
+        return failures == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,525 @@
+// Microbenchmarks for the tracing and placement kernels.
+//
+// Usage: RayTracerNG_Bench [--filter <substring>] [--rays <n,n,...>] [--obstacles <n,n,...>]
+//                          [--min-time <seconds>] [--max-work <n>] [--json] [--out <file>]
+//
+// Every benchmark runs over the ray count x obstacle count grid (benchmarks
+// that do not depend on one of the two only use the other). Combinations
+// whose work per iteration (ray-circle tests) exceeds --max-work are skipped.
+// The trace_walls benchmarks split the obstacle count between circles and
+// walls (segments and arcs).
+// Each case repeats until --min-time has elapsed (at least 3 iterations) and
+// reports the minimum and median iteration time as CSV (default) or JSON.
+#include "ray.hpp"
+#include "tracer.hpp"
+#include "scene_layout.hpp"
+#include "free_space.hpp"
+#include "spatial_hash.hpp"
+#include "obstacle_motion.hpp"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+struct BenchOptions {
+    std::string filter;
+    std::vector<long long> rayCounts{90, 1000, 10000, 100000, 1000000};
+    std::vector<long long> obstacleCounts{10, 100, 1000, 10000, 100000, 1000000};
+    double minTime{0.25};
+    double maxWork{2e9};
+    bool json{false};
+    std::string outPath;
+};
+
+struct BenchResult {
+    std::string name;
+    long long rays;       // -1 when the benchmark does not use rays
+    long long obstacles;  // -1 when the benchmark does not use obstacles
+    long long iterations;
+    double minNs;
+    double medianNs;
+    double itemsPerIteration;  // Unit of work the throughput is quoted in
+    std::string itemName;
+    double extra;              // Benchmark-specific counter (segments, placed obstacles, ...)
+    std::string extraName;
+};
+
+// Keeps results alive so the optimizer cannot drop the measured work
+volatile double g_sink = 0.0;
+
+// Obstacles spread uniformly around the light at a density similar to the app
+ObstacleStore makeObstacles(long long count, unsigned int seed) {
+    float side = std::max(1000.0f, std::sqrt(static_cast<float>(count)) * 120.0f);
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> position(-side / 2.0f, side / 2.0f);
+    ObstacleStore obstacles;
+    obstacles.reserve(static_cast<size_t>(count));
+    for (long long i = 0; i < count; ++i) {
+        obstacles.add(glm::vec2(position(gen), position(gen)), SceneLayout::OBSTACLE_RADIUS, glm::vec3(0.5f));
+    }
+    return obstacles;
+}
+
+// Short walls at the same density, every fourth one a half circle, inside a
+// square room so every ray ends on a wall
+OccluderStore makeWalls(long long count, unsigned int seed) {
+    float side = std::max(1000.0f, std::sqrt(static_cast<float>(count)) * 120.0f);
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> position(-side / 2.0f, side / 2.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    OccluderStore walls;
+    float half = side / 2.0f + 50.0f;
+    walls.addPolygon({glm::vec2(-half, -half), glm::vec2(half, -half), glm::vec2(half, half), glm::vec2(-half, half)});
+    for (long long i = 0; i < count; ++i) {
+        glm::vec2 center(position(gen), position(gen));
+        float start = angle(gen);
+        if (i % 4 == 3) {
+            walls.addArc(center, SceneLayout::OBSTACLE_RADIUS, start, start + 3.14159265f);
+        } else {
+            glm::vec2 offset = SceneLayout::OBSTACLE_RADIUS * glm::vec2(std::cos(start), std::sin(start));
+            walls.addSegment(center - offset, center + offset);
+        }
+    }
+    return walls;
+}
+
+TraceScene makeTraceScene(const ObstacleStore& obstacles) {
+    TraceScene scene;
+    scene.lightOrigin = glm::vec2(0.0f);
+    scene.mainPosition = glm::vec2(200.0f, 50.0f);
+    scene.mainRadius = 25.0f;
+    scene.obstacles = obstacles.view();
+    scene.obstacleColors = obstacles.colors();
+    return scene;
+}
+
+// Runs body until minTime has elapsed and returns per-iteration times in ns
+std::vector<double> measure(const std::function<void()>& body, double minTime) {
+    using Clock = std::chrono::steady_clock;
+    body();  // Warm-up
+
+    std::vector<double> samples;
+    auto start = Clock::now();
+    while (samples.size() < 3 || std::chrono::duration<double>(Clock::now() - start).count() < minTime) {
+        auto begin = Clock::now();
+        body();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - begin).count());
+    }
+    return samples;
+}
+
+BenchResult summarize(const std::string& name, long long rays, long long obstacles, std::vector<double> samples,
+                      double items, const std::string& itemName, double extra = 0.0, const std::string& extraName = "") {
+    std::sort(samples.begin(), samples.end());
+    return BenchResult{name, rays, obstacles, static_cast<long long>(samples.size()),
+                       samples.front(), samples[samples.size() / 2], items, itemName, extra, extraName};
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+
+BenchResult benchIntersect(long long rays, long long obstacleCount, double minTime) {
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    CircleView view = obstacles.view();
+
+    std::vector<Ray> rayList(static_cast<size_t>(rays));
+    for (long long i = 0; i < rays; ++i) {
+        Ray& ray = rayList[static_cast<size_t>(i)];
+        ray.origin = glm::vec2(0.0f);
+        ray.direction = Tracer::primaryDirection(static_cast<int>(i), static_cast<int>(rays));
+        ray.length = 2000.0f;
+    }
+
+    long long hits = 0;
+    auto samples = measure([&]() {
+        long long count = 0;
+        float dist = 0.0f;
+        for (const Ray& ray : rayList) {
+            for (size_t j = 0; j < view.count; ++j) {
+                count += ray.intersectsCircle(glm::vec2(view.x[j], view.y[j]), view.radius[j], dist);
+            }
+        }
+        hits = count;
+        g_sink = g_sink + dist;
+    }, minTime);
+
+    return summarize("intersect_circle", rays, obstacleCount, std::move(samples),
+                     double(rays) * double(obstacleCount), "tests", double(hits), "hits");
+}
+
+BenchResult benchTrace(const std::string& name, bool reflections, TraceKernel kernel, unsigned int threads,
+                       long long rays, long long obstacleCount, double minTime) {
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    TraceScene scene = makeTraceScene(obstacles);
+    TraceSettings settings;
+    settings.rayCount = static_cast<int>(rays);
+    settings.reflections = reflections;
+
+    Tracer tracer(kernel, threads);
+    std::vector<TraceSegment> segments;
+    auto samples = measure([&]() {
+        tracer.trace(scene, settings, segments);
+        g_sink = g_sink + segments.size();
+    }, minTime);
+
+    return summarize(name, rays, obstacleCount, std::move(samples), double(rays), "rays",
+                     double(segments.size()), "segments");
+}
+
+// Half of the primitives as circles, half as walls
+BenchResult benchTraceWalls(const std::string& name, TraceKernel kernel, unsigned int threads,
+                            long long rays, long long primitiveCount, double minTime) {
+    ObstacleStore obstacles = makeObstacles(primitiveCount / 2, 1);
+    OccluderStore walls = makeWalls(primitiveCount - primitiveCount / 2, 2);
+    TraceScene scene = makeTraceScene(obstacles);
+    scene.occluders = walls.view();
+    TraceSettings settings;
+    settings.rayCount = static_cast<int>(rays);
+    settings.reflections = true;
+
+    Tracer tracer(kernel, threads);
+    std::vector<TraceSegment> segments;
+    auto samples = measure([&]() {
+        tracer.trace(scene, settings, segments);
+        g_sink = g_sink + segments.size();
+    }, minTime);
+
+    return summarize(name, rays, primitiveCount, std::move(samples), double(rays), "rays",
+                     double(segments.size()), "segments");
+}
+
+// Every obstacle glass, with the app's per-ray segment budget
+// dispersion > 0 traces wavelength bins (TraceSettings::dispersion)
+BenchResult benchTraceGlass(const std::string& name, TraceKernel kernel, unsigned int threads,
+                            long long rays, long long obstacleCount, double minTime, float dispersion = 0.0f) {
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    for (std::size_t i = 0; i < obstacles.size(); ++i) {
+        obstacles.setIor(i, 1.5f);
+    }
+    TraceScene scene = makeTraceScene(obstacles);
+    scene.obstacleIor = obstacles.iors();
+    TraceSettings settings;
+    settings.rayCount = static_cast<int>(rays);
+    settings.reflections = true;
+    settings.maxSegments = static_cast<uint64_t>(rays) * 8;
+    settings.dispersion = dispersion;
+
+    Tracer tracer(kernel, threads);
+    std::vector<TraceSegment> segments;
+    auto samples = measure([&]() {
+        tracer.trace(scene, settings, segments);
+        g_sink = g_sink + segments.size();
+    }, minTime);
+
+    return summarize(name, rays, obstacleCount, std::move(samples), double(rays), "rays",
+                     double(segments.size()), "segments");
+}
+
+BenchResult benchGenerateObstacles(long long obstacleCount, double minTime) {
+    SceneDescription scene;
+    unsigned int seed = 1;
+    int placed = 0;
+    auto samples = measure([&]() {
+        placed = SceneLayout::generateObstacles(scene, static_cast<int>(obstacleCount), seed++ * 2654435761u);
+        g_sink = g_sink + placed;
+    }, minTime);
+
+    return summarize("generate_obstacles", -1, obstacleCount, std::move(samples), double(obstacleCount), "requested",
+                     double(placed), "placed");
+}
+
+BenchResult benchCheckValidPosition(long long obstacleCount, double minTime) {
+    constexpr int CANDIDATES = 1000;
+
+    SceneDescription scene;
+    scene.obstacles = makeObstacles(obstacleCount, 1);
+    // Cover the obstacle field so the bounds check does not reject early
+    scene.width = scene.height = std::max(1000.0f, std::sqrt(static_cast<float>(obstacleCount)) * 120.0f) + 200.0f;
+    PlacementView view = scene.placementView();
+
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> position(-scene.width / 2.0f, scene.width / 2.0f);
+    std::vector<glm::vec2> candidates(CANDIDATES);
+    for (auto& candidate : candidates) {
+        candidate = glm::vec2(position(gen), position(gen));
+    }
+
+    int valid = 0;
+    auto samples = measure([&]() {
+        int count = 0;
+        for (const auto& candidate : candidates) {
+            count += SceneLayout::checkValidPosition(view, candidate, SceneLayout::OBSTACLE_RADIUS, false);
+        }
+        valid = count;
+        g_sink = g_sink + count;
+    }, minTime);
+
+    return summarize("check_valid_position", -1, obstacleCount, std::move(samples), double(CANDIDATES), "candidates",
+                     double(valid), "valid");
+}
+
+BenchResult benchFreeSpaceSample(long long obstacleCount, double minTime) {
+    constexpr int SAMPLES = 1000;
+
+    float side = std::max(1000.0f, std::sqrt(static_cast<float>(obstacleCount)) * 120.0f);
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    FreeSpaceSampler sampler;
+    std::mt19937 gen(2);
+
+    // Grid build plus a batch of draws, as one light auto-move target pick
+    int drawn = 0;
+    auto samples = measure([&]() {
+        sampler.reset(glm::vec2(-side / 2.0f), glm::vec2(side / 2.0f));
+        sampler.blockCircles(obstacles.view(), 40.0f);
+        sampler.finalize();
+        int count = 0;
+        glm::vec2 position;
+        for (int i = 0; i < SAMPLES; ++i) {
+            count += sampler.sample(gen, position);
+        }
+        drawn = count;
+        g_sink = g_sink + count;
+    }, minTime);
+
+    return summarize("free_space_sample", -1, obstacleCount, std::move(samples), double(SAMPLES), "samples",
+                     double(drawn), "drawn");
+}
+
+BenchResult benchDragSweep(long long obstacleCount, double minTime) {
+    constexpr int MOVES = 1000;
+
+    float side = std::max(1000.0f, std::sqrt(static_cast<float>(obstacleCount)) * 120.0f);
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    CircleView others{};
+    OccluderStore walls;
+    SceneLayout::addRoomWalls(walls, side, side);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> coordinate(-side / 2.0f, side / 2.0f);
+    std::vector<glm::vec2> targets(MOVES);
+    for (auto& target : targets) {
+        target = glm::vec2(coordinate(gen), coordinate(gen));
+    }
+
+    // Broadphase build plus a batch of long drag moves, as one drag
+    SpatialHash hash;
+    auto samples = measure([&]() {
+        hash.build(obstacles.view());
+        glm::vec2 position(0.0f);
+        for (const auto& target : targets) {
+            position = Collision::slideCircle(hash, obstacles.view(), others, walls.view(), position, target, 20.0f);
+        }
+        g_sink = g_sink + static_cast<int>(position.x);
+    }, minTime);
+
+    return summarize("drag_sweep", -1, obstacleCount, std::move(samples), double(MOVES), "moves",
+                     double(hash.getCellSize()), "cell_size");
+}
+
+BenchResult benchObstacleStep(long long obstacleCount, double minTime) {
+    float side = std::max(1000.0f, std::sqrt(static_cast<float>(obstacleCount)) * 120.0f);
+    ObstacleStore obstacles = makeObstacles(obstacleCount, 1);
+    ObstacleMotion motion;
+    std::mt19937 gen(4);
+    motion.reset(obstacles.size(), ObstacleMotion::DEFAULT_SPEED, gen);
+    CircleView fixed{};
+
+    // One fixed step of the moving-obstacles mode, hash build included
+    auto samples = measure([&]() {
+        motion.step(obstacles, fixed, OccluderView{}, glm::vec2(-side / 2.0f), glm::vec2(side / 2.0f), 1.0f / 120.0f);
+        g_sink = g_sink + motion.getLastContactCount();
+    }, minTime);
+
+    return summarize("obstacle_step", -1, obstacleCount, std::move(samples), double(obstacleCount), "obstacles",
+                     double(motion.getLastContactCount()), "contacts");
+}
+
+// ---------------------------------------------------------------------------
+// Output
+
+void writeCsv(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "benchmark,rays,obstacles,iterations,min_ns,median_ns,items,item,items_per_second,extra,extra_name\n";
+    for (const auto& r : results) {
+        out << r.name << "," << r.rays << "," << r.obstacles << "," << r.iterations << ","
+            << r.minNs << "," << r.medianNs << "," << r.itemsPerIteration << "," << r.itemName << ","
+            << r.itemsPerIteration / (r.medianNs * 1e-9) << "," << r.extra << "," << r.extraName << "\n";
+    }
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i > 0 ? ",\n    " : "\n    ")
+            << "{\"benchmark\": \"" << r.name << "\", \"rays\": " << r.rays << ", \"obstacles\": " << r.obstacles
+            << ", \"iterations\": " << r.iterations << ", \"min_ns\": " << r.minNs << ", \"median_ns\": " << r.medianNs
+            << ", \"items\": " << r.itemsPerIteration << ", \"item\": \"" << r.itemName << "\""
+            << ", \"items_per_second\": " << r.itemsPerIteration / (r.medianNs * 1e-9)
+            << ", \"" << (r.extraName.empty() ? "extra" : r.extraName) << "\": " << r.extra << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::vector<long long> parseList(const std::string& text) {
+    std::vector<long long> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::stoll(item));
+        if (values.back() <= 0) {
+            throw std::runtime_error("Counts must be positive: " + text);
+        }
+    }
+    return values;
+}
+
+BenchOptions parseArguments(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) {
+            options.filter = argv[++i];
+        } else if (arg == "--rays" && hasValue) {
+            options.rayCounts = parseList(argv[++i]);
+        } else if (arg == "--obstacles" && hasValue) {
+            options.obstacleCounts = parseList(argv[++i]);
+        } else if (arg == "--min-time" && hasValue) {
+            options.minTime = std::stod(argv[++i]);
+        } else if (arg == "--max-work" && hasValue) {
+            options.maxWork = std::stod(argv[++i]);
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--out" && hasValue) {
+            options.outPath = argv[++i];
+        } else {
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        BenchOptions options = parseArguments(argc, argv);
+        auto selected = [&](const std::string& name) {
+            return options.filter.empty() || name.find(options.filter) != std::string::npos;
+        };
+        auto report = [](const BenchResult& r) {
+            std::cerr << r.name << " rays=" << r.rays << " obstacles=" << r.obstacles
+                      << ": " << r.medianNs / 1e6 << " ms" << std::endl;
+        };
+
+        std::vector<BenchResult> results;
+
+        // Ray x obstacle grid
+        struct GridBenchmark {
+            const char* name;
+            std::function<BenchResult(long long, long long, double)> run;
+        };
+        const GridBenchmark gridBenchmarks[] = {
+            {"intersect_circle", benchIntersect},
+            {"trace_primary", [](long long r, long long o, double t) {
+                return benchTrace("trace_primary", false, TraceKernel::Scalar, 1, r, o, t); }},
+            {"trace_primary_simd", [](long long r, long long o, double t) {
+                return benchTrace("trace_primary_simd", false, TraceKernel::Simd, 1, r, o, t); }},
+            {"trace_reflections", [](long long r, long long o, double t) {
+                return benchTrace("trace_reflections", true, TraceKernel::Scalar, 1, r, o, t); }},
+            {"trace_reflections_simd", [](long long r, long long o, double t) {
+                return benchTrace("trace_reflections_simd", true, TraceKernel::Simd, 1, r, o, t); }},
+            {"trace_reflections_simd_threaded", [](long long r, long long o, double t) {
+                return benchTrace("trace_reflections_simd_threaded", true, TraceKernel::Simd, 0, r, o, t); }},
+            {"trace_reflections_grid", [](long long r, long long o, double t) {
+                return benchTrace("trace_reflections_grid", true, TraceKernel::Grid, 1, r, o, t); }},
+            {"trace_reflections_grid_threaded", [](long long r, long long o, double t) {
+                return benchTrace("trace_reflections_grid_threaded", true, TraceKernel::Grid, 0, r, o, t); }},
+            {"trace_walls", [](long long r, long long o, double t) {
+                return benchTraceWalls("trace_walls", TraceKernel::Scalar, 1, r, o, t); }},
+            {"trace_walls_simd", [](long long r, long long o, double t) {
+                return benchTraceWalls("trace_walls_simd", TraceKernel::Simd, 1, r, o, t); }},
+            {"trace_walls_grid", [](long long r, long long o, double t) {
+                return benchTraceWalls("trace_walls_grid", TraceKernel::Grid, 1, r, o, t); }},
+            {"trace_glass", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_glass", TraceKernel::Scalar, 1, r, o, t); }},
+            {"trace_glass_simd", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_glass_simd", TraceKernel::Simd, 1, r, o, t); }},
+            {"trace_glass_grid", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_glass_grid", TraceKernel::Grid, 1, r, o, t); }},
+            {"trace_glass_grid_threaded", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_glass_grid_threaded", TraceKernel::Grid, 0, r, o, t); }},
+            {"trace_spectral_simd", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_spectral_simd", TraceKernel::Simd, 1, r, o, t, 0.02f); }},
+            {"trace_spectral_grid", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_spectral_grid", TraceKernel::Grid, 1, r, o, t, 0.02f); }},
+            {"trace_spectral_grid_threaded", [](long long r, long long o, double t) {
+                return benchTraceGlass("trace_spectral_grid_threaded", TraceKernel::Grid, 0, r, o, t, 0.02f); }},
+        };
+        for (const auto& benchmark : gridBenchmarks) {
+            if (!selected(benchmark.name)) continue;
+            for (long long rays : options.rayCounts) {
+                for (long long obstacles : options.obstacleCounts) {
+                    if (double(rays) * double(obstacles) > options.maxWork) {
+                        std::cerr << benchmark.name << " rays=" << rays << " obstacles=" << obstacles
+                                  << ": skipped (exceeds --max-work)" << std::endl;
+                        continue;
+                    }
+                    results.push_back(benchmark.run(rays, obstacles, options.minTime));
+                    report(results.back());
+                }
+            }
+        }
+
+        // Obstacle-only benchmarks
+        for (long long obstacles : options.obstacleCounts) {
+            if (selected("generate_obstacles")) {
+                results.push_back(benchGenerateObstacles(obstacles, options.minTime));
+                report(results.back());
+            }
+            if (selected("check_valid_position") && 1000.0 * double(obstacles) <= options.maxWork) {
+                results.push_back(benchCheckValidPosition(obstacles, options.minTime));
+                report(results.back());
+            }
+            if (selected("free_space_sample")) {
+                results.push_back(benchFreeSpaceSample(obstacles, options.minTime));
+                report(results.back());
+            }
+            if (selected("drag_sweep")) {
+                results.push_back(benchDragSweep(obstacles, options.minTime));
+                report(results.back());
+            }
+            if (selected("obstacle_step")) {
+                results.push_back(benchObstacleStep(obstacles, options.minTime));
+                report(results.back());
+            }
+        }
+
+        std::ofstream file;
+        if (!options.outPath.empty()) {
+            file.open(options.outPath);
+            if (!file) {
+                throw std::runtime_error("Failed to open output file: " + options.outPath);
+            }
+        }
+        std::ostream& out = options.outPath.empty() ? std::cout : file;
+        if (options.json) {
+            writeJson(out, results);
+        } else {
+            writeCsv(out, results);
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,79 @@
+#include "frame_times.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+FrameTimeHistory::FrameTimeHistory(std::size_t capacity) : m_samples(std::max<std::size_t>(capacity, 1)) {
+}
+
+void FrameTimeHistory::add(double ms) {
+    m_samples[m_next] = ms;
+    m_next = (m_next + 1) % m_samples.size();
+    m_count = std::min(m_count + 1, m_samples.size());
+}
+
+void FrameTimeHistory::clear() {
+    m_next = 0;
+    m_count = 0;
+}
+
+FrameTimeHistory::Summary FrameTimeHistory::summarize() const {
+    Summary summary;
+    summary.count = m_count;
+    if (m_count == 0) {
+        return summary;
+    }
+    
+    m_sorted.assign(m_samples.begin(), m_samples.begin() + m_count);
+    std::sort(m_sorted.begin(), m_sorted.end());
+    auto percentile = [this](double p) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p * m_sorted.size()));
+        return m_sorted[std::min(std::max<std::size_t>(rank, 1), m_sorted.size()) - 1];
+    };
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = m_sorted.back();
+    return summary;
+}
+
+std::vector<float> FrameTimeHistory::ordered() const {
+    std::vector<float> result;
+    result.reserve(m_count);
+    std::size_t first = (m_next + m_samples.size() - m_count) % m_samples.size();
+    for (std::size_t i = 0; i < m_count; ++i) {
+        result.push_back(static_cast<float>(m_samples[(first + i) % m_samples.size()]));
+    }
+    return result;
+}
+
+namespace FrameTimes {
+
+void writeCsv(const std::string& path, const FrameTimeHistory& cpu, const FrameTimeHistory& gpu) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open frame times for writing: " + path);
+    }
+    
+    std::vector<float> cpuSamples = cpu.ordered();
+    std::vector<float> gpuSamples = gpu.ordered();
+    std::size_t rows = std::max(cpuSamples.size(), gpuSamples.size());
+    std::size_t cpuOffset = rows - cpuSamples.size();
+    std::size_t gpuOffset = rows - gpuSamples.size();
+    
+    file << "sample,cpu_ms,gpu_ms\n";
+    for (std::size_t i = 0; i < rows; ++i) {
+        file << i << ",";
+        if (i >= cpuOffset) file << cpuSamples[i - cpuOffset];
+        file << ",";
+        if (i >= gpuOffset) file << gpuSamples[i - gpuOffset];
+        file << "\n";
+    }
+    
+    if (!file) {
+        throw std::runtime_error("Failed to write frame times: " + path);
+    }
+}
+
+}
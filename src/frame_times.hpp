@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Rolling window of per-frame times (ms) with percentile queries. Averages
+// such as ImGui's framerate hide single long frames; the tail percentiles
+// and the maximum over the window make them visible.
+class FrameTimeHistory {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1200;  // About 20 s at 60 FPS
+    
+    struct Summary {
+        std::size_t count = 0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+    
+    explicit FrameTimeHistory(std::size_t capacity = DEFAULT_CAPACITY);
+    
+    void add(double ms);
+    void clear();
+    std::size_t size() const { return m_count; }
+    
+    // Nearest-rank percentiles over the window. Sorts a copy, so call it a
+    // few times per second rather than every frame.
+    Summary summarize() const;
+    
+    // Samples from oldest to newest
+    std::vector<float> ordered() const;
+
+private:
+    std::vector<double> m_samples;
+    std::size_t m_next = 0;
+    std::size_t m_count = 0;
+    mutable std::vector<double> m_sorted;  // Scratch for summarize()
+};
+
+namespace FrameTimes {
+    // Writes the windows as CSV (sample, cpu_ms, gpu_ms), oldest first and
+    // aligned at the newest sample. Throws std::runtime_error on failure.
+    void writeCsv(const std::string& path, const FrameTimeHistory& cpu, const FrameTimeHistory& gpu);
+}
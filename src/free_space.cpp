@@ -0,0 +1,214 @@
+#include "free_space.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYTRACER_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void FreeSpaceSampler::reset(const glm::vec2& boundsMin, const glm::vec2& boundsMax, float cellSize) {
+    glm::vec2 extent = boundsMax - boundsMin;
+    cellSize = std::max(cellSize, MIN_CELL_SIZE);
+    m_boundsMin = boundsMin;
+    m_columns = extent.x > 0.0f ? std::max(1, static_cast<int>(std::ceil(extent.x / cellSize))) : 0;
+    m_rows = extent.y > 0.0f ? std::max(1, static_cast<int>(std::ceil(extent.y / cellSize))) : 0;
+    // Cells are stretched to tile the bounds exactly so they all have the same area
+    m_cellSize = m_columns > 0 && m_rows > 0 ? extent / glm::vec2(m_columns, m_rows) : glm::vec2(cellSize);
+    
+    m_blockerX.clear();
+    m_blockerY.clear();
+    m_blockerRadius.clear();
+    m_cellStart.clear();
+    m_cellBlockerX.clear();
+    m_cellBlockerY.clear();
+    m_cellBlockerRadiusSq.clear();
+    m_cellCovered.clear();
+    m_drawableCells.clear();
+}
+
+void FreeSpaceSampler::block(const glm::vec2& center, float radius) {
+    if (radius <= 0.0f) return;
+    m_blockerX.push_back(center.x);
+    m_blockerY.push_back(center.y);
+    m_blockerRadius.push_back(radius);
+}
+
+void FreeSpaceSampler::blockCircles(const CircleView& circles, float clearance) {
+    for (std::size_t i = 0; i < circles.count; ++i) {
+        block(glm::vec2(circles.x[i], circles.y[i]), circles.radius[i] + clearance);
+    }
+}
+
+void FreeSpaceSampler::blockLine(const glm::vec2& from, const glm::vec2& to, float clearance) {
+    if (clearance <= 0.0f) return;
+    // Circles at most clearance apart, each grown so that their union
+    // covers the whole band around the segment
+    float length = glm::length(to - from);
+    int steps = std::max(1, static_cast<int>(std::ceil(length / clearance)));
+    float halfSpacing = 0.5f * length / steps;
+    float radius = std::sqrt(clearance * clearance + halfSpacing * halfSpacing);
+    for (int k = 0; k <= steps; ++k) {
+        block(from + (to - from) * (static_cast<float>(k) / steps), radius);
+    }
+}
+
+void FreeSpaceSampler::blockWalls(const OccluderStore& walls, float clearance) {
+    // Arc pieces of 0.1 rad stray from the arc by under 0.2% of its radius
+    walls.forEachOutlineLine(0.1f, [&](const glm::vec2& from, const glm::vec2& to) {
+        blockLine(from, to, clearance);
+    });
+}
+
+void FreeSpaceSampler::finalize() {
+    std::size_t cellCount = static_cast<std::size_t>(m_columns) * m_rows;
+    m_cellStart.assign(cellCount + 1, 0);
+    m_cellCovered.assign(cellCount, 0);
+    if (cellCount == 0) return;
+    
+    // Calls visit(cell, covered) for every cell the blocker's circle touches
+    auto forEachTouchedCell = [&](std::size_t b, auto&& visit) {
+        float x = m_blockerX[b];
+        float y = m_blockerY[b];
+        float radius = m_blockerRadius[b];
+        float radiusSq = radius * radius;
+        int column0 = std::max(0, static_cast<int>(std::floor((x - radius - m_boundsMin.x) / m_cellSize.x)));
+        int column1 = std::min(m_columns - 1, static_cast<int>(std::floor((x + radius - m_boundsMin.x) / m_cellSize.x)));
+        int row0 = std::max(0, static_cast<int>(std::floor((y - radius - m_boundsMin.y) / m_cellSize.y)));
+        int row1 = std::min(m_rows - 1, static_cast<int>(std::floor((y + radius - m_boundsMin.y) / m_cellSize.y)));
+        for (int row = row0; row <= row1; ++row) {
+            float cellY0 = m_boundsMin.y + row * m_cellSize.y;
+            float cellY1 = cellY0 + m_cellSize.y;
+            for (int column = column0; column <= column1; ++column) {
+                float cellX0 = m_boundsMin.x + column * m_cellSize.x;
+                float cellX1 = cellX0 + m_cellSize.x;
+                
+                // Nearest point of the cell decides whether the circle touches it,
+                // the farthest corner whether it covers it entirely
+                float nearX = std::clamp(x, cellX0, cellX1) - x;
+                float nearY = std::clamp(y, cellY0, cellY1) - y;
+                if (nearX * nearX + nearY * nearY >= radiusSq) continue;
+                float farX = std::max(x - cellX0, cellX1 - x);
+                float farY = std::max(y - cellY0, cellY1 - y);
+                visit(static_cast<std::size_t>(row) * m_columns + column, farX * farX + farY * farY < radiusSq);
+            }
+        }
+    };
+    
+    // Count the blockers per cell, then fill them in structure-of-arrays order
+    for (std::size_t b = 0; b < m_blockerX.size(); ++b) {
+        forEachTouchedCell(b, [&](std::size_t cell, bool covered) {
+            ++m_cellStart[cell + 1];
+            m_cellCovered[cell] |= covered;
+        });
+    }
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        // Covered cells are never tested, so they keep no blockers
+        if (m_cellCovered[cell]) m_cellStart[cell + 1] = 0;
+        m_cellStart[cell + 1] += m_cellStart[cell];
+    }
+    
+    m_cellBlockerX.resize(m_cellStart[cellCount]);
+    m_cellBlockerY.resize(m_cellStart[cellCount]);
+    m_cellBlockerRadiusSq.resize(m_cellStart[cellCount]);
+    std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t b = 0; b < m_blockerX.size(); ++b) {
+        forEachTouchedCell(b, [&](std::size_t cell, bool) {
+            if (m_cellCovered[cell]) return;
+            uint32_t slot = fill[cell]++;
+            m_cellBlockerX[slot] = m_blockerX[b];
+            m_cellBlockerY[slot] = m_blockerY[b];
+            m_cellBlockerRadiusSq[slot] = m_blockerRadius[b] * m_blockerRadius[b];
+        });
+    }
+    
+    for (std::size_t cell = 0; cell < cellCount; ++cell) {
+        if (!m_cellCovered[cell]) {
+            m_drawableCells.push_back(static_cast<uint32_t>(cell));
+        }
+    }
+}
+
+bool FreeSpaceSampler::sample(std::mt19937& random, glm::vec2& position) const {
+    return draw(m_drawableCells, random, glm::vec2(0.0f), 0.0f, position);
+}
+
+bool FreeSpaceSampler::sampleOutside(std::mt19937& random, const glm::vec2& center, float radius,
+                                     glm::vec2& position) const {
+    // Cells the excluded circle covers entirely cannot produce a sample
+    float radiusSq = radius * radius;
+    std::vector<uint32_t> cells;
+    cells.reserve(m_drawableCells.size());
+    for (uint32_t cell : m_drawableCells) {
+        glm::vec2 cellMin = cellOrigin(cell);
+        glm::vec2 cellMax = cellMin + m_cellSize;
+        float farX = std::max(center.x - cellMin.x, cellMax.x - center.x);
+        float farY = std::max(center.y - cellMin.y, cellMax.y - center.y);
+        if (farX * farX + farY * farY >= radiusSq) {
+            cells.push_back(cell);
+        }
+    }
+    return draw(cells, random, center, radiusSq, position);
+}
+
+bool FreeSpaceSampler::draw(const std::vector<uint32_t>& cells, std::mt19937& random, const glm::vec2& excludedCenter,
+                            float excludedRadiusSq, glm::vec2& position) const {
+    if (cells.empty()) return false;
+    
+    std::uniform_int_distribution<std::size_t> pickCell(0, cells.size() - 1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int attempt = 0; attempt < MAX_SAMPLE_ATTEMPTS; ++attempt) {
+        uint32_t cell = cells[pickCell(random)];
+        glm::vec2 candidate = cellOrigin(cell) + glm::vec2(unit(random), unit(random)) * m_cellSize;
+        glm::vec2 offset = candidate - excludedCenter;
+        if (glm::dot(offset, offset) >= excludedRadiusSq && !isBlockedInCell(cell, candidate)) {
+            position = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FreeSpaceSampler::isFree(const glm::vec2& position) const {
+    int cell = cellIndex(position);
+    return cell >= 0 && !m_cellCovered[cell] && !isBlockedInCell(static_cast<uint32_t>(cell), position);
+}
+
+int FreeSpaceSampler::cellIndex(const glm::vec2& position) const {
+    if (m_cellCovered.empty()) return -1;
+    glm::vec2 local = (position - m_boundsMin) / m_cellSize;
+    if (local.x < 0.0f || local.y < 0.0f || local.x > m_columns || local.y > m_rows) return -1;
+    int column = std::min(static_cast<int>(local.x), m_columns - 1);
+    int row = std::min(static_cast<int>(local.y), m_rows - 1);
+    return row * m_columns + column;
+}
+
+glm::vec2 FreeSpaceSampler::cellOrigin(uint32_t cell) const {
+    return m_boundsMin + glm::vec2(static_cast<float>(cell % m_columns), static_cast<float>(cell / m_columns)) * m_cellSize;
+}
+
+bool FreeSpaceSampler::isBlockedInCell(uint32_t cell, const glm::vec2& position) const {
+    uint32_t i = m_cellStart[cell];
+    uint32_t end = m_cellStart[cell + 1];
+#ifdef RAYTRACER_HAS_SSE2
+    // Four blockers per step
+    const __m128 positionX = _mm_set1_ps(position.x);
+    const __m128 positionY = _mm_set1_ps(position.y);
+    for (; i + 4 <= end; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(m_cellBlockerX.data() + i), positionX);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(m_cellBlockerY.data() + i), positionY);
+        __m128 distanceSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        if (_mm_movemask_ps(_mm_cmplt_ps(distanceSq, _mm_loadu_ps(m_cellBlockerRadiusSq.data() + i)))) {
+            return true;
+        }
+    }
+#endif
+    for (; i < end; ++i) {
+        float dx = m_cellBlockerX[i] - position.x;
+        float dy = m_cellBlockerY[i] - position.y;
+        if (dx * dx + dy * dy < m_cellBlockerRadiusSq[i]) {
+            return true;
+        }
+    }
+    return false;
+}
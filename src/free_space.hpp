@@ -0,0 +1,76 @@
+#pragma once
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Uniform sampling of the points in a rectangle that lie outside a set of
+// blocking circles. Blockers are binned into an occupancy grid: cells no
+// blocker touches accept a sample without any test, cells a single blocker
+// covers are never drawn from, and only the remaining boundary cells test
+// the candidate against the few blockers overlapping them.
+//
+// Every drawable cell has the same area and a candidate is rejected only if
+// it is blocked, so accepted points are uniform over the free space. The
+// expected number of draws is the drawable area over the free area.
+class FreeSpaceSampler {
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 32.0f;
+    static constexpr float MIN_CELL_SIZE = 4.0f;  // Smaller cell sizes are raised to this
+    static constexpr int MAX_SAMPLE_ATTEMPTS = 64;
+
+    // Starts a new region; blockers are added next, then finalize()
+    void reset(const glm::vec2& boundsMin, const glm::vec2& boundsMax, float cellSize = DEFAULT_CELL_SIZE);
+    // Points closer than radius to center are not free
+    void block(const glm::vec2& center, float radius);
+    // Blocks every circle grown by clearance
+    void blockCircles(const CircleView& circles, float clearance);
+    // Blocks the points within clearance of the segment, as a chain of
+    // circles that over-blocks by at most 12% of clearance
+    void blockLine(const glm::vec2& from, const glm::vec2& to, float clearance);
+    // Blocks the points within clearance of any wall outline
+    void blockWalls(const OccluderStore& walls, float clearance);
+    // Bins the blockers and classifies the cells
+    void finalize();
+
+    // Draws a free point; false if the region has no free space or every
+    // attempt was rejected
+    bool sample(std::mt19937& random, glm::vec2& position) const;
+    // As sample, also rejecting points closer than radius to center, so a
+    // finalized sampler can be reused while that one blocker keeps moving
+    bool sampleOutside(std::mt19937& random, const glm::vec2& center, float radius, glm::vec2& position) const;
+    bool isFree(const glm::vec2& position) const;
+
+    // Cells that can produce a sample (free or partially blocked)
+    std::size_t getDrawableCellCount() const { return m_drawableCells.size(); }
+
+private:
+    glm::vec2 m_boundsMin{0.0f};
+    glm::vec2 m_cellSize{DEFAULT_CELL_SIZE};
+    int m_columns = 0;
+    int m_rows = 0;
+
+    // Blockers as added
+    std::vector<float> m_blockerX;
+    std::vector<float> m_blockerY;
+    std::vector<float> m_blockerRadius;
+
+    // Blockers overlapping each cell, copied per cell in structure-of-arrays
+    // order so the candidate test streams them contiguously
+    std::vector<uint32_t> m_cellStart;  // m_columns * m_rows + 1 offsets
+    std::vector<float> m_cellBlockerX;
+    std::vector<float> m_cellBlockerY;
+    std::vector<float> m_cellBlockerRadiusSq;
+    std::vector<uint8_t> m_cellCovered;  // Inside a single blocker
+    std::vector<uint32_t> m_drawableCells;
+
+    int cellIndex(const glm::vec2& position) const;
+    glm::vec2 cellOrigin(uint32_t cell) const;
+    bool isBlockedInCell(uint32_t cell, const glm::vec2& position) const;
+    // Draws from cells, rejecting points closer than sqrt(excludedRadiusSq)
+    // to excludedCenter as well as blocked ones
+    bool draw(const std::vector<uint32_t>& cells, std::mt19937& random, const glm::vec2& excludedCenter,
+              float excludedRadiusSq, glm::vec2& position) const;
+};
@@ -0,0 +1,470 @@
+// Golden-output regression harness for the tracing backends.
+//
+// Usage: RayTracerNG_Golden [--golden-dir <dir>] [--backend <substring>] [--repeat <n>] [--update]
+//        RayTracerNG_GoldenGpu [same options] [--software]
+//
+// Traces a fixed corpus of seeded scenes with every registered backend and
+// compares the result, ray by ray, against golden files stored in
+// <dir>/<scene>.csv (default dir: golden). Reflection chains must have the
+// same depths and hit ids; hit distances, end points, colors and
+// attenuations must agree within tolerance. Each backend is also timed (median of --repeat runs), so one
+// run checks both correctness and speed. --update rewrites the golden files
+// from the reference backend (scalar, single-threaded).
+//
+// RayTracerNG_GoldenGpu is the same harness built with RAYTRACER_GOLDEN_GPU.
+// It also runs the compute-shader tracer in a hidden window and checks it
+// with GpuTracer::validate against the scalar backend on every corpus scene
+// the GPU supports (no walls, no glass). --software forces Mesa's llvmpipe,
+// so the check runs without a GPU (under xvfb-run when there is no display).
+//
+// Exit status is 0 only if every backend matches every golden file.
+#ifdef RAYTRACER_GOLDEN_GPU
+#include "gpu_tracer.hpp"
+#include <GLFW/glfw3.h>
+#endif
+#include "tracer.hpp"
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int GOLDEN_FORMAT_VERSION = 2;
+
+// Hit distance tolerance: absolute plus relative to the distance
+constexpr double DISTANCE_TOLERANCE = 1e-3;
+constexpr double RELATIVE_TOLERANCE = 1e-5;
+// Color and attenuation tolerance; both are energies in [0, 1]
+constexpr double ENERGY_TOLERANCE = 1e-5;
+
+struct CorpusScene {
+    const char* name;
+    uint32_t seed;
+    int obstacles;
+    int rays;
+    bool reflections;
+    glm::vec2 light;
+    float extent;  // Obstacles are placed in [-extent, extent]^2
+    bool walls = false;  // Room walls around the extent, a polygon and an arc
+    float glassIor = 0.0f;  // Index of refraction of every other obstacle, 0 for all opaque
+    uint64_t maxSegments = 0;
+    float dispersion = 0.0f;  // TraceSettings::dispersion
+};
+
+// Seeded scenes covering sparse, dense, reflection-free, many-ray, wall,
+// refraction and dispersion cases.
+// Layouts come from raw mt19937 output, which is specified by the standard,
+// so the corpus is identical on every platform.
+const CorpusScene CORPUS[] = {
+    {"app_default", 1, 10, 90, true, {-500.0f, 0.0f}, 600.0f},
+    {"app_ultra", 2, 50, 720, true, {-500.0f, 0.0f}, 600.0f},
+    {"no_reflections", 3, 50, 360, false, {100.0f, -200.0f}, 600.0f},
+    {"empty", 4, 0, 180, true, {0.0f, 0.0f}, 600.0f},
+    {"dense", 5, 400, 720, true, {-40.0f, 300.0f}, 700.0f},
+    {"many_rays", 6, 100, 3000, true, {-300.0f, 120.0f}, 900.0f},
+    {"large_field", 7, 5000, 1024, true, {0.0f, -60.0f}, 4000.0f},
+    {"walls", 8, 60, 720, true, {-300.0f, 80.0f}, 600.0f, true},
+    {"glass", 9, 60, 720, true, {-400.0f, 50.0f}, 500.0f, false, 1.5f, 1200},
+    {"spectral", 10, 40, 360, true, {-400.0f, -30.0f}, 500.0f, false, 1.6f, 1500, 0.02f},
+};
+
+struct GeneratedScene {
+    ObstacleStore obstacles;
+    OccluderStore occluders;
+    TraceScene scene;
+    TraceSettings settings;
+};
+
+float unitFloat(std::mt19937& gen) {
+    return static_cast<float>(gen() >> 8) * (1.0f / 16777216.0f);
+}
+
+void generateScene(const CorpusScene& corpus, GeneratedScene& out) {
+    std::mt19937 gen(corpus.seed);
+    out.obstacles.clear();
+    for (int i = 0; i < corpus.obstacles; ++i) {
+        float x = (unitFloat(gen) * 2.0f - 1.0f) * corpus.extent;
+        float y = (unitFloat(gen) * 2.0f - 1.0f) * corpus.extent;
+        float radius = 10.0f + unitFloat(gen) * 30.0f;
+        // Keep the light outside every circle so all rays start in free space
+        if (glm::length(glm::vec2(x, y) - corpus.light) < radius + 5.0f) continue;
+        bool glass = corpus.glassIor > 0.0f && out.obstacles.size() % 2 == 0;
+        out.obstacles.add(glm::vec2(x, y), radius, glm::vec3(0.5f), glass ? corpus.glassIor : ObstacleStore::OPAQUE);
+    }
+
+    out.scene.lightOrigin = corpus.light;
+    out.scene.mainPosition = glm::vec2(0.0f, 0.0f);
+    out.scene.mainRadius = 25.0f;
+    out.scene.obstacles = out.obstacles.view();
+    out.scene.obstacleIor = out.obstacles.iors();
+    out.scene.obstacleColors = out.obstacles.colors();
+
+    out.occluders.clear();
+    if (corpus.walls) {
+        float e = corpus.extent + 50.0f;
+        out.occluders.addSegment(glm::vec2(-e, -e), glm::vec2(e, -e));
+        out.occluders.addSegment(glm::vec2(e, -e), glm::vec2(e, e));
+        out.occluders.addSegment(glm::vec2(e, e), glm::vec2(-e, e));
+        out.occluders.addSegment(glm::vec2(-e, e), glm::vec2(-e, -e));
+        out.occluders.addPolygon({glm::vec2(200.0f, -300.0f), glm::vec2(340.0f, -260.0f), glm::vec2(260.0f, -140.0f)});
+        out.occluders.addArc(glm::vec2(0.0f), 120.0f, 1.0f, 5.3f);
+    }
+    out.scene.occluders = out.occluders.view();
+
+    out.settings = TraceSettings();
+    out.settings.rayCount = corpus.rays;
+    out.settings.reflections = corpus.reflections;
+    out.settings.maxSegments = corpus.maxSegments;
+    out.settings.dispersion = corpus.dispersion;
+}
+
+// One row of a golden file
+struct GoldenSegment {
+    int ray;
+    int depth;
+    int hitId;
+    double hitDist;
+    double endX;
+    double endY;
+    double color[3];
+    double attenuation;
+};
+
+std::vector<GoldenSegment> toGolden(const std::vector<TraceSegment>& segments) {
+    std::vector<GoldenSegment> rows;
+    rows.reserve(segments.size());
+    for (const auto& s : segments) {
+        rows.push_back({s.ray, s.depth, s.hitId, glm::length(s.end - s.origin), s.end.x, s.end.y,
+                        {s.color.r, s.color.g, s.color.b}, s.attenuation});
+    }
+    return rows;
+}
+
+void writeGolden(const fs::path& path, const CorpusScene& corpus, const std::vector<GoldenSegment>& rows) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to write golden file: " + path.string());
+    }
+    file << "# RayTracerNG golden trace v" << GOLDEN_FORMAT_VERSION << ": " << corpus.name << "\n";
+    file << "ray,depth,hit_id,hit_dist,end_x,end_y,color_r,color_g,color_b,attenuation\n";
+    char line[256];
+    for (const auto& r : rows) {
+        std::snprintf(line, sizeof(line), "%d,%d,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", r.ray, r.depth, r.hitId,
+                      r.hitDist, r.endX, r.endY, r.color[0], r.color[1], r.color[2], r.attenuation);
+        file << line;
+    }
+}
+
+std::vector<GoldenSegment> readGolden(const fs::path& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Missing golden file: " + path.string() + " (run with --update to create it)");
+    }
+    std::vector<GoldenSegment> rows;
+    std::string line;
+    while (std::getline(file, line)) {
+        int version = 0;
+        if (std::sscanf(line.c_str(), "# RayTracerNG golden trace v%d", &version) == 1 && version != GOLDEN_FORMAT_VERSION) {
+            throw std::runtime_error("Golden file " + path.string() + " has format v" + std::to_string(version) +
+                                     ", expected v" + std::to_string(GOLDEN_FORMAT_VERSION) + " (run with --update)");
+        }
+        if (line.empty() || line[0] == '#' || line[0] == 'r') continue;  // Comment and header
+        GoldenSegment r;
+        if (std::sscanf(line.c_str(), "%d,%d,%d,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &r.ray, &r.depth, &r.hitId, &r.hitDist,
+                        &r.endX, &r.endY, &r.color[0], &r.color[1], &r.color[2], &r.attenuation) != 10) {
+            throw std::runtime_error("Malformed golden file line in " + path.string() + ": " + line);
+        }
+        rows.push_back(r);
+    }
+    return rows;
+}
+
+struct Comparison {
+    size_t raysChecked = 0;
+    size_t treeMismatches = 0;  // Rays whose reflection chain differs in shape or hit ids
+    double maxDistanceError = 0.0;
+    double maxEndpointError = 0.0;
+    double maxEnergyError = 0.0;  // Largest color component or attenuation difference
+    bool withinTolerance = true;
+
+    bool passed() const { return treeMismatches == 0 && withinTolerance; }
+};
+
+bool withinTolerance(double error, double magnitude) {
+    return error <= DISTANCE_TOLERANCE + RELATIVE_TOLERANCE * std::abs(magnitude);
+}
+
+// Rows of both sides are grouped by primary ray; each group is one
+// reflection chain in depth order
+Comparison compare(const std::vector<GoldenSegment>& expected, const std::vector<GoldenSegment>& actual) {
+    Comparison result;
+    size_t e = 0;
+    size_t a = 0;
+    while (e < expected.size() || a < actual.size()) {
+        int ray = e < expected.size() ? expected[e].ray : actual[a].ray;
+        if (a < actual.size() && actual[a].ray < ray) ray = actual[a].ray;
+
+        size_t eEnd = e;
+        while (eEnd < expected.size() && expected[eEnd].ray == ray) ++eEnd;
+        size_t aEnd = a;
+        while (aEnd < actual.size() && actual[aEnd].ray == ray) ++aEnd;
+
+        ++result.raysChecked;
+        bool sameTree = (eEnd - e) == (aEnd - a);
+        for (size_t i = 0; sameTree && i < eEnd - e; ++i) {
+            const GoldenSegment& x = expected[e + i];
+            const GoldenSegment& y = actual[a + i];
+            if (x.depth != y.depth || x.hitId != y.hitId) {
+                sameTree = false;
+                break;
+            }
+            double distError = std::abs(x.hitDist - y.hitDist);
+            double endError = std::hypot(x.endX - y.endX, x.endY - y.endY);
+            double energyError = std::abs(x.attenuation - y.attenuation);
+            for (int c = 0; c < 3; ++c) {
+                energyError = std::max(energyError, std::abs(x.color[c] - y.color[c]));
+            }
+            result.maxDistanceError = std::max(result.maxDistanceError, distError);
+            result.maxEndpointError = std::max(result.maxEndpointError, endError);
+            result.maxEnergyError = std::max(result.maxEnergyError, energyError);
+            if (!withinTolerance(distError, x.hitDist) ||
+                !withinTolerance(endError, std::max(std::abs(x.endX), std::abs(x.endY))) ||
+                energyError > ENERGY_TOLERANCE) {
+                result.withinTolerance = false;
+            }
+        }
+        if (!sameTree) {
+            ++result.treeMismatches;
+        }
+        e = eEnd;
+        a = aEnd;
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Backends
+
+using TraceFunction = std::function<void(const TraceScene&, const TraceSettings&, std::vector<TraceSegment>&)>;
+
+struct Backend {
+    std::string name;
+    TraceFunction trace;
+};
+
+// Backends under test. The first one is the reference used by --update.
+std::vector<Backend> makeBackends() {
+    auto cpu = [](TraceKernel kernel, unsigned int threads) -> TraceFunction {
+        auto tracer = std::make_shared<Tracer>(kernel, threads);
+        return [tracer](const TraceScene& scene, const TraceSettings& settings, std::vector<TraceSegment>& out) {
+            tracer->trace(scene, settings, out);
+        };
+    };
+
+    std::vector<Backend> backends;
+    backends.push_back({"scalar", cpu(TraceKernel::Scalar, 1)});
+    backends.push_back({Tracer::isSimdAvailable() ? "simd_sse2" : "simd_fallback", cpu(TraceKernel::Simd, 1)});
+    backends.push_back({"threaded", cpu(TraceKernel::Scalar, 0)});
+    backends.push_back({"simd_threaded", cpu(TraceKernel::Simd, 0)});
+    backends.push_back({"grid", cpu(TraceKernel::Grid, 1)});
+    backends.push_back({"grid_threaded", cpu(TraceKernel::Grid, 0)});
+    return backends;
+}
+
+#ifdef RAYTRACER_GOLDEN_GPU
+// ---------------------------------------------------------------------------
+// GPU cross-check
+
+// Hidden 1x1 window owning an OpenGL 4.5 core context for the compute tracer
+class HeadlessContext {
+public:
+    explicit HeadlessContext(bool software) {
+        if (software) {
+            // Read by Mesa when the context is created: selects llvmpipe
+#ifdef _WIN32
+            _putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+            _putenv_s("GALLIUM_DRIVER", "llvmpipe");
+#else
+            setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+            setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+#endif
+        }
+        if (!glfwInit()) {
+            throw std::runtime_error("Failed to initialize GLFW");
+        }
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        m_window = glfwCreateWindow(1, 1, "RayTracerNG_GoldenGpu", nullptr, nullptr);
+        if (!m_window) {
+            glfwTerminate();
+            throw std::runtime_error("Failed to create an OpenGL 4.5 context");
+        }
+        glfwMakeContextCurrent(m_window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            glfwDestroyWindow(m_window);
+            glfwTerminate();
+            throw std::runtime_error("Failed to initialize GLAD");
+        }
+    }
+
+    ~HeadlessContext() {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+    }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    const char* renderer() const { return reinterpret_cast<const char*>(glGetString(GL_RENDERER)); }
+
+private:
+    GLFWwindow* m_window = nullptr;
+};
+
+// The compute tracer only knows mirror circles (see LightSource::traceRays)
+bool isGpuSupported(const CorpusScene& corpus) {
+    return !corpus.walls && corpus.glassIor == 0.0f;
+}
+#endif
+
+struct Options {
+    fs::path goldenDir{"golden"};
+    std::string backendFilter;
+    int repeat{5};
+    bool update{false};
+    bool software{false};
+};
+
+Options parseArguments(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--golden-dir" && hasValue) {
+            options.goldenDir = argv[++i];
+        } else if (arg == "--backend" && hasValue) {
+            options.backendFilter = argv[++i];
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--update") {
+            options.update = true;
+#ifdef RAYTRACER_GOLDEN_GPU
+        } else if (arg == "--software") {
+            options.software = true;
+#endif
+        } else {
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    return options;
+}
+
+double medianTraceMs(const Backend& backend, const GeneratedScene& generated, int repeat,
+                     std::vector<TraceSegment>& segments) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> times;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = Clock::now();
+        backend.trace(generated.scene, generated.settings, segments);
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        Options options = parseArguments(argc, argv);
+        std::vector<Backend> backends = makeBackends();
+        GeneratedScene generated;
+        std::vector<TraceSegment> segments;
+
+        if (options.update) {
+            fs::create_directories(options.goldenDir);
+            for (const CorpusScene& corpus : CORPUS) {
+                generateScene(corpus, generated);
+                backends.front().trace(generated.scene, generated.settings, segments);
+                writeGolden(options.goldenDir / (std::string(corpus.name) + ".csv"), corpus, toGolden(segments));
+                std::cout << "Wrote " << corpus.name << " (" << segments.size() << " segments)" << std::endl;
+            }
+            return 0;
+        }
+
+        int failures = 0;
+        std::vector<double> totalMs(backends.size(), 0.0);
+#ifdef RAYTRACER_GOLDEN_GPU
+        // Declared after the context so its GL objects are deleted first
+        HeadlessContext context(options.software);
+        std::cout << "GPU: " << context.renderer() << std::endl;
+        auto gpuTracer = std::make_unique<GpuTracer>();
+        Tracer gpuReference(TraceKernel::Scalar, 1);
+        bool checkGpu = options.backendFilter.empty() || std::string("gpu").find(options.backendFilter) != std::string::npos;
+#endif
+        std::printf("%-16s %-14s %-6s %8s %10s %12s %12s %14s %10s\n",
+                    "scene", "backend", "result", "rays", "mismatches", "max_dist_err", "max_end_err", "max_energy_err", "time_ms");
+        for (const CorpusScene& corpus : CORPUS) {
+            generateScene(corpus, generated);
+            std::vector<GoldenSegment> expected = readGolden(options.goldenDir / (std::string(corpus.name) + ".csv"));
+
+            for (size_t b = 0; b < backends.size(); ++b) {
+                const Backend& backend = backends[b];
+                if (!options.backendFilter.empty() && backend.name.find(options.backendFilter) == std::string::npos) {
+                    continue;
+                }
+                double ms = medianTraceMs(backend, generated, options.repeat, segments);
+                totalMs[b] += ms;
+                Comparison result = compare(expected, toGolden(segments));
+                if (!result.passed()) ++failures;
+                std::printf("%-16s %-14s %-6s %8zu %10zu %12.3g %12.3g %14.3g %10.3f\n",
+                            corpus.name, backend.name.c_str(), result.passed() ? "ok" : "FAIL",
+                            result.raysChecked, result.treeMismatches, result.maxDistanceError,
+                            result.maxEndpointError, result.maxEnergyError, ms);
+            }
+
+#ifdef RAYTRACER_GOLDEN_GPU
+            // The scalar reference is itself checked against the golden file above
+            if (checkGpu && isGpuSupported(corpus)) {
+                gpuTracer->dispatch(generated.scene, generated.settings);
+                GpuTracer::ValidationResult result = gpuTracer->validate(generated.scene, generated.settings, gpuReference);
+                if (!result.passed()) ++failures;
+                std::printf("%-16s %-14s %-6s %8zu %10zu %12s %12.3g %14.3g %10s   (reflected max_end_err %.3g)\n",
+                            corpus.name, "gpu", result.passed() ? "ok" : "FAIL",
+                            static_cast<size_t>(generated.settings.rayCount), result.hitMismatches,
+                            "-", result.maxEndpointError, result.maxEnergyError, "-", result.maxReflectedEndpointError);
+            }
+#endif
+        }
+
+        std::printf("\nTotal trace time per backend (median of %d runs per scene):\n", options.repeat);
+        for (size_t b = 0; b < backends.size(); ++b) {
+            if (totalMs[b] > 0.0) {
+                std::printf("  %-14s %10.3f ms\n", backends[b].name.c_str(), totalMs[b]);
+            }
+        }
+        std::printf("%s\n", failures == 0 ? "All backends match the golden outputs." : "Golden output mismatches found.");
+        return failures == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,80 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::GpuTimer() {
+    for (auto& slot : m_slots) {
+        glGenQueries(QUERIES_PER_FRAME, slot.queries);
+    }
+}
+
+GpuTimer::~GpuTimer() {
+    for (auto& slot : m_slots) {
+        glDeleteQueries(QUERIES_PER_FRAME, slot.queries);
+    }
+}
+
+const char* GpuTimer::passName(Pass pass) {
+    switch (pass) {
+        case PASS_TRACE: return "Trace";
+        case PASS_SCENE: return "Scene";
+        case PASS_UI: return "UI";
+        default: return "?";
+    }
+}
+
+void GpuTimer::beginFrame() {
+    m_collectedFrameMs.clear();
+    
+    // Oldest first (the slot about to be reused), so the smoothed values see frames in order
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        FrameSlot& slot = m_slots[(m_current + i) % FRAMES_IN_FLIGHT];
+        if (slot.pending) {
+            collect(slot);
+        }
+    }
+    
+    m_timingFrame = !m_slots[m_current].pending;
+    if (m_timingFrame) {
+        glQueryCounter(m_slots[m_current].queries[0], GL_TIMESTAMP);
+    }
+}
+
+void GpuTimer::endPass(Pass pass) {
+    if (m_timingFrame) {
+        glQueryCounter(m_slots[m_current].queries[pass + 1], GL_TIMESTAMP);
+    }
+}
+
+void GpuTimer::endFrame() {
+    if (m_timingFrame) {
+        m_slots[m_current].pending = true;
+    }
+    m_timingFrame = false;
+    m_current = (m_current + 1) % FRAMES_IN_FLIGHT;
+}
+
+void GpuTimer::collect(FrameSlot& slot) {
+    // Timestamps complete in order, but check each one rather than rely on it
+    for (GLuint query : slot.queries) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+    }
+    
+    GLuint64 timestamps[QUERIES_PER_FRAME];
+    for (int i = 0; i < QUERIES_PER_FRAME; ++i) {
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+    slot.pending = false;
+    
+    double weight = m_hasResults ? SMOOTHING : 1.0;
+    for (int pass = 0; pass < PASS_COUNT; ++pass) {
+        double ms = (timestamps[pass + 1] - timestamps[pass]) / 1000000.0;
+        m_passMs[pass] += (ms - m_passMs[pass]) * weight;
+    }
+    double frameMs = (timestamps[PASS_COUNT] - timestamps[0]) / 1000000.0;
+    m_frameMs += (frameMs - m_frameMs) * weight;
+    m_collectedFrameMs.push_back(frameMs);
+    m_hasResults = true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+// Per-pass GPU timings from GL_TIMESTAMP queries, read back without stalling.
+// Each frame writes one timestamp at its start and one at the end of every
+// pass into its own slot of a small ring. A slot is read only once
+// GL_QUERY_RESULT_AVAILABLE reports it finished, usually a few frames later.
+// If the GPU falls so far behind that the next slot is still pending, that
+// frame is not timed.
+class GpuTimer {
+public:
+    // Passes in submission order; each ends where the next one starts
+    enum Pass {
+        PASS_TRACE,  // Clear, per-frame uploads and the ray trace (CPU upload or compute dispatch)
+        PASS_SCENE,  // Circle, ray and crosshair draws
+        PASS_UI,     // ImGui draw
+        PASS_COUNT
+    };
+    
+    static constexpr int FRAMES_IN_FLIGHT = 4;
+    
+    GpuTimer();
+    ~GpuTimer();
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+    
+    // Collects finished frames and writes the frame start timestamp
+    void beginFrame();
+    // Writes the timestamp that ends the given pass
+    void endPass(Pass pass);
+    void endFrame();
+    
+    // Smoothed results of the finished frames, in milliseconds
+    double getPassMs(Pass pass) const { return m_passMs[pass]; }
+    double getFrameMs() const { return m_frameMs; }
+    bool hasResults() const { return m_hasResults; }
+    
+    // Unsmoothed GPU times of the frames collected by the last beginFrame()
+    const std::vector<double>& getCollectedFrameMs() const { return m_collectedFrameMs; }
+    
+    static const char* passName(Pass pass);
+
+private:
+    static constexpr int QUERIES_PER_FRAME = PASS_COUNT + 1;  // Frame start + one per pass
+    static constexpr double SMOOTHING = 0.1;  // Weight of the newest frame
+    
+    struct FrameSlot {
+        GLuint queries[QUERIES_PER_FRAME] = {};
+        bool pending = false;  // Queries issued, results not read yet
+    };
+    
+    FrameSlot m_slots[FRAMES_IN_FLIGHT];
+    int m_current = 0;
+    bool m_timingFrame = false;  // False when the current slot was still pending
+    
+    double m_passMs[PASS_COUNT] = {};
+    double m_frameMs = 0.0;
+    bool m_hasResults = false;
+    std::vector<double> m_collectedFrameMs;
+    
+    void collect(FrameSlot& slot);
+};
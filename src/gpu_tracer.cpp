@@ -0,0 +1,225 @@
+#include "gpu_tracer.hpp"
+#include "shaders.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <cstddef>
+
+GpuTracer::GpuTracer() {
+    initProgram();
+    initBuffers();
+}
+
+GpuTracer::~GpuTracer() {
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_circleSSBO);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_segmentBuffer);
+    glDeleteBuffers(1, &m_commandBuffer);
+    glDeleteProgram(m_program);
+}
+
+void GpuTracer::initProgram() {
+    unsigned int computeShader = glCreateShader(GL_COMPUTE_SHADER);
+    const char* computeSource = Shaders::traceComputeShaderSource.c_str();
+    glShaderSource(computeShader, 1, &computeSource, NULL);
+    glCompileShader(computeShader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+        glDeleteShader(computeShader);
+        throw std::runtime_error("Trace compute shader compilation failed: " + std::string(infoLog));
+    }
+
+    m_program = glCreateProgram();
+    glAttachShader(m_program, computeShader);
+    glLinkProgram(m_program);
+    glDeleteShader(computeShader);
+
+    glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(m_program, 512, NULL, infoLog);
+        glDeleteProgram(m_program);
+        m_program = 0;
+        throw std::runtime_error("Trace compute program linking failed: " + std::string(infoLog));
+    }
+
+    m_uniforms.lightOrigin = glGetUniformLocation(m_program, "lightOrigin");
+    m_uniforms.rayCount = glGetUniformLocation(m_program, "rayCount");
+    m_uniforms.circleCount = glGetUniformLocation(m_program, "circleCount");
+    m_uniforms.reflections = glGetUniformLocation(m_program, "reflections");
+    m_uniforms.maxReflections = glGetUniformLocation(m_program, "maxReflections");
+    m_uniforms.maxRayLength = glGetUniformLocation(m_program, "maxRayLength");
+    m_uniforms.reflectionLengthFactor = glGetUniformLocation(m_program, "reflectionLengthFactor");
+    m_uniforms.primaryColor = glGetUniformLocation(m_program, "primaryColor");
+    m_uniforms.minEnergy = glGetUniformLocation(m_program, "minEnergy");
+    m_uniforms.rouletteEnergy = glGetUniformLocation(m_program, "rouletteEnergy");
+    m_uniforms.attenuationLength = glGetUniformLocation(m_program, "attenuationLength");
+}
+
+void GpuTracer::initBuffers() {
+    glGenBuffers(1, &m_circleSSBO);
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_segmentBuffer);
+    glGenBuffers(1, &m_commandBuffer);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // Same vertex layout as the CPU ray buffer (RayVertex)
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glVertexAttribPointer(Shaders::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, position));
+    glEnableVertexAttribArray(Shaders::ATTRIB_POSITION);
+    glVertexAttribPointer(Shaders::ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, color));
+    glEnableVertexAttribArray(Shaders::ATTRIB_COLOR);
+    glVertexAttribPointer(Shaders::ATTRIB_DASH, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, dash));
+    glEnableVertexAttribArray(Shaders::ATTRIB_DASH);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GpuTracer::ensureSegmentCapacity(std::size_t segments) {
+    if (segments <= m_segmentCapacity) {
+        return;
+    }
+    m_segmentCapacity = segments;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_vertexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_segmentCapacity * 2 * sizeof(RayVertex), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_segmentBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_segmentCapacity * sizeof(SegmentRecord), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuTracer::dispatch(const TraceScene& scene, const TraceSettings& settings) {
+    static_assert(sizeof(RayVertex) == 7 * sizeof(float), "RayVertex must match RAY_VERTEX_FLOATS in the compute shader");
+    static_assert(sizeof(SegmentRecord) == 40, "SegmentRecord must match the std430 layout");
+
+    // Circle 0 is the main object, followed by the obstacles; w is the
+    // reflectance the CPU tracer uses for the circle
+    const CircleView& obstacles = scene.obstacles;
+    m_circleData.resize(obstacles.count + 1);
+    m_circleData[0] = glm::vec4(scene.mainPosition, scene.mainRadius, scene.mainReflectance);
+    for (std::size_t i = 0; i < obstacles.count; ++i) {
+        float reflectance = scene.obstacleColors ? Tracer::reflectance(scene.obstacleColors[i]) : 1.0f;
+        m_circleData[i + 1] = glm::vec4(obstacles.x[i], obstacles.y[i], obstacles.radius[i], reflectance);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_circleSSBO);
+    if (m_circleData.size() > m_circleCapacity) {
+        m_circleCapacity = m_circleData.size() * 2;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_circleCapacity * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_circleData.size() * sizeof(glm::vec4), m_circleData.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    int rayCount = std::max(settings.rayCount, 0);
+    int maxReflections = settings.reflections ? settings.maxReflections : 0;
+    ensureSegmentCapacity(static_cast<std::size_t>(std::max(rayCount, 1)) * (maxReflections + 1));
+
+    // Reset the indirect draw command; the shader accumulates the vertex count
+    DrawCommand command{0, 1, 0, 0};
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawCommand), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    m_lastUploadBytes = m_circleData.size() * sizeof(glm::vec4) + sizeof(DrawCommand);
+
+    glUseProgram(m_program);
+    glUniform2fv(m_uniforms.lightOrigin, 1, glm::value_ptr(scene.lightOrigin));
+    glUniform1i(m_uniforms.rayCount, rayCount);
+    glUniform1i(m_uniforms.circleCount, static_cast<GLint>(m_circleData.size()));
+    glUniform1i(m_uniforms.reflections, settings.reflections ? 1 : 0);
+    glUniform1i(m_uniforms.maxReflections, maxReflections);
+    glUniform1f(m_uniforms.maxRayLength, settings.maxRayLength);
+    glUniform1f(m_uniforms.reflectionLengthFactor, settings.reflectionLengthFactor);
+    glUniform3fv(m_uniforms.primaryColor, 1, glm::value_ptr(settings.primaryColor));
+    glUniform1f(m_uniforms.minEnergy, settings.minEnergy);
+    glUniform1f(m_uniforms.rouletteEnergy, settings.rouletteEnergy);
+    glUniform1f(m_uniforms.attenuationLength, settings.attenuationLength);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Shaders::TRACE_CIRCLES_BINDING, m_circleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Shaders::TRACE_VERTICES_BINDING, m_vertexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Shaders::TRACE_SEGMENTS_BINDING, m_segmentBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Shaders::TRACE_COMMAND_BINDING, m_commandBuffer);
+
+    GLuint groups = (static_cast<GLuint>(rayCount) + Shaders::TRACE_WORKGROUP_SIZE - 1) / Shaders::TRACE_WORKGROUP_SIZE;
+    if (groups > 0) {
+        glDispatchCompute(groups, 1, 1);
+    }
+
+    // Make the vertices and the vertex count visible to the following draw
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void GpuTracer::draw() const {
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glDrawArraysIndirect(GL_LINES, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+GpuTracer::ValidationResult GpuTracer::validate(const TraceScene& scene, const TraceSettings& settings,
+                                                const Tracer& reference) const {
+    ValidationResult result;
+
+    DrawCommand command{};
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawCommand), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    std::vector<SegmentRecord> gpuSegments(std::min<std::size_t>(command.vertexCount / 2, m_segmentCapacity));
+    if (!gpuSegments.empty()) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_segmentBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuSegments.size() * sizeof(SegmentRecord), gpuSegments.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    std::vector<TraceSegment> cpuSegments;
+    reference.trace(scene, settings, cpuSegments);
+
+    result.cpuSegments = cpuSegments.size();
+    result.gpuSegments = gpuSegments.size();
+
+    // GPU segments arrive in atomic append order; restore the CPU order
+    std::sort(gpuSegments.begin(), gpuSegments.end(), [](const SegmentRecord& a, const SegmentRecord& b) {
+        return a.ray != b.ray ? a.ray < b.ray : a.depth < b.depth;
+    });
+
+    // Walk both lists by (ray, depth); unmatched segments count as mismatches
+    std::size_t i = 0, j = 0;
+    while (i < cpuSegments.size() && j < gpuSegments.size()) {
+        const TraceSegment& cpu = cpuSegments[i];
+        const SegmentRecord& gpu = gpuSegments[j];
+        if (cpu.ray != gpu.ray || cpu.depth != gpu.depth) {
+            bool cpuFirst = cpu.ray != gpu.ray ? cpu.ray < gpu.ray : cpu.depth < gpu.depth;
+            result.hitMismatches++;
+            if (cpuFirst) ++i; else ++j;
+            continue;
+        }
+        if (cpu.hitId != gpu.hitId) {
+            result.hitMismatches++;
+        } else {
+            float& maxError = cpu.depth == 0 ? result.maxEndpointError : result.maxReflectedEndpointError;
+            maxError = std::max(maxError, glm::length(cpu.end - gpu.end));
+            glm::vec3 colorError = glm::abs(cpu.color - settings.primaryColor * gpu.energy);
+            result.maxEnergyError = std::max({result.maxEnergyError, colorError.r, colorError.g, colorError.b,
+                                              std::abs(cpu.attenuation - gpu.attenuation)});
+        }
+        ++i;
+        ++j;
+    }
+    result.hitMismatches += (cpuSegments.size() - i) + (gpuSegments.size() - j);
+
+    return result;
+}
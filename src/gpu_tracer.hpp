@@ -0,0 +1,106 @@
+#pragma once
+#include "tracer.hpp"
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+
+// Compute-shader ray caster. Traces the same rays as the CPU Tracer and
+// writes the line vertices straight into a GPU vertex buffer, which is then
+// drawn with glDrawArraysIndirect without any CPU round trip.
+// Requires an OpenGL 4.3+ context (compute shaders, SSBOs, indirect draws).
+class GpuTracer {
+public:
+    // Result of comparing one GPU trace against the CPU reference
+    struct ValidationResult {
+        std::size_t cpuSegments = 0;
+        std::size_t gpuSegments = 0;
+        std::size_t hitMismatches = 0;   // Segments whose hit id differs
+        float maxEndpointError = 0.0f;   // Largest endpoint distance among matching primary segments
+        float maxReflectedEndpointError = 0.0f;  // Same for reflected segments, not checked
+        float maxEnergyError = 0.0f;     // Largest color component or attenuation difference
+        
+        bool passed(float tolerance = ENDPOINT_TOLERANCE) const {
+            return cpuSegments == gpuSegments && hitMismatches == 0 && maxEndpointError <= tolerance &&
+                   maxEnergyError <= ENERGY_TOLERANCE;
+        }
+    };
+    
+    // Endpoint tolerance in world units, covering sin/cos/sqrt precision differences.
+    // Only primary segments are held to it: every bounce between curved
+    // mirrors magnifies those differences (tenfold or more in dense scenes),
+    // so reflected segments are checked by hit id alone.
+    static constexpr float ENDPOINT_TOLERANCE = 0.1f;
+    // Color and attenuation tolerance. Both are energies in [0, 1]; the
+    // endpoint drift above changes them by at most drift / attenuationLength.
+    static constexpr float ENERGY_TOLERANCE = 1e-3f;
+    
+    GpuTracer();
+    ~GpuTracer();
+    GpuTracer(const GpuTracer&) = delete;
+    GpuTracer& operator=(const GpuTracer&) = delete;
+    
+    // Uploads the circles and traces all rays on the GPU
+    void dispatch(const TraceScene& scene, const TraceSettings& settings);
+    
+    // Bytes uploaded by the last dispatch (circle buffer and draw command)
+    std::size_t getLastUploadBytes() const { return m_lastUploadBytes; }
+    
+    // Draws the segments written by the last dispatch as GL_LINES.
+    // The caller binds the scene shader program and generic attributes.
+    void draw() const;
+    
+    // Reads back the last dispatch and diffs it against the CPU tracer.
+    // This stalls the pipeline and is meant for validation only.
+    ValidationResult validate(const TraceScene& scene, const TraceSettings& settings,
+                              const Tracer& reference) const;
+
+private:
+    // Mirrors SegmentRecord in the compute shader (std430)
+    struct SegmentRecord {
+        glm::vec2 origin;
+        glm::vec2 end;
+        int32_t ray;
+        int32_t depth;
+        int32_t hitId;
+        float energy;       // Energy at the origin
+        float attenuation;  // Fraction of it left at the end
+        int32_t padding;
+    };
+    
+    // Mirrors DrawArraysIndirectCommand
+    struct DrawCommand {
+        GLuint vertexCount;
+        GLuint instanceCount;
+        GLuint firstVertex;
+        GLuint baseInstance;
+    };
+    
+    GLuint m_program = 0;
+    GLuint m_circleSSBO = 0;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_segmentBuffer = 0;
+    GLuint m_commandBuffer = 0;
+    GLuint m_VAO = 0;
+    std::size_t m_circleCapacity = 0;
+    std::size_t m_segmentCapacity = 0;
+    std::vector<glm::vec4> m_circleData;
+    std::size_t m_lastUploadBytes = 0;
+    
+    struct {
+        GLint lightOrigin;
+        GLint rayCount;
+        GLint circleCount;
+        GLint reflections;
+        GLint maxReflections;
+        GLint maxRayLength;
+        GLint reflectionLengthFactor;
+        GLint primaryColor;
+        GLint minEnergy;
+        GLint rouletteEnergy;
+        GLint attenuationLength;
+    } m_uniforms;
+    
+    void initProgram();
+    void initBuffers();
+    void ensureSegmentCapacity(std::size_t segments);
+};
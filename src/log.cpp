@@ -0,0 +1,258 @@
+#include "log.hpp"
+#include "platform.hpp"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Runtime default: Info for every category
+std::atomic<uint8_t> Log::s_levels[static_cast<int>(LogCategory::COUNT)] = {1, 1, 1, 1, 1, 1, 1};
+
+namespace {
+
+static_assert((Log::RING_CAPACITY & (Log::RING_CAPACITY - 1)) == 0, "Ring capacity must be a power of two");
+
+constexpr int CATEGORY_COUNT = static_cast<int>(LogCategory::COUNT);
+constexpr uint32_t RATE_WINDOW_MS = 1000;
+
+const char* const LEVEL_NAMES[] = {"debug", "info", "warning", "error", "off"};
+const char* const CATEGORY_NAMES[] = {"general", "scene", "layout", "renderer", "gl", "tracing", "profiler"};
+static_assert(sizeof(CATEGORY_NAMES) / sizeof(CATEGORY_NAMES[0]) == CATEGORY_COUNT, "Missing category name");
+
+// Slot of the bounded multi-producer queue (Vyukov): sequence == position
+// means free for the producer claiming that position, position + 1 means
+// filled and ready for the consumer
+struct Message {
+    std::atomic<uint64_t> sequence{0};
+    uint64_t timeNs = 0;
+    LogCategory category = LogCategory::General;
+    LogLevel level = LogLevel::Info;
+    char text[Log::MAX_MESSAGE_LENGTH];
+};
+
+// Messages of one category in the current one-second window. The window
+// start (ms since the log started, high half) and the message count (low
+// half) share one word, so a reset and the counting cannot interleave.
+struct RateWindow {
+    std::atomic<uint64_t> window{0};
+    std::atomic<uint64_t> suppressed{0};
+    uint64_t reported = 0;  // Writer thread only
+};
+
+struct LogState {
+    Message ring[Log::RING_CAPACITY];
+    std::atomic<uint64_t> enqueuePosition{0};
+    std::atomic<uint64_t> dequeuePosition{0};  // Advanced by the writer thread only
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint32_t> rateLimit{Log::DEFAULT_RATE_LIMIT};
+    RateWindow rates[CATEGORY_COUNT];
+    uint64_t startNs = Platform::monotonicNanoseconds();
+    
+    std::once_flag startFlag;
+    std::thread writer;
+    std::atomic<bool> running{false};
+    
+    LogState() {
+        for (std::size_t i = 0; i < Log::RING_CAPACITY; ++i) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    ~LogState() {
+        if (writer.joinable()) {
+            running.store(false, std::memory_order_release);
+            writer.join();
+        }
+    }
+    
+    void start() {
+        std::call_once(startFlag, [this]() {
+            running.store(true, std::memory_order_release);
+            writer = std::thread([this]() { run(); });
+        });
+    }
+    
+    // Writes every ready message; returns false if there was none
+    bool drain() {
+        bool wroteAny = false;
+        uint64_t position = dequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Message& message = ring[position & (Log::RING_CAPACITY - 1)];
+            if (message.sequence.load(std::memory_order_acquire) != position + 1) break;
+            
+            std::ostream& out = message.level >= LogLevel::Warning ? std::cerr : std::cout;
+            char prefix[64];
+            std::snprintf(prefix, sizeof(prefix), "[%9.3f] %-7s %s: ", (message.timeNs - startNs) / 1e9,
+                          LEVEL_NAMES[static_cast<int>(message.level)],
+                          CATEGORY_NAMES[static_cast<int>(message.category)]);
+            out << prefix << message.text << '\n';
+            
+            message.sequence.store(position + Log::RING_CAPACITY, std::memory_order_release);
+            dequeuePosition.store(++position, std::memory_order_release);
+            wroteAny = true;
+        }
+        
+        for (int category = 0; category < CATEGORY_COUNT; ++category) {
+            RateWindow& rate = rates[category];
+            uint64_t suppressed = rate.suppressed.load(std::memory_order_relaxed);
+            if (suppressed != rate.reported) {
+                std::cerr << "[log] " << (suppressed - rate.reported) << " " << CATEGORY_NAMES[category]
+                          << " messages suppressed by the rate limit\n";
+                rate.reported = suppressed;
+                wroteAny = true;
+            }
+        }
+        if (wroteAny) {
+            std::cout.flush();
+            std::cerr.flush();
+        }
+        return wroteAny;
+    }
+    
+    void run() {
+        // Polls rather than being signalled so producers never touch a lock
+        while (running.load(std::memory_order_acquire)) {
+            if (!drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+        drain();
+    }
+    
+    bool allow(LogCategory category, uint64_t now) {
+        uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+        if (limit == 0) return true;
+        RateWindow& rate = rates[static_cast<int>(category)];
+        // Wraps after 49 days, which the modular difference below tolerates
+        uint32_t nowMs = static_cast<uint32_t>((now - startNs) / 1000000);
+        uint64_t window = rate.window.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t windowStart = static_cast<uint32_t>(window >> 32);
+            uint32_t count = static_cast<uint32_t>(window);
+            uint64_t next;
+            if (nowMs - windowStart >= RATE_WINDOW_MS) {
+                next = (static_cast<uint64_t>(nowMs) << 32) | 1;
+            } else if (count < limit) {
+                next = window + 1;
+            } else {
+                rate.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (rate.window.compare_exchange_weak(window, next, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+};
+
+LogState& state() {
+    static LogState s_state;
+    return s_state;
+}
+
+}
+
+void Log::setLevel(LogCategory category, LogLevel level) {
+    s_levels[static_cast<int>(category)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+void Log::setLevel(LogLevel level) {
+    for (int category = 0; category < CATEGORY_COUNT; ++category) {
+        setLevel(static_cast<LogCategory>(category), level);
+    }
+}
+
+void Log::setRateLimit(uint32_t messagesPerSecond) {
+    state().rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+}
+
+uint32_t Log::getRateLimit() {
+    return state().rateLimit.load(std::memory_order_relaxed);
+}
+
+void Log::write(LogCategory category, LogLevel level, const char* format, ...) {
+    LogState& log = state();
+    uint64_t now = Platform::monotonicNanoseconds();
+    if (!log.allow(category, now)) return;
+    log.start();
+    
+    // Claim a slot; a full ring drops the message rather than waiting
+    Message* message;
+    uint64_t position = log.enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        message = &log.ring[position & (RING_CAPACITY - 1)];
+        uint64_t sequence = message->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence - position);
+        if (difference == 0) {
+            if (log.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            log.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = log.enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+    
+    message->timeNs = now;
+    message->category = category;
+    message->level = level;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(message->text, MAX_MESSAGE_LENGTH, format, args);
+    va_end(args);
+    message->sequence.store(position + 1, std::memory_order_release);
+}
+
+void Log::flush() {
+    LogState& log = state();
+    uint64_t target = log.enqueuePosition.load(std::memory_order_acquire);
+    while (log.running.load(std::memory_order_acquire) &&
+           log.dequeuePosition.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+uint64_t Log::getDroppedMessages() {
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t Log::getSuppressedMessages() {
+    uint64_t total = 0;
+    for (const RateWindow& rate : state().rates) {
+        total += rate.suppressed.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+const char* Log::levelName(LogLevel level) {
+    return LEVEL_NAMES[static_cast<int>(level)];
+}
+
+const char* Log::categoryName(LogCategory category) {
+    return CATEGORY_NAMES[static_cast<int>(category)];
+}
+
+bool Log::parseLevel(const char* name, LogLevel& level) {
+    for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i) {
+        if (std::strcmp(name, LEVEL_NAMES[i]) == 0) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Log::parseCategory(const char* name, LogCategory& category) {
+    for (int i = 0; i < CATEGORY_COUNT; ++i) {
+        if (std::strcmp(name, CATEGORY_NAMES[i]) == 0) {
+            category = static_cast<LogCategory>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Asynchronous logging.
+//
+// LOG_INFO(Scene, "format", ...) formats a printf-style message straight
+// into a slot of a bounded lock-free ring (multiple producers, one
+// consumer) and returns; a background thread drains the ring and writes
+// the lines to stdout (warnings and errors to stderr). A full ring drops
+// the message instead of waiting, so logging never stalls the caller.
+//
+// Each category has a runtime level, and each category is rate limited
+// to getRateLimit() messages per second; suppressed messages are counted
+// and reported by the writer thread. Levels below LOG_COMPILED_LEVEL are
+// removed at compile time together with their arguments.
+enum class LogLevel : uint8_t { Debug, Info, Warning, Error, Off };
+
+enum class LogCategory : uint8_t { General, Scene, Layout, Renderer, GL, Tracing, Profiler, COUNT };
+
+// Lowest level compiled in: 0 debug, 1 info, 2 warning, 3 error, 4 none
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL 1
+#else
+#define LOG_COMPILED_LEVEL 0
+#endif
+#endif
+
+// True if messages at level are compiled in. At LOG_COMPILED_LEVEL 0 the
+// comparison would always be true, which -Wtype-limits reports.
+constexpr bool isLogLevelCompiled(LogLevel level) {
+#if LOG_COMPILED_LEVEL > 0
+    return static_cast<int>(level) >= LOG_COMPILED_LEVEL;
+#else
+    static_cast<void>(level);
+    return true;
+#endif
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+class Log {
+public:
+    // Ring capacity in messages (power of two)
+    static constexpr std::size_t RING_CAPACITY = 1024;
+    // Longer messages are truncated
+    static constexpr std::size_t MAX_MESSAGE_LENGTH = 240;
+    static constexpr uint32_t DEFAULT_RATE_LIMIT = 50;
+    
+    static bool isEnabled(LogCategory category, LogLevel level) {
+        return level >= static_cast<LogLevel>(s_levels[static_cast<int>(category)].load(std::memory_order_relaxed));
+    }
+    // Messages below level are discarded; Info for every category by default
+    static void setLevel(LogCategory category, LogLevel level);
+    static void setLevel(LogLevel level);
+    
+    // Messages per second and category; 0 disables rate limiting
+    static void setRateLimit(uint32_t messagesPerSecond);
+    static uint32_t getRateLimit();
+    
+    // Queues one message; use the LOG_* macros instead
+    static void write(LogCategory category, LogLevel level, const char* format, ...) LOG_PRINTF_FORMAT(3, 4);
+    
+    // Waits until every message queued so far has been written
+    static void flush();
+    
+    // Messages lost because the ring was full / held back by the rate limit
+    static uint64_t getDroppedMessages();
+    static uint64_t getSuppressedMessages();
+    
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+    // Case-sensitive lower-case names as printed; false if unknown
+    static bool parseLevel(const char* name, LogLevel& level);
+    static bool parseCategory(const char* name, LogCategory& category);
+
+private:
+    static std::atomic<uint8_t> s_levels[static_cast<int>(LogCategory::COUNT)];
+};
+
+#define LOG_AT(levelValue, category, ...)                                                   \
+    do {                                                                                    \
+        if constexpr (isLogLevelCompiled(LogLevel::levelValue)) {                           \
+            if (Log::isEnabled(LogCategory::category, LogLevel::levelValue)) {              \
+                Log::write(LogCategory::category, LogLevel::levelValue, __VA_ARGS__);       \
+            }                                                                               \
+        }                                                                                   \
+    } while (0)
+
+#define LOG_DEBUG(category, ...) LOG_AT(Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_AT(Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) LOG_AT(Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_AT(Error, category, __VA_ARGS__)
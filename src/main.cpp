@@ -1,12 +1,125 @@
 #include "window.hpp"
 #include "renderer.hpp"
+#include "profiler.hpp"
+#include "log.hpp"
 #include <stdexcept>
 #include <iostream>
+#include <string>
+#include <memory>
 
-int main() {
+// Usage: RayTracerNG [--profile-capture <seconds> [<file.json>]]
+//                    [--present vsync|uncapped|<fps>]
+//                    [--fixed-frame-time <ms>] [--seed <n>]
+//                    [--log-level [<category>=]<level>]... [--log-rate <n>]
+//                    [--trace-kernel scalar|simd|grid] [--moving-obstacles <speed>]
+//
+// --profile-capture records the profiler scopes of every thread from
+// startup and writes them as Chrome trace-event JSON (default profile.json).
+// --present selects vsync (default), no limit, or a frame rate cap.
+// --fixed-frame-time advances the simulation by a constant interval per
+// frame instead of wall-clock time; with --seed the light's auto-move
+// path is reproducible from run to run.
+// --log-level sets the level (debug, info, warning, error, off) of one
+// category or all of them; --log-rate caps messages per second and
+// category (0 for no limit).
+// --trace-kernel picks the CPU tracing kernel; --moving-obstacles starts
+// the moving-obstacles stress mode at the given speed (units per second).
+int main(int argc, char** argv) {
     try {
+        double captureSeconds = 0.0;
+        std::string capturePath = "profile.json";
+        std::string present = "vsync";
+        double fixedFrameMs = 0.0;
+        bool hasSeed = false;
+        uint32_t seed = 0;
+        TraceKernel traceKernel = TraceKernel::Simd;
+        float obstacleSpeed = 0.0f;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--profile-capture" && i + 1 < argc) {
+                captureSeconds = std::stod(argv[++i]);
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    capturePath = argv[++i];
+                }
+            } else if (arg == "--present" && i + 1 < argc) {
+                present = argv[++i];
+            } else if (arg == "--fixed-frame-time" && i + 1 < argc) {
+                fixedFrameMs = std::stod(argv[++i]);
+                if (fixedFrameMs <= 0.0) {
+                    throw std::runtime_error("--fixed-frame-time must be positive");
+                }
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+                hasSeed = true;
+            } else if (arg == "--log-level" && i + 1 < argc) {
+                std::string setting = argv[++i];
+                std::size_t separator = setting.find('=');
+                std::string levelName = separator == std::string::npos ? setting : setting.substr(separator + 1);
+                LogLevel level;
+                if (!Log::parseLevel(levelName.c_str(), level)) {
+                    throw std::runtime_error("Unknown log level: " + levelName);
+                }
+                if (separator == std::string::npos) {
+                    Log::setLevel(level);
+                } else {
+                    std::string categoryName = setting.substr(0, separator);
+                    LogCategory category;
+                    if (!Log::parseCategory(categoryName.c_str(), category)) {
+                        throw std::runtime_error("Unknown log category: " + categoryName);
+                    }
+                    Log::setLevel(category, level);
+                }
+            } else if (arg == "--log-rate" && i + 1 < argc) {
+                Log::setRateLimit(static_cast<uint32_t>(std::stoul(argv[++i])));
+            } else if (arg == "--trace-kernel" && i + 1 < argc) {
+                std::string kernel = argv[++i];
+                if (kernel == "scalar") {
+                    traceKernel = TraceKernel::Scalar;
+                } else if (kernel == "simd") {
+                    traceKernel = TraceKernel::Simd;
+                } else if (kernel == "grid") {
+                    traceKernel = TraceKernel::Grid;
+                } else {
+                    throw std::runtime_error("--trace-kernel expects scalar, simd or grid");
+                }
+            } else if (arg == "--moving-obstacles" && i + 1 < argc) {
+                obstacleSpeed = std::stof(argv[++i]);
+                if (obstacleSpeed <= 0.0f) {
+                    throw std::runtime_error("--moving-obstacles expects a positive speed");
+                }
+            } else {
+                throw std::runtime_error("Unknown argument: " + arg);
+            }
+        }
+        
         Window window(1280, 720, "RayTracer NG");
-        Renderer renderer(window);
+        std::unique_ptr<SimulationClock> clock;
+        if (fixedFrameMs > 0.0) {
+            clock = std::make_unique<FixedFrameClock>(fixedFrameMs / 1000.0);
+        }
+        Renderer renderer(window, std::move(clock));
+        if (present == "vsync") {
+            renderer.setPresentMode(Renderer::PresentMode::Vsync);
+        } else if (present == "uncapped") {
+            renderer.setPresentMode(Renderer::PresentMode::Uncapped);
+        } else {
+            int fps = std::stoi(present);
+            if (fps <= 0) {
+                throw std::runtime_error("--present expects vsync, uncapped or a positive frame rate");
+            }
+            renderer.setPresentMode(Renderer::PresentMode::Limited, fps);
+        }
+        if (hasSeed) {
+            renderer.getScene().setRandomSeed(seed);
+        }
+        renderer.getScene().setCpuTraceKernel(traceKernel);
+        if (obstacleSpeed > 0.0f) {
+            renderer.getScene().setObstacleSpeed(obstacleSpeed);
+            renderer.getScene().setObstaclesMoving(true);
+        }
+        if (captureSeconds > 0.0) {
+            Profiler::startCapture(capturePath, captureSeconds);
+        }
 
         while (!window.shouldClose()) {
             renderer.beginFrame();
@@ -18,6 +131,7 @@ int main() {
         return 0;
     }
     catch (const std::exception& e) {
+        Log::flush();
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping
+// object on Windows). The mapping lives as long as the object.
+class MappedFile {
+public:
+    // Throws std::runtime_error if the file cannot be opened or mapped.
+    // Empty files cannot be mapped and are reported as errors.
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    const unsigned char* data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+private:
+    const unsigned char* m_data = nullptr;
+    uint64_t m_size = 0;
+    
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    
+    void unmap();
+};
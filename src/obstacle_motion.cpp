@@ -0,0 +1,176 @@
+#include "obstacle_motion.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+ObstacleMotion::ObstacleMotion(unsigned int threadCount)
+    : m_threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())) {
+    if (m_threadCount > 1) {
+        m_pool = std::make_unique<WorkerPool>(m_threadCount - 1, "Motion worker");
+    }
+}
+
+void ObstacleMotion::reset(std::size_t count, float speed, std::mt19937& random) {
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * 3.14159265f);
+    m_velocityX.resize(count);
+    m_velocityY.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        float a = angle(random);
+        m_velocityX[i] = std::cos(a) * speed;
+        m_velocityY[i] = std::sin(a) * speed;
+    }
+}
+
+void ObstacleMotion::step(ObstacleStore& obstacles, const CircleView& fixed, const OccluderView& walls,
+                          const glm::vec2& boundsMin, const glm::vec2& boundsMax, float dt) {
+    PROFILE_SCOPE("ObstacleMotion::step");
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    
+    std::size_t count = obstacles.size();
+    if (count != m_velocityX.size()) {
+        throw std::runtime_error("Obstacle motion was not reset for the current obstacles");
+    }
+    CircleView circles = obstacles.view();
+    {
+        PROFILE_SCOPE("Build obstacle hash");
+        m_hash.build(circles);
+    }
+    m_nextX.resize(count);
+    m_nextY.resize(count);
+    m_nextVelocityX.resize(count);
+    m_nextVelocityY.resize(count);
+    
+    std::size_t threads = std::min<std::size_t>(m_threadCount, std::max<std::size_t>(1, count / MIN_CIRCLES_PER_THREAD));
+    m_threadContacts.assign(threads, 0);
+    auto rangeBegin = [&](std::size_t t) { return count * t / threads; };
+    auto work = [&](unsigned int t) {
+        stepRange(circles, fixed, walls, boundsMin, boundsMax, dt, rangeBegin(t), rangeBegin(t + 1),
+                  m_threadContacts[t]);
+    };
+    if (threads <= 1 || !m_pool) {
+        work(0);
+    } else {
+        m_pool->run(static_cast<unsigned int>(threads), work);
+    }
+    
+    obstacles.swapPositions(m_nextX, m_nextY);
+    m_velocityX.swap(m_nextVelocityX);
+    m_velocityY.swap(m_nextVelocityY);
+    
+    m_lastContacts = 0;
+    for (uint64_t contacts : m_threadContacts) {
+        m_lastContacts += contacts;
+    }
+    m_lastStepMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void ObstacleMotion::stepRange(const CircleView& circles, const CircleView& fixed, const OccluderView& walls,
+                               const glm::vec2& boundsMin, const glm::vec2& boundsMax, float dt, std::size_t first,
+                               std::size_t last, uint64_t& contacts) {
+    PROFILE_SCOPE("Step obstacle range");
+    uint32_t touching[MAX_CONTACTS];
+    
+    for (std::size_t i = first; i < last; ++i) {
+        glm::vec2 position(circles.x[i], circles.y[i]);
+        glm::vec2 velocity(m_velocityX[i], m_velocityY[i]);
+        float radius = circles.radius[i];
+        float mass = radius * radius;
+        
+        // Each side of a contact applies its own half of the separation and
+        // of the velocity exchange, weighted by the other side's mass
+        glm::vec2 push(0.0f);
+        glm::vec2 velocityChange(0.0f);
+        int touchingCount = 0;
+        m_hash.query(position - glm::vec2(radius), position + glm::vec2(radius), [&](uint32_t j) {
+            if (j == i || touchingCount == MAX_CONTACTS) return;
+            glm::vec2 offset = position - glm::vec2(circles.x[j], circles.y[j]);
+            float radiusSum = radius + circles.radius[j];
+            float distanceSq = glm::dot(offset, offset);
+            if (distanceSq >= radiusSum * radiusSum) return;
+            // The hash can report a circle more than once
+            for (int k = 0; k < touchingCount; ++k) {
+                if (touching[k] == j) return;
+            }
+            touching[touchingCount++] = j;
+            
+            float distance = std::sqrt(distanceSq);
+            glm::vec2 normal = distance > 0.0f ? offset / distance : glm::vec2(i < j ? 1.0f : -1.0f, 0.0f);
+            float otherMass = circles.radius[j] * circles.radius[j];
+            float share = otherMass / (mass + otherMass);
+            push += normal * ((radiusSum - distance) * share);
+            float approach = glm::dot(velocity - glm::vec2(m_velocityX[j], m_velocityY[j]), normal);
+            if (approach < 0.0f) {
+                velocityChange -= normal * (2.0f * share * approach);
+            }
+        });
+        contacts += static_cast<uint64_t>(touchingCount);
+        
+        // Fixed circles take the whole separation and reflect the velocity
+        for (std::size_t j = 0; j < fixed.count; ++j) {
+            glm::vec2 offset = position - glm::vec2(fixed.x[j], fixed.y[j]);
+            float radiusSum = radius + fixed.radius[j];
+            float distanceSq = glm::dot(offset, offset);
+            if (distanceSq >= radiusSum * radiusSum) continue;
+            float distance = std::sqrt(distanceSq);
+            glm::vec2 normal = distance > 0.0f ? offset / distance : glm::vec2(1.0f, 0.0f);
+            push += normal * (radiusSum - distance);
+            float approach = glm::dot(velocity, normal);
+            if (approach < 0.0f) {
+                velocityChange -= normal * (2.0f * approach);
+            }
+        }
+        
+        velocity += velocityChange;
+        float speed = glm::length(velocity);
+        if (speed > MAX_SPEED) {
+            velocity *= MAX_SPEED / speed;
+        }
+        glm::vec2 move = push + velocity * dt;
+        
+        // Walls stop the move at the first contact and reflect the velocity
+        // off the contact normal
+        float wallT;
+        glm::vec2 wallContact;
+        if (!walls.empty() && Collision::sweepWalls(walls, position, move, radius, wallT, wallContact)) {
+            float length = glm::length(move);
+            float travel = std::max(0.0f, wallT * length - Collision::CONTACT_SKIN);
+            position += move * (length > 0.0f ? travel / length : 0.0f);
+            glm::vec2 normal = position - wallContact;
+            float normalLength = glm::length(normal);
+            if (normalLength > 0.0f) {
+                normal /= normalLength;
+                float approach = glm::dot(velocity, normal);
+                if (approach < 0.0f) {
+                    velocity -= normal * (2.0f * approach);
+                }
+            }
+        } else {
+            position += move;
+        }
+        
+        // Bounce off the bounds
+        if (position.x - radius < boundsMin.x) {
+            position.x = boundsMin.x + radius;
+            velocity.x = std::abs(velocity.x);
+        } else if (position.x + radius > boundsMax.x) {
+            position.x = boundsMax.x - radius;
+            velocity.x = -std::abs(velocity.x);
+        }
+        if (position.y - radius < boundsMin.y) {
+            position.y = boundsMin.y + radius;
+            velocity.y = std::abs(velocity.y);
+        } else if (position.y + radius > boundsMax.y) {
+            position.y = boundsMax.y - radius;
+            velocity.y = -std::abs(velocity.y);
+        }
+        
+        m_nextX[i] = position.x;
+        m_nextY[i] = position.y;
+        m_nextVelocityX[i] = velocity.x;
+        m_nextVelocityY[i] = velocity.y;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "obstacle_store.hpp"
+#include "spatial_hash.hpp"
+#include "worker_pool.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Moving obstacles for the dynamic-scene stress mode. Velocities are kept
+// next to the ObstacleStore in the same structure-of-arrays layout; each
+// step finds overlapping circles through a SpatialHash, resolves them as
+// elastic collisions between masses proportional to area, moves every
+// circle and bounces it off the walls and the bounds.
+//
+// Steps are split into contiguous index ranges across a WorkerPool. A circle's
+// response is computed only from the state at the start of the step and
+// written only to its own slot, so the result does not depend on the
+// thread count.
+class ObstacleMotion {
+public:
+    static constexpr float DEFAULT_SPEED = 60.0f;  // Units per second
+    static constexpr float MAX_SPEED = 400.0f;
+    // Fewer circles than this per thread are stepped on the calling thread only
+    static constexpr std::size_t MIN_CIRCLES_PER_THREAD = 4096;
+    // Overlaps resolved per circle and step; deeper piles settle over steps
+    static constexpr int MAX_CONTACTS = 16;
+    
+    // threadCount 0 uses all hardware threads
+    explicit ObstacleMotion(unsigned int threadCount = 0);
+    
+    // Gives count obstacles random directions at the given speed
+    void reset(std::size_t count, float speed, std::mt19937& random);
+    std::size_t size() const { return m_velocityX.size(); }
+    
+    // Advances the obstacles by dt inside [boundsMin, boundsMax]. The fixed
+    // circles (light and main object) push obstacles away but do not move;
+    // walls reflect an obstacle at the first contact along its move.
+    void step(ObstacleStore& obstacles, const CircleView& fixed, const OccluderView& walls,
+              const glm::vec2& boundsMin, const glm::vec2& boundsMax, float dt);
+    
+    // Counters of the last step
+    uint64_t getLastContactCount() const { return m_lastContacts; }
+    double getLastStepMs() const { return m_lastStepMs; }
+
+private:
+    unsigned int m_threadCount;
+    std::unique_ptr<WorkerPool> m_pool;  // threadCount - 1 workers, none if single-threaded
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+    
+    // Next state, swapped in once every range is done
+    std::vector<float> m_nextX;
+    std::vector<float> m_nextY;
+    std::vector<float> m_nextVelocityX;
+    std::vector<float> m_nextVelocityY;
+    
+    SpatialHash m_hash;
+    std::vector<uint64_t> m_threadContacts;
+    uint64_t m_lastContacts = 0;
+    double m_lastStepMs = 0.0;
+    
+    void stepRange(const CircleView& circles, const CircleView& fixed, const OccluderView& walls,
+                   const glm::vec2& boundsMin, const glm::vec2& boundsMax, float dt, std::size_t first,
+                   std::size_t last, uint64_t& contacts);
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Read-only view of circles in structure-of-arrays layout.
+// The arrays may live in an ObstacleStore or in any other flat block.
+struct CircleView {
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* radius = nullptr;
+    std::size_t count = 0;
+};
+
+// Obstacle storage as parallel arrays. Positions and radii are kept in
+// separate contiguous arrays so intersection loops stream only what they use.
+// Each obstacle also has an index of refraction: OPAQUE obstacles are
+// mirrors, refractive ones (ior > 0) split rays into reflected and
+// transmitted parts (see Tracer).
+class ObstacleStore {
+public:
+    static constexpr float OPAQUE = 0.0f;
+    
+
+    std::size_t size() const { return m_x.size(); }
+    bool empty() const { return m_x.empty(); }
+    
+    void clear() {
+        m_x.clear();
+        m_y.clear();
+        m_radius.clear();
+        m_color.clear();
+        m_ior.clear();
+        m_refractiveCount = 0;
+    }
+    
+    void reserve(std::size_t count) {
+        m_x.reserve(count);
+        m_y.reserve(count);
+        m_radius.reserve(count);
+        m_color.reserve(count);
+        m_ior.reserve(count);
+    }
+    
+    void add(const glm::vec2& position, float radius, const glm::vec3& color, float ior = OPAQUE) {
+        m_x.push_back(position.x);
+        m_y.push_back(position.y);
+        m_radius.push_back(radius);
+        m_color.push_back(color);
+        m_ior.push_back(ior);
+        m_refractiveCount += ior > 0.0f;
+    }
+    
+    glm::vec2 getPosition(std::size_t i) const { return glm::vec2(m_x[i], m_y[i]); }
+    void setPosition(std::size_t i, const glm::vec2& position) {
+        m_x[i] = position.x;
+        m_y[i] = position.y;
+    }
+    // Exchanges the position arrays with same-sized ones, for simulations
+    // that write the next positions into a second buffer
+    void swapPositions(std::vector<float>& x, std::vector<float>& y) {
+        m_x.swap(x);
+        m_y.swap(y);
+    }
+    float getRadius(std::size_t i) const { return m_radius[i]; }
+    const glm::vec3& getColor(std::size_t i) const { return m_color[i]; }
+    float getIor(std::size_t i) const { return m_ior[i]; }
+    void setIor(std::size_t i, float ior) {
+        m_refractiveCount += (ior > 0.0f) - (m_ior[i] > 0.0f);
+        m_ior[i] = ior;
+    }
+    std::size_t refractiveCount() const { return m_refractiveCount; }
+    
+    CircleView view() const { return CircleView{m_x.data(), m_y.data(), m_radius.data(), m_x.size()}; }
+    const glm::vec3* colors() const { return m_color.data(); }
+    const float* iors() const { return m_ior.data(); }
+
+private:
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_radius;
+    std::vector<glm::vec3> m_color;
+    std::vector<float> m_ior;
+    std::size_t m_refractiveCount = 0;
+};
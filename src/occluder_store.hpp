@@ -0,0 +1,181 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Read-only view of line segments in structure-of-arrays layout
+struct SegmentView {
+    const float* x0 = nullptr;
+    const float* y0 = nullptr;
+    const float* x1 = nullptr;
+    const float* y1 = nullptr;
+    std::size_t count = 0;
+};
+
+// Read-only view of circular arcs. A point on the circle belongs to the arc
+// if it lies within the half span of the arc's middle direction:
+// dot(point - center, middle) >= cosHalfSpan * radius. This keeps the
+// intersection test free of trigonometry.
+struct ArcView {
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* radius = nullptr;
+    const float* middleX = nullptr;
+    const float* middleY = nullptr;
+    const float* cosHalfSpan = nullptr;
+    std::size_t count = 0;
+};
+
+// Thin occluders (walls) traced alongside the circles
+struct OccluderView {
+    SegmentView segments;
+    SegmentView polygonEdges;  // Edges of every polygon, polygon by polygon
+    ArcView arcs;
+    
+    std::size_t count() const { return segments.count + polygonEdges.count + arcs.count; }
+    bool empty() const { return count() == 0; }
+};
+
+// Segment, polygon and arc occluders, one set of parallel arrays per type.
+// Polygons are closed and kept as their edges, so they are traced by the
+// same kernels as segments.
+class OccluderStore {
+public:
+    std::size_t segmentCount() const { return m_segments.x0.size(); }
+    std::size_t polygonCount() const { return m_polygonStart.size() - 1; }
+    std::size_t arcCount() const { return m_arcX.size(); }
+    bool empty() const { return segmentCount() == 0 && polygonCount() == 0 && arcCount() == 0; }
+    
+    void clear() {
+        m_segments.clear();
+        m_polygonEdges.clear();
+        m_polygonStart.assign(1, 0);
+        for (std::vector<float>* array : {&m_arcX, &m_arcY, &m_arcRadius, &m_arcMiddleX, &m_arcMiddleY,
+                                          &m_arcCosHalfSpan, &m_arcStartAngle, &m_arcEndAngle}) {
+            array->clear();
+        }
+    }
+    
+    void addSegment(const glm::vec2& from, const glm::vec2& to) { m_segments.add(from, to); }
+    
+    // The edge from the last point back to the first is implied. Throws
+    // std::runtime_error for fewer than three points.
+    void addPolygon(const std::vector<glm::vec2>& points) {
+        if (points.size() < 3) {
+            throw std::runtime_error("A polygon needs at least three points");
+        }
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            m_polygonEdges.add(points[i], points[(i + 1) % points.size()]);
+        }
+        m_polygonStart.push_back(static_cast<uint32_t>(m_polygonEdges.x0.size()));
+    }
+    
+    // Counter-clockwise from startAngle to endAngle, in radians; a span of
+    // 2 pi or more is a full circle
+    void addArc(const glm::vec2& center, float radius, float startAngle, float endAngle) {
+        float span = arcSpan(startAngle, endAngle);
+        float middle = startAngle + span / 2.0f;
+        m_arcX.push_back(center.x);
+        m_arcY.push_back(center.y);
+        m_arcRadius.push_back(radius);
+        m_arcMiddleX.push_back(std::cos(middle));
+        m_arcMiddleY.push_back(std::sin(middle));
+        m_arcCosHalfSpan.push_back(span >= TWO_PI ? -1.0f : std::cos(span / 2.0f));
+        m_arcStartAngle.push_back(startAngle);
+        m_arcEndAngle.push_back(endAngle);
+    }
+    
+    glm::vec2 getSegmentStart(std::size_t i) const { return glm::vec2(m_segments.x0[i], m_segments.y0[i]); }
+    glm::vec2 getSegmentEnd(std::size_t i) const { return glm::vec2(m_segments.x1[i], m_segments.y1[i]); }
+    
+    std::size_t getPolygonVertexCount(std::size_t p) const { return m_polygonStart[p + 1] - m_polygonStart[p]; }
+    glm::vec2 getPolygonVertex(std::size_t p, std::size_t k) const {
+        std::size_t edge = m_polygonStart[p] + k;
+        return glm::vec2(m_polygonEdges.x0[edge], m_polygonEdges.y0[edge]);
+    }
+    
+    glm::vec2 getArcCenter(std::size_t i) const { return glm::vec2(m_arcX[i], m_arcY[i]); }
+    float getArcRadius(std::size_t i) const { return m_arcRadius[i]; }
+    float getArcStartAngle(std::size_t i) const { return m_arcStartAngle[i]; }
+    float getArcEndAngle(std::size_t i) const { return m_arcEndAngle[i]; }
+    
+    // Calls line(from, to) for every straight piece of the outlines, arcs
+    // split into pieces of at most maxArcStep radians; used for drawing
+    template <typename OnLine>
+    void forEachOutlineLine(float maxArcStep, OnLine&& line) const {
+        for (const SegmentArrays* segments : {&m_segments, &m_polygonEdges}) {
+            for (std::size_t i = 0; i < segments->x0.size(); ++i) {
+                line(glm::vec2(segments->x0[i], segments->y0[i]), glm::vec2(segments->x1[i], segments->y1[i]));
+            }
+        }
+        for (std::size_t i = 0; i < arcCount(); ++i) {
+            float span = std::min(arcSpan(m_arcStartAngle[i], m_arcEndAngle[i]), TWO_PI);
+            int pieces = std::max(1, static_cast<int>(std::ceil(span / maxArcStep)));
+            glm::vec2 center = getArcCenter(i);
+            glm::vec2 previous = center + m_arcRadius[i] * glm::vec2(std::cos(m_arcStartAngle[i]), std::sin(m_arcStartAngle[i]));
+            for (int k = 1; k <= pieces; ++k) {
+                float angle = m_arcStartAngle[i] + span * static_cast<float>(k) / static_cast<float>(pieces);
+                glm::vec2 next = center + m_arcRadius[i] * glm::vec2(std::cos(angle), std::sin(angle));
+                line(previous, next);
+                previous = next;
+            }
+        }
+    }
+    
+    OccluderView view() const {
+        return OccluderView{m_segments.view(), m_polygonEdges.view(),
+                            ArcView{m_arcX.data(), m_arcY.data(), m_arcRadius.data(), m_arcMiddleX.data(),
+                                    m_arcMiddleY.data(), m_arcCosHalfSpan.data(), m_arcX.size()}};
+    }
+
+private:
+    static constexpr float TWO_PI = 6.28318531f;
+    
+    // Counter-clockwise span in (0, 2 pi), or the difference itself if it is
+    // 2 pi or more
+    static float arcSpan(float startAngle, float endAngle) {
+        float span = endAngle - startAngle;
+        if (span < TWO_PI) {
+            span -= TWO_PI * std::floor(span / TWO_PI);
+        }
+        return span;
+    }
+    
+    struct SegmentArrays {
+        std::vector<float> x0;
+        std::vector<float> y0;
+        std::vector<float> x1;
+        std::vector<float> y1;
+        
+        void add(const glm::vec2& from, const glm::vec2& to) {
+            x0.push_back(from.x);
+            y0.push_back(from.y);
+            x1.push_back(to.x);
+            y1.push_back(to.y);
+        }
+        void clear() {
+            x0.clear();
+            y0.clear();
+            x1.clear();
+            y1.clear();
+        }
+        SegmentView view() const { return SegmentView{x0.data(), y0.data(), x1.data(), y1.data(), x0.size()}; }
+    };
+    
+    SegmentArrays m_segments;
+    SegmentArrays m_polygonEdges;
+    std::vector<uint32_t> m_polygonStart{0};  // Polygon p has edges [start[p], start[p + 1])
+    
+    std::vector<float> m_arcX;
+    std::vector<float> m_arcY;
+    std::vector<float> m_arcRadius;
+    std::vector<float> m_arcMiddleX;
+    std::vector<float> m_arcMiddleY;
+    std::vector<float> m_arcCosHalfSpan;
+    std::vector<float> m_arcStartAngle;  // As given, for drawing and scene files
+    std::vector<float> m_arcEndAngle;
+};
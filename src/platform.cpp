@@ -0,0 +1,126 @@
+#include "platform.hpp"
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace Platform {
+
+#ifdef _WIN32
+
+namespace {
+    // FILETIME counts 100 ns intervals
+    double fileTimeSeconds(const FILETIME& time) {
+        ULONGLONG ticks = (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return static_cast<double>(ticks) * 1e-7;
+    }
+    
+    bool processMemory(PROCESS_MEMORY_COUNTERS& counters) {
+        return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) != 0;
+    }
+}
+
+CpuTimes processCpuTimes() {
+    CpuTimes times;
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        times.userSeconds = fileTimeSeconds(user);
+        times.kernelSeconds = fileTimeSeconds(kernel);
+    }
+    return times;
+}
+
+uint64_t residentMemoryBytes() {
+    PROCESS_MEMORY_COUNTERS counters;
+    return processMemory(counters) ? static_cast<uint64_t>(counters.WorkingSetSize) : 0;
+}
+
+uint64_t peakResidentMemoryBytes() {
+    PROCESS_MEMORY_COUNTERS counters;
+    return processMemory(counters) ? static_cast<uint64_t>(counters.PeakWorkingSetSize) : 0;
+}
+
+uint64_t monotonicNanoseconds() {
+    static const LONGLONG frequency = [] {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return value.QuadPart;
+    }();
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // Split to avoid overflowing counter * 1e9
+    uint64_t seconds = static_cast<uint64_t>(counter.QuadPart / frequency);
+    uint64_t remainder = static_cast<uint64_t>(counter.QuadPart % frequency);
+    return seconds * 1000000000ull + remainder * 1000000000ull / static_cast<uint64_t>(frequency);
+}
+
+#else
+
+CpuTimes processCpuTimes() {
+    CpuTimes times;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        times.userSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+        times.kernelSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+    }
+    return times;
+}
+
+uint64_t residentMemoryBytes() {
+#ifdef __linux__
+    // /proc/self/statm: total program size and resident set, in pages
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    int fields = std::fscanf(file, "%llu %llu", &size, &resident);
+    std::fclose(file);
+    if (fields != 2) {
+        return 0;
+    }
+    return static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+uint64_t peakResidentMemoryBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);  // Bytes on macOS
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // KiB on Linux
+#endif
+}
+
+uint64_t monotonicNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+#endif
+
+unsigned int processorCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+double monotonicSeconds() {
+    return static_cast<double>(monotonicNanoseconds()) * 1e-9;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+// Process statistics and clocks behind one interface, so the performance
+// panel does not depend on Win32. Windows uses GetProcessTimes/psapi,
+// Linux uses getrusage and /proc/self/statm.
+namespace Platform {
+    // User and kernel CPU time consumed by this process since it started
+    struct CpuTimes {
+        double userSeconds = 0.0;
+        double kernelSeconds = 0.0;
+        
+        double total() const { return userSeconds + kernelSeconds; }
+    };
+    
+    CpuTimes processCpuTimes();
+    
+    // Current resident set (working set on Windows) and its high-water mark,
+    // in bytes. Returns 0 when the platform does not report the value.
+    uint64_t residentMemoryBytes();
+    uint64_t peakResidentMemoryBytes();
+    
+    // Logical processors available to the process (at least 1)
+    unsigned int processorCount();
+    
+    // Monotonic high-resolution clock, unrelated to wall-clock time
+    uint64_t monotonicNanoseconds();
+    double monotonicSeconds();
+}
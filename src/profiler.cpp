@@ -0,0 +1,444 @@
+#include "profiler.hpp"
+#include "platform.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+std::atomic<bool> Profiler::s_enabled{false};
+
+namespace {
+
+static_assert((Profiler::MAX_EVENTS_PER_THREAD & (Profiler::MAX_EVENTS_PER_THREAD - 1)) == 0,
+              "Ring capacity must be a power of two");
+
+// Events of one thread since the last beginFrame(), as a single-producer
+// single-consumer ring: the owning thread advances tail, beginFrame()
+// advances head. Buffers are reused by later threads once their owner
+// exits (the hand-over goes through the registry mutex), so short-lived
+// workers do not accumulate rows. Events carry their owner's tid, which is
+// new for every owner, so captures keep the threads of one row apart.
+struct ThreadBuffer {
+    Profiler::Event events[Profiler::MAX_EVENTS_PER_THREAD];
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    std::string name;   // Guarded by the registry mutex
+    uint32_t index = 0; // Row in the frame view
+    uint32_t tid = 0;   // Set by the owning thread when it acquires the buffer
+    bool inUse = false; // Guarded by the registry mutex
+};
+
+struct ScopeHistory {
+    uint32_t depth = 0;
+    uint32_t calls = 0;
+    double frameMs[Profiler::HISTORY_FRAMES] = {};
+    int count = 0;     // Valid entries in frameMs
+    int next = 0;      // Ring position of the next frame
+    bool seen = false; // Appeared in the frame being gathered
+};
+
+// A finished capture on its way to the writer thread
+struct CaptureJob {
+    std::string path;
+    uint64_t start = 0;
+    std::vector<Profiler::Event> events;  // Absolute timestamps, tids as threads
+    std::unordered_map<uint32_t, std::string> threadNames;
+};
+
+struct ProfilerState {
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    uint32_t nextTid = 0;  // Guarded by the registry mutex
+    // Names of threads that exited since the last beginFrame(), by tid
+    std::unordered_map<uint32_t, std::string> exitedThreads;  // Guarded by the registry mutex
+    std::atomic<uint64_t> dropped{0};
+    
+    bool viewEnabled = false;
+    
+    uint64_t frameStart = 0;
+    std::vector<Profiler::Event> frameEvents;
+    std::vector<std::string> threadNames;
+    std::unordered_map<std::string, ScopeHistory> history;
+    std::vector<Profiler::ScopeStats> stats;
+    double frameMs = 0.0;
+    
+    // Capture in progress; timestamps are absolute until written
+    bool capturing = false;
+    std::string capturePath;
+    uint64_t captureStart = 0;
+    uint64_t captureEnd = 0;
+    std::vector<Profiler::Event> captureEvents;
+    std::unordered_map<uint32_t, std::string> captureThreadNames;
+    
+    // Finished captures are serialized by a writer thread, so beginFrame()
+    // only hands the buffers over
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    std::deque<CaptureJob> writerQueue;  // Guarded by writerMutex
+    std::string captureStatus;           // Guarded by writerMutex
+    bool writerStopping = false;         // Guarded by writerMutex
+    std::once_flag writerStartFlag;
+    std::thread writer;
+    
+    ProfilerState() {
+        // The writer logs; constructing the log first makes it outlive us
+        Log::getRateLimit();
+    }
+    
+    ~ProfilerState() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(writerMutex);
+                writerStopping = true;
+            }
+            writerWake.notify_one();
+            writer.join();
+        }
+    }
+    
+    void setCaptureStatus(std::string status) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        captureStatus = std::move(status);
+    }
+    
+    void queueCapture(CaptureJob job) {
+        std::call_once(writerStartFlag, [this]() {
+            writer = std::thread([this]() { runWriter(); });
+        });
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            captureStatus = "Writing " + std::to_string(job.events.size()) + " events to " + job.path;
+            writerQueue.push_back(std::move(job));
+        }
+        writerWake.notify_one();
+    }
+    
+    // Writes queued captures until stopped; the queue is drained first
+    void runWriter() {
+        for (;;) {
+            CaptureJob job;
+            {
+                std::unique_lock<std::mutex> lock(writerMutex);
+                writerWake.wait(lock, [this]() { return writerStopping || !writerQueue.empty(); });
+                if (writerQueue.empty()) return;
+                job = std::move(writerQueue.front());
+                writerQueue.pop_front();
+            }
+            writeCapture(job);
+        }
+    }
+    
+    void writeCapture(CaptureJob& job) {
+        // Timestamps relative to the capture start; tids renumbered from 0
+        // in order of first appearance
+        std::unordered_map<uint32_t, uint32_t> rows;
+        std::vector<std::string> names;
+        for (auto& event : job.events) {
+            event.startNs = event.startNs > job.start ? event.startNs - job.start : 0;
+            event.endNs = event.endNs > job.start ? event.endNs - job.start : 0;
+            auto row = rows.find(event.thread);
+            if (row == rows.end()) {
+                auto name = job.threadNames.find(event.thread);
+                row = rows.emplace(event.thread, static_cast<uint32_t>(names.size())).first;
+                names.push_back(name != job.threadNames.end() ? name->second : "Thread " + std::to_string(event.thread));
+            }
+            event.thread = row->second;
+        }
+        
+        std::string status;
+        try {
+            Profiler::writeChromeTrace(job.path, job.events, names);
+            status = "Wrote " + std::to_string(job.events.size()) + " events to " + job.path;
+            LOG_INFO(Profiler, "%s", status.c_str());
+        } catch (const std::exception& e) {
+            status = e.what();
+            LOG_ERROR(Profiler, "%s", e.what());
+        }
+        setCaptureStatus(std::move(status));
+    }
+};
+
+ProfilerState& state() {
+    static ProfilerState s_state;
+    return s_state;
+}
+
+// Releases the thread's buffer for reuse when the thread exits
+struct ThreadSlot {
+    ThreadBuffer* buffer = nullptr;
+    uint32_t depth = 0;
+    
+    ~ThreadSlot() {
+        if (buffer) {
+            ProfilerState& profiler = state();
+            std::lock_guard<std::mutex> lock(profiler.registryMutex);
+            // Kept for a capture, whose events may outlive the thread
+            profiler.exitedThreads[buffer->tid] = buffer->name;
+            buffer->inUse = false;
+        }
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+ThreadBuffer& threadBuffer() {
+    if (!t_slot.buffer) {
+        ProfilerState& profiler = state();
+        std::lock_guard<std::mutex> lock(profiler.registryMutex);
+        for (auto& buffer : profiler.threads) {
+            if (!buffer->inUse) {
+                t_slot.buffer = buffer.get();
+                break;
+            }
+        }
+        if (!t_slot.buffer) {
+            profiler.threads.push_back(std::make_unique<ThreadBuffer>());
+            t_slot.buffer = profiler.threads.back().get();
+            t_slot.buffer->index = static_cast<uint32_t>(profiler.threads.size() - 1);
+        }
+        // A reused buffer belongs to a new thread: new tid, default name
+        t_slot.buffer->tid = profiler.nextTid++;
+        t_slot.buffer->name = "Thread " + std::to_string(t_slot.buffer->tid);
+        t_slot.buffer->inUse = true;
+    }
+    return *t_slot.buffer;
+}
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            out << ' ';
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+void finishCapture(ProfilerState& profiler) {
+    profiler.capturing = false;
+    CaptureJob job;
+    job.path = profiler.capturePath;
+    job.start = profiler.captureStart;
+    job.events.swap(profiler.captureEvents);
+    job.threadNames.swap(profiler.captureThreadNames);
+    profiler.queueCapture(std::move(job));
+    Profiler::setEnabled(profiler.viewEnabled);
+}
+
+}
+
+void Profiler::setEnabled(bool enabled) {
+    ProfilerState& profiler = state();
+    profiler.viewEnabled = enabled;
+    s_enabled = enabled || profiler.capturing;
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(state().registryMutex);
+    if (buffer.name != name) {
+        buffer.name = name;
+    }
+}
+
+uint64_t Profiler::enterScope() {
+    ++t_slot.depth;
+    return Platform::monotonicNanoseconds();
+}
+
+void Profiler::leaveScope(const char* name, uint64_t startNs) {
+    uint64_t endNs = Platform::monotonicNanoseconds();
+    uint32_t depth = --t_slot.depth;
+    
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+    if (tail - buffer.head.load(std::memory_order_acquire) >= MAX_EVENTS_PER_THREAD) {
+        state().dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Timestamps stay absolute until beginFrame() knows the frame start
+    buffer.events[tail & (MAX_EVENTS_PER_THREAD - 1)] = {name, startNs, endNs, depth, buffer.tid};
+    buffer.tail.store(tail + 1, std::memory_order_release);
+}
+
+void Profiler::startCapture(const std::string& path, double seconds) {
+    ProfilerState& profiler = state();
+    uint64_t now = Platform::monotonicNanoseconds();
+    profiler.capturing = true;
+    profiler.capturePath = path;
+    profiler.captureStart = now;
+    profiler.captureEnd = now + static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9);
+    profiler.captureEvents.clear();
+    profiler.captureThreadNames.clear();
+    profiler.setCaptureStatus("Capturing to " + path);
+    s_enabled = true;
+}
+
+bool Profiler::isCapturing() {
+    return state().capturing;
+}
+
+std::string Profiler::getCaptureStatus() {
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.writerMutex);
+    return profiler.captureStatus;
+}
+
+uint64_t Profiler::getDroppedEvents() {
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+void Profiler::beginFrame() {
+    ProfilerState& profiler = state();
+    uint64_t now = Platform::monotonicNanoseconds();
+    
+    profiler.frameEvents.clear();
+    {
+        // Only guards the thread list and names; the rings are read lock-free
+        std::lock_guard<std::mutex> registryLock(profiler.registryMutex);
+        if (profiler.capturing) {
+            profiler.captureThreadNames.insert(profiler.exitedThreads.begin(), profiler.exitedThreads.end());
+        }
+        profiler.exitedThreads.clear();
+        profiler.threadNames.resize(profiler.threads.size());
+        for (auto& buffer : profiler.threads) {
+            profiler.threadNames[buffer->index] = buffer->name;
+            if (profiler.capturing && buffer->inUse) {
+                profiler.captureThreadNames[buffer->tid] = buffer->name;
+            }
+            uint64_t head = buffer->head.load(std::memory_order_relaxed);
+            uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+            for (uint64_t i = head; i < tail; ++i) {
+                Event event = buffer->events[i & (MAX_EVENTS_PER_THREAD - 1)];
+                // Captures keep the tid; the frame view shows one row per buffer
+                if (profiler.capturing && profiler.captureEvents.size() < MAX_CAPTURE_EVENTS) {
+                    profiler.captureEvents.push_back(event);
+                }
+                event.thread = buffer->index;
+                profiler.frameEvents.push_back(event);
+            }
+            buffer->head.store(tail, std::memory_order_release);
+        }
+    }
+    
+    if (profiler.capturing && now >= profiler.captureEnd) {
+        finishCapture(profiler);
+    }
+    
+    // Scopes that began before this frame (right after enabling) are
+    // clamped to its start
+    uint64_t frameStart = profiler.frameStart ? profiler.frameStart : now;
+    for (auto& event : profiler.frameEvents) {
+        event.startNs = event.startNs > frameStart ? event.startNs - frameStart : 0;
+        event.endNs = event.endNs > frameStart ? event.endNs - frameStart : 0;
+    }
+    std::sort(profiler.frameEvents.begin(), profiler.frameEvents.end(), [](const Event& a, const Event& b) {
+        return a.thread != b.thread ? a.thread < b.thread : a.startNs < b.startNs;
+    });
+    profiler.frameMs = (now - frameStart) / 1000000.0;
+    profiler.frameStart = now;
+    
+    if (profiler.frameEvents.empty()) {
+        return;  // Disabled; keep the statistics of the last recorded frame
+    }
+    
+    // Per-frame totals per scope name
+    for (auto& entry : profiler.history) {
+        entry.second.seen = false;
+        entry.second.calls = 0;
+    }
+    // Statistics are listed in order of first appearance, which follows the
+    // call tree of the main thread
+    std::unordered_map<std::string, double> totals;
+    std::vector<std::string> order;
+    for (const auto& event : profiler.frameEvents) {
+        ScopeHistory& scope = profiler.history[event.name];
+        if (!scope.seen) {
+            scope.depth = event.depth;
+            order.push_back(event.name);
+        }
+        scope.depth = std::min(scope.depth, event.depth);
+        scope.seen = true;
+        ++scope.calls;
+        totals[event.name] += (event.endNs - event.startNs) / 1000000.0;
+    }
+    
+    profiler.stats.clear();
+    for (const auto& name : order) {
+        ScopeHistory& scope = profiler.history[name];
+        double ms = totals[name];
+        scope.frameMs[scope.next] = ms;
+        scope.next = (scope.next + 1) % HISTORY_FRAMES;
+        scope.count = std::min(scope.count + 1, HISTORY_FRAMES);
+        
+        ScopeStats stats{name, scope.depth, scope.calls, ms, ms, 0.0, ms};
+        for (int i = 0; i < scope.count; ++i) {
+            stats.minMs = std::min(stats.minMs, scope.frameMs[i]);
+            stats.maxMs = std::max(stats.maxMs, scope.frameMs[i]);
+            stats.avgMs += scope.frameMs[i];
+        }
+        stats.avgMs /= scope.count;
+        profiler.stats.push_back(std::move(stats));
+    }
+}
+
+const std::vector<Profiler::Event>& Profiler::getFrameEvents() {
+    return state().frameEvents;
+}
+
+const std::vector<std::string>& Profiler::getThreadNames() {
+    return state().threadNames;
+}
+
+const std::vector<Profiler::ScopeStats>& Profiler::getScopeStats() {
+    return state().stats;
+}
+
+double Profiler::getFrameMs() {
+    return state().frameMs;
+}
+
+void Profiler::writeChromeTrace(const std::string& path, const std::vector<Event>& events,
+                                const std::vector<std::string>& threadNames) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open profile capture file for writing: " + path);
+    }
+    
+    // Complete ("X") events with microsecond timestamps, plus thread names
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t t = 0; t < threadNames.size(); ++t) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, threadNames[t].c_str());
+        out << "}}";
+        first = false;
+    }
+    char number[64];
+    for (const auto& event : events) {
+        out << (first ? "" : ",\n") << "{\"name\":";
+        writeJsonString(out, event.name);
+        std::snprintf(number, sizeof(number), "%.3f", event.startNs / 1000.0);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << number;
+        std::snprintf(number, sizeof(number), "%.3f", (event.endNs - event.startNs) / 1000.0);
+        out << ",\"dur\":" << number << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    
+    if (!out) {
+        throw std::runtime_error("Failed to write profile capture file: " + path);
+    }
+}
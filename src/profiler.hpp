@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight scoped CPU profiler.
+//
+// PROFILE_SCOPE("name") times the enclosing block on the calling thread.
+// Each thread appends finished scopes to its own lock-free ring buffer
+// (single producer, with beginFrame() as the single consumer). beginFrame()
+// gathers the rings of all threads into the frame that just ended and
+// updates the per-scope statistics. Recording is off unless the in-app view
+// is enabled or a capture is running, so code shared with the tools pays
+// one atomic load per scope. Names must be string literals (or otherwise
+// outlive the profiler).
+//
+// startCapture() additionally keeps every event for a number of seconds
+// and then writes them as Chrome trace-event JSON (chrome://tracing,
+// Perfetto) on a background writer thread.
+class Profiler {
+public:
+    // One finished scope of the last complete frame
+    struct Event {
+        const char* name;
+        uint64_t startNs;  // Relative to the frame start
+        uint64_t endNs;
+        uint32_t depth;    // Nesting level on its thread
+        uint32_t thread;   // Index into getThreadNames()
+    };
+    
+    // Per-frame total time of one scope name over the history window
+    struct ScopeStats {
+        std::string name;
+        uint32_t depth;   // Shallowest nesting level seen
+        uint32_t calls;   // In the last frame
+        double lastMs;
+        double minMs;
+        double avgMs;
+        double maxMs;
+    };
+    
+    static constexpr int HISTORY_FRAMES = 120;
+    // Ring capacity per thread (power of two); scopes beyond it within one
+    // frame are dropped and counted
+    static constexpr std::size_t MAX_EVENTS_PER_THREAD = 16384;
+    // Upper bound on the events of one capture (32 bytes each)
+    static constexpr std::size_t MAX_CAPTURE_EVENTS = 4u << 20;
+    
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    // Enables recording for the in-app view
+    static void setEnabled(bool enabled);
+    
+    // Records every scope for the given duration, then has the events
+    // written to path as Chrome trace-event JSON; beginFrame() hands them
+    // to the writer thread. Replaces a capture in progress.
+    static void startCapture(const std::string& path, double seconds);
+    // True while recording; writing may still be in progress afterwards
+    static bool isCapturing();
+    // State of the last capture ("Capturing ...", "Writing ...", "Wrote ..."
+    // or the error), empty before one
+    static std::string getCaptureStatus();
+    
+    // Scopes dropped because a thread's ring was full
+    static uint64_t getDroppedEvents();
+    
+    // Label of the calling thread's timeline row
+    static void setThreadName(const char* name);
+    
+    // Closes the current frame and starts the next one. Call once per frame
+    // on the main thread, outside of any scope.
+    static void beginFrame();
+    
+    // Results of the last complete frame; valid until the next beginFrame()
+    static const std::vector<Event>& getFrameEvents();
+    static const std::vector<std::string>& getThreadNames();
+    static const std::vector<ScopeStats>& getScopeStats();
+    static double getFrameMs();
+    
+    // Used by ProfileScope
+    static uint64_t enterScope();
+    static void leaveScope(const char* name, uint64_t startNs);
+
+    // Writes events (timestamps in ns, any origin) as Chrome trace-event
+    // JSON. Throws std::runtime_error if the file cannot be written.
+    static void writeChromeTrace(const std::string& path, const std::vector<Event>& events,
+                                 const std::vector<std::string>& threadNames);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// Records the lifetime of the object as one profiler event
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : m_name(name), m_active(Profiler::isEnabled()) {
+        if (m_active) {
+            m_start = Profiler::enterScope();
+        }
+    }
+    ~ProfileScope() {
+        if (m_active) {
+            Profiler::leaveScope(m_name, m_start);
+        }
+    }
+    
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start = 0;
+    bool m_active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
@@ -0,0 +1,130 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Vertex layout of the ray line buffer, shared by the CPU upload path and
+// the compute tracer output
+struct RayVertex {
+    glm::vec2 position;
+    glm::vec3 color;
+    glm::vec2 dash;  // x: distance along the ray, y: 1 for dashed (reflected) rays
+};
+
+struct Ray {
+    glm::vec2 origin;
+    glm::vec2 direction;
+    float length;
+    bool isReflected{false};
+    int reflectionCount{0};
+    glm::vec3 color{1.0f};
+    float energy{1.0f};  // Fraction of the primary ray's energy this ray carries
+    int medium{-1};      // Hit id of the refractive obstacle the ray travels inside, -1 outside
+    static constexpr int MAX_REFLECTIONS = 3;
+    // Segment and arc hits closer than this are ignored, so a ray reflected
+    // off a wall does not hit the same wall again at its origin
+    static constexpr float SURFACE_EPSILON = 1e-3f;
+    // Rays leaving a refractive obstacle's surface start this far from it,
+    // so they are clearly inside or outside the circle
+    static constexpr float REFRACTION_OFFSET = 1e-2f;
+    
+    // Helper function to check intersection with a circle
+    bool intersectsCircle(const glm::vec2& center, float radius, float& intersectionDist) const {
+        glm::vec2 toCircle = center - origin;
+        float a = glm::dot(direction, direction);
+        float b = -2.0f * glm::dot(toCircle, direction);
+        float c = glm::dot(toCircle, toCircle) - radius * radius;
+        
+        float discriminant = b * b - 4.0f * a * c;
+        if (discriminant < 0.0f) return false;
+        
+        float t = (-b - std::sqrt(discriminant)) / (2.0f * a);
+        if (t < 0.0f) return false;
+        
+        intersectionDist = t;
+        return t < length;
+    }
+    
+    // Far crossing of a circle, for rays that start inside it
+    bool exitsCircle(const glm::vec2& center, float radius, float& intersectionDist) const {
+        glm::vec2 toCircle = center - origin;
+        float a = glm::dot(direction, direction);
+        float b = -2.0f * glm::dot(toCircle, direction);
+        float c = glm::dot(toCircle, toCircle) - radius * radius;
+        
+        float discriminant = b * b - 4.0f * a * c;
+        if (discriminant < 0.0f) return false;
+        
+        float t = (-b + std::sqrt(discriminant)) / (2.0f * a);
+        if (t < 0.0f) return false;
+        
+        intersectionDist = t;
+        return t < length;
+    }
+    
+    // Intersection with the segment from -> to; parallel rays miss
+    bool intersectsSegment(const glm::vec2& from, const glm::vec2& to, float& intersectionDist) const {
+        glm::vec2 edge = to - from;
+        glm::vec2 toStart = from - origin;
+        float denominator = direction.x * edge.y - direction.y * edge.x;
+        if (denominator == 0.0f) return false;
+        
+        // Ray parameter t and position s along the segment, by Cramer's rule
+        float t = (toStart.x * edge.y - toStart.y * edge.x) / denominator;
+        float s = (toStart.x * direction.y - toStart.y * direction.x) / denominator;
+        if (t < SURFACE_EPSILON || s < 0.0f || s > 1.0f) return false;
+        
+        intersectionDist = t;
+        return t < length;
+    }
+    
+    // Intersection with an arc given as in ArcView: the circle crossings whose
+    // offset from the center projects onto middle by at least
+    // cosHalfSpan * radius. The far crossing counts when the near one is off
+    // the arc or behind the ray, so arcs are hit from both sides.
+    bool intersectsArc(const glm::vec2& center, float radius, const glm::vec2& middle, float cosHalfSpan,
+                       float& intersectionDist) const {
+        glm::vec2 toCircle = center - origin;
+        float a = glm::dot(direction, direction);
+        float b = -2.0f * glm::dot(toCircle, direction);
+        float c = glm::dot(toCircle, toCircle) - radius * radius;
+        
+        float discriminant = b * b - 4.0f * a * c;
+        if (discriminant < 0.0f) return false;
+        
+        float root = std::sqrt(discriminant);
+        float limit = cosHalfSpan * radius;
+        float t = (-b - root) / (2.0f * a);
+        if (t < SURFACE_EPSILON || glm::dot(origin + direction * t - center, middle) < limit) {
+            t = (-b + root) / (2.0f * a);
+            if (t < SURFACE_EPSILON || glm::dot(origin + direction * t - center, middle) < limit) return false;
+        }
+        
+        intersectionDist = t;
+        return t < length;
+    }
+    
+    // Calculate reflection direction using Fresnel equations
+    glm::vec2 calculateReflection(const glm::vec2& normal) const {
+        // For 2D, we can use a simpler reflection formula
+        return direction - 2.0f * glm::dot(direction, normal) * normal;
+    }
+    
+    // Refraction from index n1 into n2 at a surface whose unit normal faces
+    // the incoming (unit) direction. Stores the Snell's law direction in
+    // transmitted and returns the Fresnel reflectance for unpolarized light,
+    // 1 for total internal reflection (transmitted is then left unchanged).
+    float calculateRefraction(const glm::vec2& normal, float n1, float n2, glm::vec2& transmitted) const {
+        float eta = n1 / n2;
+        float cosIncident = std::min(-glm::dot(direction, normal), 1.0f);
+        float sinTransmitted2 = eta * eta * (1.0f - cosIncident * cosIncident);
+        if (sinTransmitted2 >= 1.0f) return 1.0f;
+        
+        float cosTransmitted = std::sqrt(1.0f - sinTransmitted2);
+        transmitted = eta * direction + (eta * cosIncident - cosTransmitted) * normal;
+        
+        float rs = (n1 * cosIncident - n2 * cosTransmitted) / (n1 * cosIncident + n2 * cosTransmitted);
+        float rp = (n1 * cosTransmitted - n2 * cosIncident) / (n1 * cosTransmitted + n2 * cosIncident);
+        return 0.5f * (rs * rs + rp * rp);
+    }
+};
@@ -1,7 +1,12 @@
 #include "renderer.hpp"
+#include "log.hpp"
 #include <stdexcept>
-#include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+#include <chrono>
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui_impl_glfw.h>
@@ -16,10 +21,38 @@ const float CONTROLS_WIDTH = 484.0f;
 const float CONTROLS_HEIGHT = 350.0f;  // Increased from 275.0f
 const float CONTROLS_MARGIN = 20.0f;
 
-Renderer::Renderer(Window& window) : m_window(window) {
+// Output file of the Record Traces button, read with RayTracerNG_TraceDump
+static const char* const TRACE_RECORDING_PATH = "trace.rttrace";
+
+// Upper end of the obstacle count slider; counts beyond about 25 get
+// smaller obstacles so they fit on screen (SceneLayout::generateObstacles)
+static const int MAX_OBSTACLE_COUNT = 100000;
+
+// Index of refraction the Glass Obstacles checkbox starts at (crown glass),
+// and the upper end of its slider (about diamond)
+static const float GLASS_IOR = 1.5f;
+static const float MAX_IOR = 2.5f;
+// Cauchy B coefficient the Spectral Dispersion checkbox starts at, about
+// five times flint glass so the spectrum is easy to see
+static const float DISPERSION = 0.05f;
+static const float MAX_DISPERSION = 0.2f;
+
+// Output file of the Export Frame Times button
+static const char* const FRAME_TIMES_PATH = "frame_times.csv";
+
+// Chrome trace-event capture started with F9 or from the profiler window
+static const char* const PROFILE_CAPTURE_PATH = "profile.json";
+static const double PROFILE_CAPTURE_SECONDS = 5.0;
+
+Renderer::Renderer(Window& window, std::unique_ptr<SimulationClock> clock)
+    : m_window(window), m_clock(std::move(clock)) {
+    if (!m_clock) {
+        m_clock = std::make_unique<SystemClock>();
+    }
     initGL();
     initImGui();
     initPerformanceMonitoring();
+    Profiler::setThreadName("Main");
     setupOrthographicView();
     
     m_scene = std::make_unique<Scene>();
@@ -29,7 +62,7 @@ Renderer::Renderer(Window& window) : m_window(window) {
 
 Renderer::~Renderer() {
     // Clean up performance monitoring
-    glDeleteQueries(1, &m_gpuQuery);
+    m_gpuTimer.reset();
     
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -48,8 +81,7 @@ void Renderer::checkGLError(const char* operation) {
             case GL_INVALID_FRAMEBUFFER_OPERATION: errorStr = "GL_INVALID_FRAMEBUFFER_OPERATION"; break;
             default: errorStr = "UNKNOWN"; break;
         }
-        std::cerr << "OpenGL error after " << operation << ": " << errorStr << " (0x"
-                  << std::hex << error << std::dec << ")" << std::endl;
+        LOG_ERROR(GL, "OpenGL error after %s: %s (0x%x)", operation, errorStr.c_str(), error);
     }
 }
 
@@ -78,10 +110,19 @@ void APIENTRY Renderer::messageCallback(GLenum source, GLenum type, GLuint id,
         default: typeStr = "UNKNOWN"; break;
     }
 
-    // Only print medium and high severity messages
-    if (severity == GL_DEBUG_SEVERITY_HIGH || severity == GL_DEBUG_SEVERITY_MEDIUM) {
-        std::cerr << "GL CALLBACK: " << severityStr << " severity, type = " << typeStr
-                  << "\n   Message: " << message << std::endl;
+    // Drivers may call this from their own threads and many times per
+    // frame, so it only queues the message. Low severity and notifications
+    // were never printed and stay at debug level.
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH:
+            LOG_ERROR(GL, "%s severity, type = %s: %s", severityStr, typeStr, message);
+            break;
+        case GL_DEBUG_SEVERITY_MEDIUM:
+            LOG_WARNING(GL, "%s severity, type = %s: %s", severityStr, typeStr, message);
+            break;
+        default:
+            LOG_DEBUG(GL, "%s severity, type = %s: %s", severityStr, typeStr, message);
+            break;
     }
 }
 
@@ -232,6 +273,13 @@ glm::vec2 Renderer::screenToWorld(double xpos, double ypos) {
 }
 
 void Renderer::handleInput() {
+    // F9 captures a few seconds of profiler scopes to a Chrome trace file
+    bool captureKeyDown = glfwGetKey(m_window.getHandle(), GLFW_KEY_F9) == GLFW_PRESS;
+    if (captureKeyDown && !m_captureKeyWasDown && !ImGui::GetIO().WantCaptureKeyboard) {
+        Profiler::startCapture(PROFILE_CAPTURE_PATH, PROFILE_CAPTURE_SECONDS);
+    }
+    m_captureKeyWasDown = captureKeyDown;
+    
     if (ImGui::GetIO().WantCaptureMouse) {
         return;  // Don't handle mouse input when ImGui is using it
     }
@@ -277,6 +325,18 @@ void Renderer::handleWindowResize() {
 }
 
 void Renderer::beginFrame() {
+    // Closes the previous frame, so it must run before any scope
+    Profiler::beginFrame();
+    PROFILE_SCOPE("Renderer::beginFrame");
+    
+    // CPU frame time is the full interval since the previous frame started,
+    // so it includes event polling, vsync waits and stalls anywhere in the loop
+    double frameStart = Platform::monotonicSeconds();
+    if (m_lastFrameStart > 0.0) {
+        m_cpuFrameTimes.add((frameStart - m_lastFrameStart) * 1000.0);
+    }
+    m_lastFrameStart = frameStart;
+    
     // Check if framebuffer was resized
     static int lastWidth = 0;
     static int lastHeight = 0;
@@ -290,6 +350,10 @@ void Renderer::beginFrame() {
         lastHeight = currentHeight;
     }
 
+    m_gpuTimer->beginFrame();
+    for (double gpuMs : m_gpuTimer->getCollectedFrameMs()) {
+        m_gpuFrameTimes.add(gpuMs);
+    }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
     ImGui_ImplOpenGL3_NewFrame();
@@ -297,21 +361,81 @@ void Renderer::beginFrame() {
     ImGui::NewFrame();
 
     handleInput();
-    m_scene->update();
-    m_scene->render(m_projectionMatrix);
+    stepSimulation();
+    m_scene->prepareRender(m_projectionMatrix, static_cast<float>(m_timestep.getAlpha()));
+    m_gpuTimer->endPass(GpuTimer::PASS_TRACE);
+    m_scene->render();
+    m_gpuTimer->endPass(GpuTimer::PASS_SCENE);
     
     // Update performance stats at the end of the frame
     updatePerformanceStats();
 }
 
 void Renderer::endFrame() {
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    PROFILE_SCOPE("Renderer::endFrame");
+    {
+        PROFILE_SCOPE("ImGui render");
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+    m_gpuTimer->endPass(GpuTimer::PASS_UI);
+    m_gpuTimer->endFrame();
     
-    m_window.swapBuffers();
+    {
+        PROFILE_SCOPE("Swap buffers");
+        m_window.swapBuffers();
+    }
+    limitFrameRate();
+}
+
+void Renderer::stepSimulation() {
+    double now = m_clock->frameTime();
+    double elapsed = m_hasClockTime ? now - m_lastClockTime : 0.0;
+    m_lastClockTime = now;
+    m_hasClockTime = true;
+    
+    int steps = m_timestep.advance(elapsed);
+    for (int i = 0; i < steps; ++i) {
+        m_scene->update(static_cast<float>(m_timestep.getStep()));
+    }
+}
+
+void Renderer::setPresentMode(PresentMode mode, int frameRateLimit) {
+    m_presentMode = mode;
+    if (frameRateLimit > 0) {
+        m_frameRateLimit = frameRateLimit;
+    }
+    m_window.setSwapInterval(mode == PresentMode::Vsync ? 1 : 0);
+    m_nextFrameDeadline = 0.0;
+}
+
+void Renderer::limitFrameRate() {
+    if (m_presentMode != PresentMode::Limited || m_frameRateLimit <= 0) return;
+    PROFILE_SCOPE("Frame limiter");
+    
+    // Deadlines advance by whole intervals so sleep overshoot does not
+    // accumulate; after a long frame the schedule restarts from now
+    double interval = 1.0 / m_frameRateLimit;
+    double now = Platform::monotonicSeconds();
+    m_nextFrameDeadline += interval;
+    if (m_nextFrameDeadline < now - interval) {
+        m_nextFrameDeadline = now;
+    }
+    
+    // Sleep is coarse, so it covers all but the last couple of milliseconds
+    // and the rest is a yielding spin
+    double remaining = m_nextFrameDeadline - now;
+    if (remaining > 0.002) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - 0.002));
+    }
+    while (Platform::monotonicSeconds() < m_nextFrameDeadline) {
+        std::this_thread::yield();
+    }
 }
 
 void Renderer::renderUI() {
+    PROFILE_SCOPE("Renderer::renderUI");
+    
     // Get the main viewport
     ImGuiViewport* viewport = ImGui::GetMainViewport();
     
@@ -411,6 +535,12 @@ void Renderer::renderUI() {
     if (m_showAboutWindow) {
         showAboutWindow();
     }
+    
+    // Show the profiler window if needed
+    Profiler::setEnabled(m_showProfilerWindow);
+    if (m_showProfilerWindow) {
+        showProfilerWindow();
+    }
 
     // Set window flags for a more polished look
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoCollapse;  // Remove NoResize and AlwaysAutoResize
@@ -437,7 +567,7 @@ void Renderer::renderUI() {
     
     // Set initial window size
     if (originalSize.x == 0) {
-        ImGui::SetNextWindowSize(ImVec2(420, 665));  // Increased width and height to fit content
+        ImGui::SetNextWindowSize(ImVec2(420, 1290));  // Increased width and height to fit content
     }
     
     // Begin the controls window with a title
@@ -474,10 +604,85 @@ void Renderer::renderUI() {
             ImGui::Text("Performance");
             ImGui::PopStyleColor();
             ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+            ImGui::Text("CPU ms p50/95/99/max: %.1f/%.1f/%.1f/%.1f",
+                m_cpuFrameSummary.p50, m_cpuFrameSummary.p95, m_cpuFrameSummary.p99, m_cpuFrameSummary.max);
+            ImGui::Text("GPU ms p50/95/99/max: %.1f/%.1f/%.1f/%.1f",
+                m_gpuFrameSummary.p50, m_gpuFrameSummary.p95, m_gpuFrameSummary.p99, m_gpuFrameSummary.max);
             
             // Display actual CPU and GPU usage
             ImGui::Text("CPU Usage: %.1f%%", m_cpuUsage);
             ImGui::Text("GPU Usage: %.1f%%", m_gpuUsage);
+            ImGui::Text("GPU ms: %s %.2f  %s %.2f  %s %.2f",
+                GpuTimer::passName(GpuTimer::PASS_TRACE), m_gpuTimer->getPassMs(GpuTimer::PASS_TRACE),
+                GpuTimer::passName(GpuTimer::PASS_SCENE), m_gpuTimer->getPassMs(GpuTimer::PASS_SCENE),
+                GpuTimer::passName(GpuTimer::PASS_UI), m_gpuTimer->getPassMs(GpuTimer::PASS_UI));
+            ImGui::Text("Memory: %.1f MB (peak %.1f MB)",
+                m_residentMemory / (1024.0 * 1024.0), m_peakResidentMemory / (1024.0 * 1024.0));
+            
+            // Work counters of the last frame
+            const LightSource* traceLight = m_scene->getLightSource();
+            if (traceLight && traceLight->hasTraceStats()) {
+                const TraceStats& trace = traceLight->getTraceStats();
+                ImGui::Text("Rays: %llu (%.2f M/s), %.1f tests/ray",
+                    static_cast<unsigned long long>(trace.raysTraced), trace.raysPerSecond() / 1e6, trace.testsPerRay());
+                if (trace.buildMs > 0.0) {
+                    ImGui::Text("Grid build: %.2f ms of %.2f ms", trace.buildMs, trace.traceMs);
+                }
+                ImGui::Text("Segments by depth:");
+                for (int depth = 0; depth < TraceStats::DEPTH_BUCKETS; ++depth) {
+                    ImGui::SameLine();
+                    ImGui::Text("%llu", static_cast<unsigned long long>(trace.segmentsByDepth[depth]));
+                }
+                ImGui::SameLine();
+                ImGui::Text("| miss %llu, limit %llu",
+                    static_cast<unsigned long long>(trace.misses), static_cast<unsigned long long>(trace.depthLimited));
+                if (trace.refractions > 0) {
+                    ImGui::Text("Refractions: %llu, culled %llu, roulette %llu",
+                        static_cast<unsigned long long>(trace.refractions),
+                        static_cast<unsigned long long>(trace.energyCulled),
+                        static_cast<unsigned long long>(trace.rouletteKilled));
+                }
+                if (trace.dispersionSplits > 0) {
+                    ImGui::Text("Dispersion splits: %llu", static_cast<unsigned long long>(trace.dispersionSplits));
+                }
+                if (trace.budgetLimited > 0) {
+                    ImGui::Text("Segment budget reached: %llu rays dropped",
+                        static_cast<unsigned long long>(trace.budgetLimited));
+                }
+            } else {
+                ImGui::Text("Trace counters: CPU backend only");
+            }
+            const RenderStats& renderStats = m_scene->getRenderStats();
+            ImGui::Text("Draw calls: %u, upload %.1f KB (rays %.1f KB)", renderStats.drawCalls,
+                renderStats.uploadBytes / 1024.0, renderStats.rayVertexBytes / 1024.0);
+            
+            // Presentation mode; the simulation step is unaffected
+            const char* presentModes[] = { "VSync", "Uncapped", "Limited" };
+            int presentMode = static_cast<int>(m_presentMode);
+            ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.3f);
+            if (ImGui::Combo("Present", &presentMode, presentModes, 3)) {
+                setPresentMode(static_cast<PresentMode>(presentMode));
+            }
+            if (m_presentMode == PresentMode::Limited) {
+                ImGui::SameLine();
+                ImGui::SliderInt("FPS Limit", &m_frameRateLimit, 30, 480);
+            }
+            ImGui::PopItemWidth();
+            ImGui::Checkbox("Show Profiler", &m_showProfilerWindow);
+            ImGui::SameLine();
+            if (ImGui::Button("Export Frame Times")) {
+                try {
+                    FrameTimes::writeCsv(FRAME_TIMES_PATH, m_cpuFrameTimes, m_gpuFrameTimes);
+                    m_frameTimesStatus = std::string("Saved ") + FRAME_TIMES_PATH;
+                }
+                catch (const std::exception& e) {
+                    m_frameTimesStatus = e.what();
+                }
+            }
+            if (!m_frameTimesStatus.empty()) {
+                ImGui::SameLine();
+                ImGui::Text("%s", m_frameTimesStatus.c_str());
+            }
             
             ImGui::Separator();
             
@@ -499,7 +704,7 @@ void Renderer::renderUI() {
                 bool autoMove = m_scene->isLightAutoMoving();
                 if (ImGui::Checkbox("Auto Move Light", &autoMove)) {
                     m_scene->setLightAutoMove(autoMove);
-                    std::cout << "Light auto-move: " << (autoMove ? "Enabled" : "Disabled") << std::endl;
+                    LOG_INFO(Renderer, "Light auto-move: %s", autoMove ? "Enabled" : "Disabled");
                 }
                 ImGui::PopStyleVar(2);
                 ImGui::PopStyleColor(4);
@@ -522,7 +727,7 @@ void Renderer::renderUI() {
                 bool reflectionsEnabled = m_scene->areReflectionsEnabled();
                 if (ImGui::Checkbox("Enable Reflections", &reflectionsEnabled)) {
                     m_scene->setReflectionsEnabled(reflectionsEnabled);
-                    std::cout << "Reflections: " << (reflectionsEnabled ? "Enabled" : "Disabled") << std::endl;
+                    LOG_INFO(Renderer, "Reflections: %s", reflectionsEnabled ? "Enabled" : "Disabled");
                 }
                 ImGui::PopStyleVar(2);
                 ImGui::PopStyleColor(4);
@@ -565,12 +770,78 @@ void Renderer::renderUI() {
             int currentCount = Scene::getDesiredObstacleCount();
             float sliderWidth = ImGui::GetWindowWidth() * 0.4f; // Make slider 60% of window width
             ImGui::PushItemWidth(sliderWidth);
-            if (ImGui::SliderInt("Desired Obstacle Count", &currentCount, 0, 50)) {
+            if (ImGui::SliderInt("Desired Obstacle Count", &currentCount, 0, MAX_OBSTACLE_COUNT, "%d", ImGuiSliderFlags_Logarithmic)) {
                 Scene::setDesiredObstacleCount(currentCount);
                 m_scene->generateRandomObstacles(currentCount);
             }
             ImGui::PopItemWidth();
             
+            // Moving obstacles stress mode
+            bool obstaclesMoving = m_scene->areObstaclesMoving();
+            if (ImGui::Checkbox("Moving Obstacles", &obstaclesMoving)) {
+                m_scene->setObstaclesMoving(obstaclesMoving);
+                LOG_INFO(Renderer, "Moving obstacles: %s", obstaclesMoving ? "Enabled" : "Disabled");
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::Text("Obstacles move, bounce off the walls and collide with each other");
+                ImGui::Text("Use the Grid kernel for large counts");
+                ImGui::EndTooltip();
+            }
+            if (obstaclesMoving) {
+                float obstacleSpeed = m_scene->getObstacleSpeed();
+                ImGui::PushItemWidth(sliderWidth);
+                if (ImGui::SliderFloat("Obstacle Speed", &obstacleSpeed, 0.0f, ObstacleMotion::MAX_SPEED, "%.0f")) {
+                    m_scene->setObstacleSpeed(obstacleSpeed);
+                }
+                ImGui::PopItemWidth();
+                const ObstacleMotion& motion = m_scene->getObstacleMotion();
+                ImGui::Text("Step: %.2f ms, %llu contacts", motion.getLastStepMs(),
+                    static_cast<unsigned long long>(motion.getLastContactCount()));
+            }
+            
+            // Glass obstacles split rays into reflected and refracted parts
+            float obstacleIor = m_scene->getObstacleIor();
+            bool glassObstacles = obstacleIor > 0.0f;
+            if (ImGui::Checkbox("Glass Obstacles", &glassObstacles)) {
+                m_scene->setObstacleIor(glassObstacles ? GLASS_IOR : ObstacleStore::OPAQUE);
+                LOG_INFO(Renderer, "Glass obstacles: %s", glassObstacles ? "Enabled" : "Disabled");
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::Text("Rays are split by the Fresnel equations and refracted by Snell's law");
+                ImGui::Text("Weak branches play Russian roulette; the segment budget goes to the strongest rays");
+                ImGui::EndTooltip();
+            }
+            if (glassObstacles) {
+                ImGui::PushItemWidth(sliderWidth);
+                if (ImGui::SliderFloat("Index of Refraction", &obstacleIor, 1.0f, MAX_IOR, "%.2f")) {
+                    m_scene->setObstacleIor(obstacleIor);
+                }
+                ImGui::PopItemWidth();
+                
+                // Dispersion traces wavelength bins that split where they diverge
+                float dispersion = m_scene->getDispersion();
+                bool spectral = dispersion > 0.0f;
+                if (ImGui::Checkbox("Spectral Dispersion", &spectral)) {
+                    m_scene->setDispersion(spectral ? DISPERSION : 0.0f);
+                    LOG_INFO(Renderer, "Spectral dispersion: %s", spectral ? "Enabled" : "Disabled");
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::BeginTooltip();
+                    ImGui::Text("Each ray carries %d wavelength bins with their own index of refraction", Spectrum::BINS);
+                    ImGui::Text("Bins share one ray until their paths diverge");
+                    ImGui::EndTooltip();
+                }
+                if (spectral) {
+                    ImGui::PushItemWidth(sliderWidth);
+                    if (ImGui::SliderFloat("Dispersion", &dispersion, 0.001f, MAX_DISPERSION, "%.3f")) {
+                        m_scene->setDispersion(dispersion);
+                    }
+                    ImGui::PopItemWidth();
+                }
+            }
+            
             // Add Ray Count Slider
             ImGui::Separator();
             ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Ray Tracing Quality");
@@ -586,7 +857,47 @@ void Renderer::renderUI() {
             }
             if (ImGui::SliderInt("Ray Count", &currentIndex, 0, 3, rayCountLabels[currentIndex])) {
                 Scene::setRayCount(rayCountValues[currentIndex]);
-                m_scene->getLightSource()->updateRays();
+            }
+            
+            // Tracing backend selection
+            bool gpuTracing = m_scene->getTracingBackend() == Scene::TracingBackend::GpuCompute;
+            if (ImGui::Checkbox("GPU Compute Tracing", &gpuTracing)) {
+                m_scene->setTracingBackend(gpuTracing ? Scene::TracingBackend::GpuCompute
+                                                      : Scene::TracingBackend::Cpu);
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::Text("Trace rays in a compute shader and draw them without a CPU round trip");
+                ImGui::EndTooltip();
+            }
+            const char* traceKernels[] = { "Scalar", "SIMD", "Grid" };
+            int traceKernel = static_cast<int>(m_scene->getCpuTraceKernel());
+            ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.3f);
+            if (ImGui::Combo("CPU Kernel", &traceKernel, traceKernels, 3)) {
+                m_scene->setCpuTraceKernel(static_cast<TraceKernel>(traceKernel));
+            }
+            ImGui::PopItemWidth();
+            if (ImGui::IsItemHovered()) {
+                ImGui::BeginTooltip();
+                ImGui::Text("Grid walks a uniform grid rebuilt every frame; fastest with many or moving obstacles");
+                ImGui::EndTooltip();
+            }
+            if (gpuTracing && (!m_scene->getWalls().empty() || m_scene->getObstacles().refractiveCount() > 0)) {
+                ImGui::TextWrapped("Scenes with walls or glass obstacles are traced on the CPU");
+            }
+            if (gpuTracing) {
+                bool validate = m_scene->isGpuValidationEnabled();
+                if (ImGui::Checkbox("Validate Against CPU", &validate)) {
+                    m_scene->setGpuValidationEnabled(validate);
+                }
+                const LightSource* light = m_scene->getLightSource();
+                if (validate && light->hasGpuValidationResult()) {
+                    const GpuTracer::ValidationResult& result = light->getGpuValidationResult();
+                    ImGui::TextColored(result.passed() ? ImVec4(0.114f, 0.800f, 0.624f, 1.0f) : ImVec4(0.8f, 0.2f, 0.2f, 1.0f),
+                        "%s: %zu/%zu segments, %zu mismatches, max error %.4f",
+                        result.passed() ? "Match" : "Mismatch",
+                        result.gpuSegments, result.cpuSegments, result.hitMismatches, result.maxEndpointError);
+                }
             }
             
             // Add Performance Disclaimer
@@ -609,6 +920,74 @@ void Renderer::renderUI() {
             ImGui::TextWrapped("Note: Refreshing the scene will regenerate all obstacles with new random positions.");
             ImGui::PopStyleColor();
             
+            // Walls: segments, polygons and arcs traced alongside the circles
+            if (ImGui::Button("Add Room Walls", ImVec2(150, 30))) {
+                m_scene->addRoomWalls();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear Walls", ImVec2(150, 30))) {
+                m_scene->clearWalls();
+            }
+            const OccluderStore& walls = m_scene->getWalls();
+            ImGui::Text("Walls: %zu segments, %zu polygons, %zu arcs", walls.segmentCount(), walls.polygonCount(),
+                        walls.arcCount());
+            
+            // Binary scene file save/load
+            ImGui::PushItemWidth(ImGui::GetWindowWidth() * 0.5f);
+            ImGui::InputText("##ScenePath", m_scenePath, sizeof(m_scenePath));
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+            if (ImGui::Button("Save")) {
+                try {
+                    m_scene->saveScene(m_scenePath);
+                    m_sceneFileStatus = "Saved " + std::string(m_scenePath);
+                }
+                catch (const std::exception& e) {
+                    m_sceneFileStatus = e.what();
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Load")) {
+                try {
+                    m_scene->loadScene(m_scenePath);
+                    m_sceneFileStatus = "Loaded " + std::to_string(m_scene->getObstacleCount()) + " obstacles";
+                }
+                catch (const std::exception& e) {
+                    m_sceneFileStatus = e.what();
+                }
+            }
+            
+            // Trace recording
+            if (!m_scene->isTraceRecording()) {
+                if (ImGui::Button("Record Traces", ImVec2(150, 0))) {
+                    try {
+                        m_scene->startTraceRecording(TRACE_RECORDING_PATH);
+                        m_sceneFileStatus.clear();
+                    }
+                    catch (const std::exception& e) {
+                        m_sceneFileStatus = e.what();
+                    }
+                }
+            } else {
+                if (ImGui::Button("Stop Recording", ImVec2(150, 0))) {
+                    try {
+                        m_scene->stopTraceRecording();
+                        m_sceneFileStatus = std::string("Trace saved to ") + TRACE_RECORDING_PATH;
+                    }
+                    catch (const std::exception& e) {
+                        m_sceneFileStatus = e.what();
+                    }
+                }
+                if (const TraceRecorder* recorder = m_scene->getTraceRecorder()) {
+                    ImGui::SameLine();
+                    ImGui::Text("%llu frames, %.1f MB", static_cast<unsigned long long>(recorder->getFramesRecorded()),
+                                recorder->getBytesWritten() / (1024.0 * 1024.0));
+                }
+            }
+            if (!m_sceneFileStatus.empty()) {
+                ImGui::TextWrapped("%s", m_sceneFileStatus.c_str());
+            }
+            
             // Reset font scale
             ImGui::SetWindowFontScale(1.0f);
             ImGui::PopFont();
@@ -760,65 +1139,166 @@ void Renderer::showAboutWindow() {
     ImGui::PopStyleVar(3);
 }
 
+void Renderer::showProfilerWindow() {
+    ImGui::SetNextWindowSize(ImVec2(720, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", &m_showProfilerWindow)) {
+        ImGui::End();
+        return;
+    }
+    
+    const auto& events = Profiler::getFrameEvents();
+    const auto& threadNames = Profiler::getThreadNames();
+    double frameMs = Profiler::getFrameMs();
+    ImGui::Text("CPU frame: %.2f ms, %zu scopes", frameMs, events.size());
+    
+    // Frame times over the rolling window; spikes are hitches
+    std::vector<float> cpuFrameTimes = m_cpuFrameTimes.ordered();
+    if (!cpuFrameTimes.empty()) {
+        ImGui::PlotLines("##FrameTimes", cpuFrameTimes.data(), static_cast<int>(cpuFrameTimes.size()), 0,
+            "CPU frame ms", 0.0f, static_cast<float>(std::max(m_cpuFrameSummary.max, 1.0)),
+            ImVec2(ImGui::GetContentRegionAvail().x, 60.0f));
+    }
+    if (uint64_t dropped = Profiler::getDroppedEvents()) {
+        ImGui::SameLine();
+        ImGui::Text("(%llu dropped)", static_cast<unsigned long long>(dropped));
+    }
+    
+    if (!Profiler::isCapturing()) {
+        if (ImGui::Button("Capture 5 s (F9)")) {
+            Profiler::startCapture(PROFILE_CAPTURE_PATH, PROFILE_CAPTURE_SECONDS);
+        }
+    } else {
+        ImGui::Button("Capturing...");
+    }
+    if (!Profiler::getCaptureStatus().empty()) {
+        ImGui::SameLine();
+        ImGui::Text("%s", Profiler::getCaptureStatus().c_str());
+    }
+    
+    // Timeline of the last frame: one row per thread, one lane per nesting level
+    const float laneHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float labelWidth = 110.0f;
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float timelineWidth = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 50.0f);
+    double pixelsPerNs = frameMs > 0.0 ? timelineWidth / (frameMs * 1000000.0) : 0.0;
+    
+    std::vector<uint32_t> threadLanes(threadNames.size(), 0);
+    for (const auto& event : events) {
+        threadLanes[event.thread] = std::max(threadLanes[event.thread], event.depth + 1);
+    }
+    std::vector<float> threadTop(threadNames.size(), 0.0f);
+    float height = 0.0f;
+    for (size_t t = 0; t < threadNames.size(); ++t) {
+        if (threadLanes[t] == 0) continue;
+        threadTop[t] = height;
+        drawList->AddText(ImVec2(origin.x, origin.y + height + 2.0f), IM_COL32(200, 200, 200, 255), threadNames[t].c_str());
+        height += threadLanes[t] * laneHeight + 6.0f;
+    }
+    
+    const char* hoveredName = nullptr;
+    double hoveredMs = 0.0;
+    ImVec2 mouse = ImGui::GetIO().MousePos;
+    for (const auto& event : events) {
+        float x0 = origin.x + labelWidth + static_cast<float>(event.startNs * pixelsPerNs);
+        float x1 = origin.x + labelWidth + static_cast<float>(event.endNs * pixelsPerNs);
+        x1 = std::max(x1, x0 + 1.0f);
+        float y0 = origin.y + threadTop[event.thread] + event.depth * laneHeight;
+        float y1 = y0 + laneHeight - 1.0f;
+        
+        // Stable color per scope name
+        size_t hash = std::hash<std::string>()(event.name);
+        ImU32 color = ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.75f);
+        drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), color);
+        if (x1 - x0 > 20.0f) {
+            drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+            drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(20, 20, 20, 255), event.name);
+            drawList->PopClipRect();
+        }
+        if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+            hoveredName = event.name;
+            hoveredMs = (event.endNs - event.startNs) / 1000000.0;
+        }
+    }
+    ImGui::Dummy(ImVec2(labelWidth + timelineWidth, height));
+    if (hoveredName && ImGui::IsWindowHovered()) {
+        ImGui::SetTooltip("%s: %.3f ms", hoveredName, hoveredMs);
+    }
+    
+    ImGui::Separator();
+    
+    // Per-frame totals per scope, indented by nesting level
+    ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("ProfilerScopes", 6, tableFlags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Min ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("Max ms");
+        ImGui::TableHeadersRow();
+        for (const auto& scope : Profiler::getScopeStats()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Indent(scope.depth * 12.0f + 1.0f);
+            ImGui::TextUnformatted(scope.name.c_str());
+            ImGui::Unindent(scope.depth * 12.0f + 1.0f);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", scope.calls);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.lastMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.minMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.avgMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", scope.maxMs);
+        }
+        ImGui::EndTable();
+    }
+    
+    ImGui::End();
+}
+
 void Renderer::initPerformanceMonitoring() {
     // Initialize CPU monitoring
-    SYSTEM_INFO sysInfo;
-    GetSystemInfo(&sysInfo);
-    m_numProcessors = sysInfo.dwNumberOfProcessors;
-    
-    m_processHandle = GetCurrentProcess();
-    FILETIME dummy;
-    GetProcessTimes(m_processHandle, &m_lastCPU, &dummy, &m_lastUserCPU, &m_lastKernelCPU);
+    m_numProcessors = Platform::processorCount();
+    m_lastCpuTimes = Platform::processCpuTimes();
+    m_lastCpuSampleTime = Platform::monotonicSeconds();
     
     // Initialize GPU monitoring
-    glGenQueries(1, &m_gpuQuery);
+    m_gpuTimer = std::make_unique<GpuTimer>();
 }
 
 void Renderer::updatePerformanceStats() {
-    // Update CPU usage
-    FILETIME ftime, dummy, user, kernel;
-    GetProcessTimes(m_processHandle, &ftime, &dummy, &user, &kernel);
-    
-    // Convert FILETIME to ULONGLONG
-    ULONGLONG lastUser = ((ULONGLONG)m_lastUserCPU.dwHighDateTime << 32) | m_lastUserCPU.dwLowDateTime;
-    ULONGLONG lastKernel = ((ULONGLONG)m_lastKernelCPU.dwHighDateTime << 32) | m_lastKernelCPU.dwLowDateTime;
-    ULONGLONG lastCPU = ((ULONGLONG)m_lastCPU.dwHighDateTime << 32) | m_lastCPU.dwLowDateTime;
-    
-    ULONGLONG currentUser = ((ULONGLONG)user.dwHighDateTime << 32) | user.dwLowDateTime;
-    ULONGLONG currentKernel = ((ULONGLONG)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
-    ULONGLONG currentCPU = ((ULONGLONG)ftime.dwHighDateTime << 32) | ftime.dwLowDateTime;
-    
-    // Calculate CPU usage
-    ULONGLONG userDiff = currentUser - lastUser;
-    ULONGLONG kernelDiff = currentKernel - lastKernel;
-    ULONGLONG cpuDiff = currentCPU - lastCPU;
-    
-    if (cpuDiff > 0) {
-        float percent = (float)(userDiff + kernelDiff) / (float)cpuDiff;
-        percent /= m_numProcessors;
-        m_cpuUsage = percent * 100.0f;
-    }
-    
-    // Store current values for next update
-    m_lastCPU = ftime;
-    m_lastUserCPU = user;
-    m_lastKernelCPU = kernel;
-    
-    // Update GPU usage
-    if (!m_gpuQueryStarted) {
-        glBeginQuery(GL_TIME_ELAPSED, m_gpuQuery);
-        m_gpuQueryStarted = true;
-    } else {
-        glEndQuery(GL_TIME_ELAPSED);
-        GLuint64 timeElapsed;
-        glGetQueryObjectui64v(m_gpuQuery, GL_QUERY_RESULT, &timeElapsed);
+    // Update CPU usage: process CPU time over wall time, across all processors.
+    // The OS updates CPU times at a coarse tick, so sample at most every 0.5 s.
+    double now = Platform::monotonicSeconds();
+    double wallDiff = now - m_lastCpuSampleTime;
+    if (wallDiff >= 0.5) {
+        Platform::CpuTimes times = Platform::processCpuTimes();
+        double cpuDiff = times.total() - m_lastCpuTimes.total();
+        m_cpuUsage = static_cast<float>(cpuDiff / wallDiff / m_numProcessors * 100.0);
+        m_cpuUsage = std::clamp(m_cpuUsage, 0.0f, 100.0f);
         
-        // Convert nanoseconds to milliseconds and calculate percentage
-        // Assuming 16.67ms (60 FPS) as 100% GPU usage
-        m_gpuUsage = (timeElapsed / 1000000.0f) / 16.67f * 100.0f;
-        m_gpuUsage = std::min(m_gpuUsage, 100.0f); // Cap at 100%
+        m_residentMemory = Platform::residentMemoryBytes();
+        m_peakResidentMemory = Platform::peakResidentMemoryBytes();
         
-        // Start new query
-        glBeginQuery(GL_TIME_ELAPSED, m_gpuQuery);
+        m_cpuFrameSummary = m_cpuFrameTimes.summarize();
+        m_gpuFrameSummary = m_gpuFrameTimes.summarize();
+        
+        // Store current values for next update
+        m_lastCpuTimes = times;
+        m_lastCpuSampleTime = now;
+    }
+    
+    // Update GPU usage: GPU time of the last finished frames over the frame
+    // interval. The timings lag a few frames behind (see GpuTimer).
+    float framerate = ImGui::GetIO().Framerate;
+    if (m_gpuTimer->hasResults() && framerate > 0.0f) {
+        float frameIntervalMs = 1000.0f / framerate;
+        m_gpuUsage = static_cast<float>(m_gpuTimer->getFrameMs()) / frameIntervalMs * 100.0f;
+        m_gpuUsage = std::min(m_gpuUsage, 100.0f); // Cap at 100%
     }
 }
\ No newline at end of file
@@ -2,6 +2,11 @@
 
 #include "window.hpp"
 #include "scene.hpp"
+#include "platform.hpp"
+#include "gpu_timer.hpp"
+#include "profiler.hpp"
+#include "frame_times.hpp"
+#include "simulation_clock.hpp"
 #include <glm/glm.hpp>
 #define IMGUI_DEFINE_MATH_OPERATORS
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD
@@ -9,12 +14,11 @@
 #include <imgui_internal.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
-#include <windows.h>
-#include <psapi.h>
 
 class Renderer {
 public:
-    Renderer(Window& window);
+    // The clock drives the fixed-step simulation; SystemClock when null
+    Renderer(Window& window, std::unique_ptr<SimulationClock> clock = nullptr);
     ~Renderer();
 
     static void APIENTRY messageCallback(GLenum source, GLenum type, GLuint id,
@@ -28,34 +32,71 @@ public:
     void handleInput();
     void handleWindowResize();
     void showAboutWindow();
+    void showProfilerWindow();
+    
+    // Vsync waits for the display, Uncapped presents as fast as possible and
+    // Limited paces frames to the given rate with vsync off
+    enum class PresentMode { Vsync, Uncapped, Limited };
+    void setPresentMode(PresentMode mode, int frameRateLimit = 0);
+    Scene& getScene() { return *m_scene; }
 
 private:
     Window& m_window;
     glm::mat4 m_projectionMatrix;
     std::unique_ptr<Scene> m_scene;
     
+    // Simulation runs in fixed steps; rendering interpolates between them
+    std::unique_ptr<SimulationClock> m_clock;
+    FixedTimestep m_timestep;
+    double m_lastClockTime = 0.0;
+    bool m_hasClockTime = false;
+    
+    // Presentation pacing
+    PresentMode m_presentMode = PresentMode::Vsync;
+    int m_frameRateLimit = 144;
+    double m_nextFrameDeadline = 0.0;
+    
     // About window state
     bool m_showAboutWindow = false;
     bool m_aboutButtonHovered = false;
     
+    // Profiler window state; recording is enabled while it is open
+    bool m_showProfilerWindow = false;
+    bool m_captureKeyWasDown = false;
+    
+    // Scene file controls
+    char m_scenePath[260] = "scene.rtscene";
+    std::string m_sceneFileStatus;
+    
     // DPI scaling factors
     float m_dpiScaleX = 1.0f;
     float m_dpiScaleY = 1.0f;
     
     // Performance monitoring
-    GLuint m_gpuQuery;
+    std::unique_ptr<GpuTimer> m_gpuTimer;
     float m_cpuUsage = 0.0f;
     float m_gpuUsage = 0.0f;
-    bool m_gpuQueryStarted = false;
-    FILETIME m_lastCPU, m_lastSysCPU, m_lastUserCPU, m_lastKernelCPU;
-    int m_numProcessors;
-    HANDLE m_processHandle;
+    Platform::CpuTimes m_lastCpuTimes;
+    double m_lastCpuSampleTime = 0.0;
+    unsigned int m_numProcessors = 1;
+    uint64_t m_residentMemory = 0;
+    uint64_t m_peakResidentMemory = 0;
+    
+    // Frame time percentiles (CPU: interval between frames, GPU: GpuTimer)
+    FrameTimeHistory m_cpuFrameTimes;
+    FrameTimeHistory m_gpuFrameTimes;
+    FrameTimeHistory::Summary m_cpuFrameSummary;
+    FrameTimeHistory::Summary m_gpuFrameSummary;
+    double m_lastFrameStart = 0.0;
+    std::string m_frameTimesStatus;
     
     void initImGui();
     void initGL();
     void updateDPIScale();
     void initPerformanceMonitoring();
     void updatePerformanceStats();
+    void stepSimulation();
+    void limitFrameRate();
     
     glm::vec2 screenToWorld(double xpos, double ypos);
 };
\ No newline at end of file
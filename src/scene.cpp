@@ -1,19 +1,26 @@
 #include "scene.hpp"
 #include "shaders.hpp"
+#include "scene_binary.hpp"
+#include "scene_text.hpp"
+#include "profiler.hpp"
+#include "log.hpp"
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <random>
 #include <algorithm>
-#include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 #include <chrono>
+#include <cstddef>
 
 // Initialize static member
 int Scene::s_desiredObstacleCount = 10;
 int Scene::s_rayCount = 90;  // Initialize with default value
 
+// Center vertex + 32 segments + 1 closing vertex
+static constexpr int CIRCLE_SEGMENTS = 32;
+static constexpr int CIRCLE_VERTEX_COUNT = CIRCLE_SEGMENTS + 2;
+
 // Helper function to create circle vertices
-std::vector<float> createCircleVertices(int segments = 32) {
+std::vector<float> createCircleVertices(int segments = CIRCLE_SEGMENTS) {
     std::vector<float> vertices;
     // Center vertex
     vertices.push_back(0.0f);
@@ -28,36 +35,27 @@ std::vector<float> createCircleVertices(int segments = 32) {
     return vertices;
 }
 
-// GameObject implementations
-void setupCircleBuffer(unsigned int& VAO, unsigned int& VBO, const std::vector<float>& vertices) {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
 // LightSource implementation
 LightSource::LightSource(Scene* scene, const glm::vec2& position)
     : GameObject(scene, position, 20.0f), m_intensity(1.0f) {
-    auto vertices = createCircleVertices();
-    setupCircleBuffer(m_VAO, m_VBO, vertices);
-
-    // Initialize rays
-    m_rays.resize(NUM_RAYS);
-    updateRays();
-
-    // Setup ray buffer
+    // Setup ray buffer: position, color and dash parameters per vertex.
+    // The instance position/scale attributes stay disabled and use the
+    // generic values set through Scene::setDrawConstants.
     glGenVertexArrays(1, &m_rayVAO);
     glGenBuffers(1, &m_rayVBO);
 
+    glBindVertexArray(m_rayVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_rayVBO);
+    glVertexAttribPointer(Shaders::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, position));
+    glEnableVertexAttribArray(Shaders::ATTRIB_POSITION);
+    glVertexAttribPointer(Shaders::ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, color));
+    glEnableVertexAttribArray(Shaders::ATTRIB_COLOR);
+    glVertexAttribPointer(Shaders::ATTRIB_DASH, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, dash));
+    glEnableVertexAttribArray(Shaders::ATTRIB_DASH);
+
     // Setup crosshair buffer
     glGenVertexArrays(1, &m_crosshairVAO);
     glGenBuffers(1, &m_crosshairVBO);
@@ -76,355 +74,188 @@ LightSource::LightSource(Scene* scene, const glm::vec2& position)
     glBindBuffer(GL_ARRAY_BUFFER, m_crosshairVBO);
     glBufferData(GL_ARRAY_BUFFER, crosshairVertices.size() * sizeof(float), crosshairVertices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(Shaders::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(Shaders::ATTRIB_POSITION);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
 LightSource::~LightSource() {
-    glDeleteVertexArrays(1, &m_VAO);
-    glDeleteBuffers(1, &m_VBO);
     glDeleteVertexArrays(1, &m_rayVAO);
     glDeleteBuffers(1, &m_rayVBO);
     glDeleteVertexArrays(1, &m_crosshairVAO);
     glDeleteBuffers(1, &m_crosshairVBO);
 }
 
-void LightSource::updateRays() {
-    // Clear existing rays
-    m_rays.clear();
-    m_reflectedRays.clear();
-    
-    // Get the current ray count from Scene
-    int numRays = Scene::getRayCount();
-    
-    // Generate rays in a circle around the light source
-    for (int i = 0; i < numRays; i++) {
-        float angle = 2.0f * 3.14159f * float(i) / float(numRays);
-        glm::vec2 direction(cos(angle), sin(angle));
-        
-        Ray ray;
-        ray.origin = m_position;
-        ray.direction = direction;
-        ray.length = MAX_RAY_LENGTH;
-        ray.color = glm::vec3(RAY_INTENSITY);
-        
-        m_rays.push_back(ray);
-    }
+TraceScene LightSource::makeTraceScene() const {
+    const Scene* scene = static_cast<const Scene*>(m_scene);
+    
+    TraceScene traceScene;
+    traceScene.lightOrigin = scene->getLightRenderPosition();
+    traceScene.mainPosition = scene->getMainObject()->getPosition();
+    traceScene.mainRadius = scene->getMainObject()->getRadius();
+    traceScene.obstacles = scene->getObstacles().view();
+    traceScene.obstacleIor = scene->getObstacles().iors();
+    traceScene.obstacleColors = scene->getObstacles().colors();
+    traceScene.occluders = scene->getWalls().view();
+    traceScene.mainReflectance = Tracer::reflectance(scene->getMainObject()->getColor());
+    return traceScene;
 }
 
-void LightSource::processReflections(const Ray& incidentRay, const glm::vec2& intersectionPoint, 
-                                   const glm::vec2& normal, const GameObject* hitObject) {
-    if (incidentRay.reflectionCount >= Ray::MAX_REFLECTIONS) return;
-
-    Ray reflectedRay = incidentRay;
-    reflectedRay.origin = intersectionPoint;
-    reflectedRay.direction = incidentRay.calculateReflection(normal);
-    reflectedRay.isReflected = true;
-    reflectedRay.reflectionCount = incidentRay.reflectionCount + 1;
-    
-    // Make each subsequent reflection progressively shorter
-    float lengthFactor = REFLECTION_LENGTH_FACTOR * std::pow(0.7f, reflectedRay.reflectionCount - 1);
-    reflectedRay.length = MAX_RAY_LENGTH * lengthFactor;
+TraceSettings LightSource::makeTraceSettings() const {
+    const Scene* scene = static_cast<const Scene*>(m_scene);
     
-    reflectedRay.color = calculateReflectionColor(incidentRay.color, reflectedRay.reflectionCount);
-    
-    m_reflectedRays.push_back(reflectedRay);
+    TraceSettings settings;
+    settings.rayCount = Scene::getRayCount();
+    settings.reflections = scene->areReflectionsEnabled();
+    settings.maxSegments = static_cast<uint64_t>(settings.rayCount) * SEGMENT_BUDGET_PER_RAY;
+    settings.dispersion = scene->getDispersion();
+    settings.primaryColor = m_color * RAY_INTENSITY;
+    return settings;
 }
 
-glm::vec3 LightSource::calculateReflectionColor(const glm::vec3& baseColor, int reflectionCount) const {
-    // Base colors for different ray types (in RGB format)
-    const glm::vec3 PRIMARY_RAY_COLOR(1.0f, 0.95f, 0.4f);     // Bright warm yellow
-    const glm::vec3 REFLECTED_RAY_COLOR(1.0f, 0.65f, 0.2f);   // Orange color for first reflection
-    const glm::vec3 REREFLECTED_RAY_COLOR(1.0f, 0.3f, 0.1f);  // Red color for second reflection
-
-    // Select base color based on reflection count
-    glm::vec3 color;
-    if (reflectionCount == 0) {
-        color = PRIMARY_RAY_COLOR;
-    } else if (reflectionCount == 1) {
-        color = REFLECTED_RAY_COLOR;
-    } else {
-        color = REREFLECTED_RAY_COLOR;
+void LightSource::traceRays() {
+    PROFILE_SCOPE("LightSource::traceRays");
+    Scene* scene = static_cast<Scene*>(m_scene);
+    TraceScene traceScene = makeTraceScene();
+    TraceSettings settings = makeTraceSettings();
+    m_tracer.setKernel(scene->getCpuTraceKernel());
+    
+    // The compute tracer only knows mirror circles; scenes with walls or
+    // glass obstacles stay on the CPU
+    m_tracedOnGpu = false;
+    if (scene->getTracingBackend() == Scene::TracingBackend::GpuCompute && traceScene.occluders.empty() &&
+        scene->getObstacles().refractiveCount() == 0) {
+        m_tracedOnGpu = traceRaysGpu(traceScene, settings);
     }
-
-    // Apply a gentler intensity falloff for better visibility
-    float intensityFactor;
-    if (reflectionCount == 0) {
-        intensityFactor = 1.0f;  // Full intensity for primary rays
-    } else if (reflectionCount == 1) {
-        intensityFactor = 1.0f;  // High intensity for first reflection (orange)
-    } else {
-        intensityFactor = 1.0f; // High intensity for second reflection (red)
+    if (!m_tracedOnGpu) {
+        traceRaysCpu(traceScene, settings);
     }
     
-    color *= intensityFactor;
-
-    return color;
+    if (scene->isTraceRecording()) {
+        // The GPU backend keeps its segments on the GPU; record the CPU
+        // reference trace instead, which validation keeps in agreement
+        if (m_tracedOnGpu) {
+            m_tracer.trace(traceScene, settings, m_segments);
+        }
+        scene->recordTrace(m_segments);
+    }
 }
 
-void LightSource::renderRays(const glm::mat4& projection, unsigned int shaderProgram) {
-    // Update ray positions
-    updateRays();
+void LightSource::renderRays() {
+    Scene* scene = static_cast<Scene*>(m_scene);
     
-    // Prepare ray vertices
-    std::vector<float> rayVertices;
-    rayVertices.reserve((m_rays.size() + m_reflectedRays.size()) * 4); // 2 points per ray, 2 floats per point
+    // Rays are in world space; colors come from the vertex data
+    scene->setDrawConstants(glm::vec2(0.0f), 1.0f, m_color * RAY_INTENSITY);
+    glLineWidth(1.5f);
     
-    Scene* scene = static_cast<Scene*>(m_scene);
+    if (m_tracedOnGpu) {
+        m_gpuTracer->draw();
+        scene->countDrawCall();
+    } else if (!m_rayVertices.empty()) {
+        glBindVertexArray(m_rayVAO);
+        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(m_rayVertices.size()));
+        scene->countDrawCall();
+    }
     
-    // Process primary rays
-    for (const auto& ray : m_rays) {
-        // Ray start point
-        rayVertices.push_back(ray.origin.x);
-        rayVertices.push_back(ray.origin.y);
-        
-        // Check intersections with all objects
-        float minDist = ray.length;
-        float intersectionDist;
-        glm::vec2 intersectionPoint;
-        const GameObject* hitObject = nullptr;
-        
-        // Check main object
-        if (ray.intersectsCircle(scene->getMainObject()->getPosition(),
-                               scene->getMainObject()->getRadius(),
-                               intersectionDist)) {
-            minDist = intersectionDist;
-            hitObject = scene->getMainObject();
-            intersectionPoint = ray.origin + ray.direction * intersectionDist;
-        }
-        
-        // Check obstacles
-        for (const auto& obstacle : scene->getObstacles()) {
-            if (ray.intersectsCircle(obstacle->getPosition(),
-                                   obstacle->getRadius(),
-                                   intersectionDist)) {
-                if (intersectionDist < minDist) {
-                    minDist = intersectionDist;
-                    hitObject = obstacle.get();
-                    intersectionPoint = ray.origin + ray.direction * intersectionDist;
-                }
-            }
-        }
-        
-        // Ray end point
-        glm::vec2 endPoint = ray.origin + ray.direction * minDist;
-        rayVertices.push_back(endPoint.x);
-        rayVertices.push_back(endPoint.y);
-        
-        // Process reflection if there was a hit and reflections are enabled
-        if (hitObject && scene->areReflectionsEnabled()) {
-            glm::vec2 normal = glm::normalize(intersectionPoint - hitObject->getPosition());
-            processReflections(ray, intersectionPoint, normal, hitObject);
+    glLineWidth(1.0f);
+    glBindVertexArray(0);
+}
+
+void LightSource::traceRaysCpu(const TraceScene& traceScene, const TraceSettings& settings) {
+    m_tracer.trace(traceScene, settings, m_segments);
+    
+    // Primary rays are drawn solid, reflected rays dashed; the dash pattern
+    // is applied in the fragment shader from the distance along the ray.
+    // Colors fade with the ray's energy towards the end. The vector keeps
+    // its capacity between frames.
+    {
+        PROFILE_SCOPE("Build ray vertices");
+        m_rayVertices.clear();
+        for (const auto& segment : m_segments) {
+            float dashed = segment.depth > 0 ? 1.0f : 0.0f;
+            float length = glm::length(segment.end - segment.origin);
+            m_rayVertices.push_back({segment.origin, segment.color, glm::vec2(0.0f, dashed)});
+            m_rayVertices.push_back({segment.end, segment.color * segment.attenuation, glm::vec2(length, dashed)});
         }
     }
     
-    // Process reflected rays and their subsequent reflections only if reflections are enabled
-    if (scene->areReflectionsEnabled()) {
-        std::vector<Ray> allReflectedRays = m_reflectedRays;
-        m_reflectedRays.clear(); // Clear the original reflected rays as we'll process them all
-        
-        while (!allReflectedRays.empty()) {
-            Ray currentRay = allReflectedRays.back();
-            allReflectedRays.pop_back();
-            
-            // Add the current ray to the final reflected rays list
-            m_reflectedRays.push_back(currentRay);
-            
-            // Add vertices for the current ray
-            rayVertices.push_back(currentRay.origin.x);
-            rayVertices.push_back(currentRay.origin.y);
-            
-            // Check intersections with all objects
-            float minDist = currentRay.length;
-            float intersectionDist;
-            glm::vec2 intersectionPoint;
-            const GameObject* hitObject = nullptr;
-            
-            // Check main object
-            if (currentRay.intersectsCircle(scene->getMainObject()->getPosition(),
-                                          scene->getMainObject()->getRadius(),
-                                          intersectionDist)) {
-                minDist = intersectionDist;
-                hitObject = scene->getMainObject();
-                intersectionPoint = currentRay.origin + currentRay.direction * intersectionDist;
-            }
-            
-            // Check obstacles
-            for (const auto& obstacle : scene->getObstacles()) {
-                if (currentRay.intersectsCircle(obstacle->getPosition(),
-                                              obstacle->getRadius(),
-                                              intersectionDist)) {
-                    if (intersectionDist < minDist) {
-                        minDist = intersectionDist;
-                        hitObject = obstacle.get();
-                        intersectionPoint = currentRay.origin + currentRay.direction * intersectionDist;
-                    }
-                }
-            }
-            
-            // Ray end point
-            glm::vec2 endPoint = currentRay.origin + currentRay.direction * minDist;
-            rayVertices.push_back(endPoint.x);
-            rayVertices.push_back(endPoint.y);
-            
-            // Process further reflections if there was a hit and we haven't reached max reflections
-            if (hitObject && currentRay.reflectionCount < Ray::MAX_REFLECTIONS) {
-                glm::vec2 normal = glm::normalize(intersectionPoint - hitObject->getPosition());
-                
-                // Create the next reflection
-                Ray nextReflection = currentRay;
-                nextReflection.origin = intersectionPoint;
-                nextReflection.direction = currentRay.calculateReflection(normal);
-                nextReflection.isReflected = true;
-                nextReflection.reflectionCount = currentRay.reflectionCount + 1;
-                
-                // Make each subsequent reflection progressively shorter
-                float lengthFactor = REFLECTION_LENGTH_FACTOR * std::pow(0.7f, nextReflection.reflectionCount - 1);
-                nextReflection.length = MAX_RAY_LENGTH * lengthFactor;
-                
-                nextReflection.color = calculateReflectionColor(currentRay.color, nextReflection.reflectionCount);
-                
-                // Add to the list of rays to process
-                allReflectedRays.push_back(nextReflection);
-            }
-        }
+    if (m_rayVertices.empty()) {
+        return;
     }
     
-    // Update buffer data
+    // Upload all ray segments at once, growing the buffer only when needed
+    PROFILE_SCOPE("Upload ray vertices");
     glBindVertexArray(m_rayVAO);
     glBindBuffer(GL_ARRAY_BUFFER, m_rayVBO);
-    glBufferData(GL_ARRAY_BUFFER, rayVertices.size() * sizeof(float), rayVertices.data(), GL_DYNAMIC_DRAW);
-    
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    if (m_rayVertices.size() > m_rayVBOCapacity) {
+        m_rayVBOCapacity = m_rayVertices.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, m_rayVBOCapacity * sizeof(RayVertex), nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_rayVertices.size() * sizeof(RayVertex), m_rayVertices.data());
+    glBindVertexArray(0);
+    static_cast<Scene*>(m_scene)->countRayVertexUpload(m_rayVertices.size() * sizeof(RayVertex));
+}
+
+bool LightSource::traceRaysGpu(const TraceScene& traceScene, const TraceSettings& settings) {
+    Scene* scene = static_cast<Scene*>(m_scene);
     
-    // Render rays
-    glUseProgram(shaderProgram);
+    if (!m_gpuTracer) {
+        try {
+            m_gpuTracer = std::make_unique<GpuTracer>();
+        } catch (const std::exception& e) {
+            // Fall back to the CPU tracer for the rest of the session
+            LOG_WARNING(Tracing, "GPU tracing unavailable: %s", e.what());
+            scene->setTracingBackend(Scene::TracingBackend::Cpu);
+            return false;
+        }
+    }
     
-    // Render primary rays
-    glm::vec3 rayColor = m_color * RAY_INTENSITY;
-    static_cast<Scene*>(m_scene)->setShaderUniforms(projection, glm::vec2(0.0f), 1.0f, rayColor);
-    glLineWidth(1.5f);
-    glDrawArrays(GL_LINES, 0, m_rays.size() * 2);
+    {
+        PROFILE_SCOPE("GpuTracer::dispatch");
+        m_gpuTracer->dispatch(traceScene, settings);
+        scene->countUpload(m_gpuTracer->getLastUploadBytes());
+    }
     
-    // Render reflected rays with different colors and dashed lines only if reflections are enabled
-    if (scene->areReflectionsEnabled()) {
-        for (size_t i = 0; i < m_reflectedRays.size(); ++i) {
-            const auto& ray = m_reflectedRays[i];
-            static_cast<Scene*>(m_scene)->setShaderUniforms(projection, glm::vec2(0.0f), 1.0f, ray.color);
-            
-            // Draw dashed line manually by drawing multiple small segments
-            const int numSegments = 10;
-            const float segmentLength = 5.0f;
-            const float gapLength = 5.0f;
-            
-            glm::vec2 start = ray.origin;
-            glm::vec2 end = ray.origin + ray.direction * ray.length;
-            glm::vec2 dir = glm::normalize(end - start);
-            float totalLength = glm::length(end - start);
-            float currentLength = 0.0f;
-            
-            while (currentLength < totalLength) {
-                float remainingLength = totalLength - currentLength;
-                float currentSegmentLength = std::min(segmentLength, remainingLength);
-                
-                glm::vec2 segmentStart = start + dir * currentLength;
-                glm::vec2 segmentEnd = segmentStart + dir * currentSegmentLength;
-                
-                std::vector<float> segmentVertices = {
-                    segmentStart.x, segmentStart.y,
-                    segmentEnd.x, segmentEnd.y
-                };
-                
-                glBindBuffer(GL_ARRAY_BUFFER, m_rayVBO);
-                glBufferData(GL_ARRAY_BUFFER, segmentVertices.size() * sizeof(float), segmentVertices.data(), GL_DYNAMIC_DRAW);
-                glDrawArrays(GL_LINES, 0, 2);
-                
-                currentLength += currentSegmentLength + gapLength;
-            }
-        }
+    if (scene->isGpuValidationEnabled()) {
+        PROFILE_SCOPE("GpuTracer::validate");
+        m_validationResult = m_gpuTracer->validate(traceScene, settings, m_tracer);
+        m_hasValidationResult = true;
     }
     
-    glLineWidth(1.0f);
-    glBindVertexArray(0);
-}
-
-void Scene::setShaderUniforms(const glm::mat4& projection, const glm::vec2& position, float scale, const glm::vec3& color) {
-    glUniformMatrix4fv(m_uniforms.projection, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform2fv(m_uniforms.position, 1, glm::value_ptr(position));
-    glUniform1f(m_uniforms.scale, scale);
-    glUniform3fv(m_uniforms.color, 1, glm::value_ptr(color));
+    // The compute dispatch changed the bound program
+    glUseProgram(scene->getShaderProgram());
+    return true;
 }
 
-void LightSource::render(const glm::mat4& projection, unsigned int shaderProgram) {
-    // Render the light source circle
-    glUseProgram(shaderProgram);
-    static_cast<Scene*>(m_scene)->setShaderUniforms(projection, m_position, m_radius, m_color);
-    glBindVertexArray(m_VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 34); // Center vertex + 32 segments + 1 closing vertex
-
-    // Render the rays
-    renderRays(projection, shaderProgram);
-
-    // Render the crosshair last, on top of everything
-    renderCrosshair(projection, shaderProgram);
+void Scene::setDrawConstants(const glm::vec2& position, float scale, const glm::vec3& color) const {
+    glVertexAttrib2f(Shaders::ATTRIB_INSTANCE_POSITION, position.x, position.y);
+    glVertexAttrib1f(Shaders::ATTRIB_INSTANCE_SCALE, scale);
+    glVertexAttrib3f(Shaders::ATTRIB_COLOR, color.r, color.g, color.b);
 }
 
-void LightSource::renderCrosshair(const glm::mat4& projection, unsigned int shaderProgram) {
-    glUseProgram(shaderProgram);
-    static_cast<Scene*>(m_scene)->setShaderUniforms(projection, m_position, 1.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+void LightSource::renderCrosshair() {
+    Scene* scene = static_cast<Scene*>(m_scene);
+    scene->setDrawConstants(scene->getLightRenderPosition(), 1.0f, glm::vec3(1.0f, 0.0f, 0.0f));
 
     glBindVertexArray(m_crosshairVAO);
     glLineWidth(CROSSHAIR_THICKNESS);
     glDrawArrays(GL_LINES, 0, 4);
+    scene->countDrawCall();
     glLineWidth(1.0f);
     glBindVertexArray(0);
 }
 
-// Obstacle implementation
-Obstacle::Obstacle(Scene* scene, const glm::vec2& position)
-    : GameObject(scene, position, 30.0f) {
-    auto vertices = createCircleVertices();
-    setupCircleBuffer(m_VAO, m_VBO, vertices);
-}
-
-Obstacle::~Obstacle() {
-    glDeleteVertexArrays(1, &m_VAO);
-    glDeleteBuffers(1, &m_VBO);
-}
-
-void Obstacle::render(const glm::mat4& projection, unsigned int shaderProgram) {
-    glUseProgram(shaderProgram);
-    static_cast<Scene*>(m_scene)->setShaderUniforms(projection, m_position, m_radius, m_color);
-    glBindVertexArray(m_VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 34); // Center vertex + 32 segments + 1 closing vertex
-}
-
 // MainObject implementation
 MainObject::MainObject(Scene* scene, const glm::vec2& position)
     : GameObject(scene, position, 25.0f), m_isDragging(false) {
-    auto vertices = createCircleVertices();
-    setupCircleBuffer(m_VAO, m_VBO, vertices);
-}
-
-MainObject::~MainObject() {
-    glDeleteVertexArrays(1, &m_VAO);
-    glDeleteBuffers(1, &m_VBO);
-}
-
-void MainObject::render(const glm::mat4& projection, unsigned int shaderProgram) {
-    glUseProgram(shaderProgram);
-    static_cast<Scene*>(m_scene)->setShaderUniforms(projection, m_position, m_radius, m_color);
-    glBindVertexArray(m_VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 34); // Center vertex + 32 segments + 1 closing vertex
 }
 
 // Scene implementation
 Scene::Scene() {
     initShaders();
+    initBuffers();
     
     // Initialize light source on the left side
     m_lightSource = std::make_unique<LightSource>(this, glm::vec2(-500.0f, 0.0f));
@@ -446,20 +277,119 @@ Scene::Scene() {
 }
 
 Scene::~Scene() {
+    glDeleteBuffers(1, &m_frameUBO);
+    glDeleteVertexArrays(1, &m_circleVAO);
+    glDeleteBuffers(1, &m_circleVBO);
+    glDeleteBuffers(1, &m_instanceVBO);
+    glDeleteVertexArrays(1, &m_wallVAO);
+    glDeleteBuffers(1, &m_wallVBO);
     glDeleteProgram(m_shaderProgram);
 }
 
-void Scene::cacheUniformLocations() {
-    m_uniforms.projection = glGetUniformLocation(m_shaderProgram, "projection");
-    m_uniforms.position = glGetUniformLocation(m_shaderProgram, "position");
-    m_uniforms.scale = glGetUniformLocation(m_shaderProgram, "scale");
-    m_uniforms.color = glGetUniformLocation(m_shaderProgram, "color");
+void Scene::initBuffers() {
+    // Per-frame uniform block, bound once to the binding point declared in the shader
+    glGenBuffers(1, &m_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shaders::FRAME_UBO_BINDING, m_frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Shared unit circle mesh with per-instance position, scale and color
+    auto vertices = createCircleVertices();
+    glGenVertexArrays(1, &m_circleVAO);
+    glGenBuffers(1, &m_circleVBO);
+    glGenBuffers(1, &m_instanceVBO);
+
+    glBindVertexArray(m_circleVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_circleVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(Shaders::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(Shaders::ATTRIB_POSITION);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glVertexAttribPointer(Shaders::ATTRIB_INSTANCE_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(CircleInstance),
+                          (void*)offsetof(CircleInstance, position));
+    glEnableVertexAttribArray(Shaders::ATTRIB_INSTANCE_POSITION);
+    glVertexAttribDivisor(Shaders::ATTRIB_INSTANCE_POSITION, 1);
+    glVertexAttribPointer(Shaders::ATTRIB_INSTANCE_SCALE, 1, GL_FLOAT, GL_FALSE, sizeof(CircleInstance),
+                          (void*)offsetof(CircleInstance, scale));
+    glEnableVertexAttribArray(Shaders::ATTRIB_INSTANCE_SCALE);
+    glVertexAttribDivisor(Shaders::ATTRIB_INSTANCE_SCALE, 1);
+    glVertexAttribPointer(Shaders::ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(CircleInstance),
+                          (void*)offsetof(CircleInstance, color));
+    glEnableVertexAttribArray(Shaders::ATTRIB_COLOR);
+    glVertexAttribDivisor(Shaders::ATTRIB_COLOR, 1);
+
+    // Wall lines use the ray vertex layout, drawn like the rays
+    glGenVertexArrays(1, &m_wallVAO);
+    glGenBuffers(1, &m_wallVBO);
+    glBindVertexArray(m_wallVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_wallVBO);
+    glVertexAttribPointer(Shaders::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, position));
+    glEnableVertexAttribArray(Shaders::ATTRIB_POSITION);
+    glVertexAttribPointer(Shaders::ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, color));
+    glEnableVertexAttribArray(Shaders::ATTRIB_COLOR);
+    glVertexAttribPointer(Shaders::ATTRIB_DASH, 2, GL_FLOAT, GL_FALSE, sizeof(RayVertex),
+                          (void*)offsetof(RayVertex, dash));
+    glEnableVertexAttribArray(Shaders::ATTRIB_DASH);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
 
-    // Verify uniform locations
-    if (m_uniforms.projection == -1 || m_uniforms.position == -1 ||
-        m_uniforms.scale == -1 || m_uniforms.color == -1) {
-        throw std::runtime_error("Failed to locate shader uniforms");
+void Scene::updateFrameUniforms(const glm::mat4& projection) {
+    static_assert(sizeof(FrameUniforms) == 96, "FrameUniforms must match the std140 FrameData block");
+    
+    FrameUniforms frame{};
+    frame.projection = projection;
+    frame.viewport = glm::vec4(0.0f, 0.0f, m_screenWidth, m_screenHeight);
+    frame.time = static_cast<float>(m_simulationTime);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    countUpload(sizeof(FrameUniforms));
+}
+
+void Scene::updateCircleInstances() {
+    // Instance 0 is the light source, followed by the obstacles and the main object
+    m_circleInstances.clear();
+    m_circleInstances.push_back({getLightRenderPosition(), m_lightSource->getRadius(), m_lightSource->getColor()});
+    const glm::vec3 GLASS_TINT(0.55f, 0.8f, 1.0f);
+    for (size_t i = 0; i < m_obstacles.size(); ++i) {
+        glm::vec3 color = m_obstacles.getColor(i);
+        if (m_obstacles.getIor(i) > 0.0f) {
+            color = glm::mix(color, GLASS_TINT, 0.6f);
+        }
+        m_circleInstances.push_back({m_obstacles.getPosition(i), m_obstacles.getRadius(i), color});
+    }
+    m_circleInstances.push_back({m_mainObject->getPosition(), m_mainObject->getRadius(), m_mainObject->getColor()});
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    if (m_circleInstances.size() > m_instanceCapacity) {
+        m_instanceCapacity = m_circleInstances.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(CircleInstance), nullptr, GL_DYNAMIC_DRAW);
     }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_circleInstances.size() * sizeof(CircleInstance), m_circleInstances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    countUpload(m_circleInstances.size() * sizeof(CircleInstance));
+}
+
+void Scene::updateWallVertices() {
+    const glm::vec3 WALL_COLOR(0.75f, 0.8f, 0.9f);
+    m_wallVertices.clear();
+    m_walls.forEachOutlineLine(WALL_ARC_STEP, [&](const glm::vec2& from, const glm::vec2& to) {
+        m_wallVertices.push_back({from, WALL_COLOR, glm::vec2(0.0f)});
+        m_wallVertices.push_back({to, WALL_COLOR, glm::vec2(0.0f)});
+    });
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_wallVBO);
+    glBufferData(GL_ARRAY_BUFFER, m_wallVertices.size() * sizeof(RayVertex), m_wallVertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    countUpload(m_wallVertices.size() * sizeof(RayVertex));
+    m_wallsChanged = false;
 }
 
 void Scene::initShaders() {
@@ -510,22 +440,32 @@ void Scene::initShaders() {
     // Clean up
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
-
-    // Cache uniform locations after program is linked
-    cacheUniformLocations();
 }
 
-void Scene::update() {
+void Scene::update(float deltaTime) {
+    PROFILE_SCOPE("Scene::update");
+    m_simulationTime += deltaTime;
+    
+    if (m_obstaclesMoving && !m_obstacles.empty()) {
+        // Obstacles regenerated or loaded since the last step get new velocities
+        if (m_obstacleMotion.size() != m_obstacles.size()) {
+            m_obstacleMotion.reset(m_obstacles.size(), m_obstacleSpeed, m_random);
+        }
+        glm::vec2 lightPos = m_lightSource->getPosition();
+        glm::vec2 mainPos = m_mainObject->getPosition();
+        float fixedX[] = {lightPos.x, mainPos.x};
+        float fixedY[] = {lightPos.y, mainPos.y};
+        float fixedRadius[] = {m_lightSource->getRadius(), m_mainObject->getRadius()};
+        glm::vec2 halfScreen(m_screenWidth / 2.0f, m_screenHeight / 2.0f);
+        m_obstacleMotion.step(m_obstacles, CircleView{fixedX, fixedY, fixedRadius, 2}, m_walls.view(), -halfScreen,
+                              halfScreen, deltaTime);
+        invalidateLightSpace();
+    }
+    
     // Update game objects
     if (m_lightAutoMove && m_lightSource) {
-        // Use delta time for frame-rate independent movement
-        static float lastTime = 0.0f;
-        float currentTime = static_cast<float>(glfwGetTime());
-        float deltaTime = currentTime - lastTime;
-        lastTime = currentTime;
-        
-        // Cap delta time to avoid large jumps
-        deltaTime = std::min(deltaTime, 0.1f);
+        // State at the start of the step, for interpolated rendering
+        m_lightPreviousPosition = m_lightSource->getPosition();
         
         m_lightAutoMoveTimer += deltaTime;
         
@@ -537,11 +477,12 @@ void Scene::update() {
         
         // Need new target if:
         // 1. Timer has expired
-        // 2. We've reached the current target
-        // 3. Current target is invalid
+        // 2. We're within the light's own clearance of the current target
+        // 3. Current target is no longer free
+        float reachDistance = 2.0f * m_lightSource->getRadius() + LIGHT_STEP_CLEARANCE;
         if (m_lightAutoMoveTimer >= LIGHT_AUTO_MOVE_INTERVAL || 
-            glm::length(currentPos - m_lightTargetPos) < 1.0f ||
-            !checkValidPosition(m_lightTargetPos, m_lightSource->getRadius(), true)) {
+            glm::length(currentPos - m_lightTargetPos) < reachDistance ||
+            !getLightSpace(0).isFree(m_lightTargetPos)) {
             needNewTarget = true;
         }
         
@@ -549,223 +490,17 @@ void Scene::update() {
         if (needNewTarget) {
             m_lightAutoMoveTimer = 0.0f;
             
-            // Calculate safe area bounds (excluding controls section)
-            float controlsXMin = m_screenWidth/2.0f - CONTROLS_WIDTH - CONTROLS_MARGIN;
-            float controlsYMin = -m_screenHeight/2.0f + CONTROLS_MARGIN;
-            
-            // Use screen bounds with padding, avoiding controls area
-            float padding = m_lightSource->getRadius() + 30.0f;
-            float minX = -m_screenWidth/2.0f + padding;
-            float maxX = controlsXMin - padding;
-            float minY = -m_screenHeight/2.0f + padding;
-            float maxY = m_screenHeight/2.0f - padding;
-            
-            std::cout << "Screen bounds: (" << minX << ", " << minY << ") to (" << maxX << ", " << maxY << ")" << std::endl;
-            
-            // Try to find a valid position
-            int maxAttempts = 300; // Increased from 200
-            bool foundValidPosition = false;
-            
-            // Create a random number generator with a time-based seed
-            static std::random_device rd;
-            static std::mt19937 gen(rd());
-            static std::uniform_real_distribution<float> xDist(minX, maxX);
-            static std::uniform_real_distribution<float> yDist(minY, maxY);
-            
-            // Try to find a position that's far from current position
-            float minDistance = 400.0f; // Increased from 300.0f
-            for (int i = 0; i < maxAttempts; i++) {
-                // Generate a new position
-                glm::vec2 newPos = glm::vec2(xDist(gen), yDist(gen));
-                
-                // Skip if too close to current position
-                if (glm::length(newPos - currentPos) < minDistance) {
-                    continue;
-                }
-                
-                // Check if the position is valid
-                bool isValid = true;
-                
-                // Check if position is in controls area
-                if (newPos.x > controlsXMin && newPos.y > controlsYMin) {
-                    isValid = false;
-                    continue;
-                }
-                
-                // Check distance to main object
-                float distToMain = glm::length(newPos - m_mainObject->getPosition());
-                if (distToMain < (m_lightSource->getRadius() + m_mainObject->getRadius() + 40.0f)) { // Increased from 30.0f
-                    isValid = false;
-                    continue;
-                }
-                
-                // Check distance to obstacles
-                for (const auto& obstacle : m_obstacles) {
-                    float dist = glm::length(newPos - obstacle->getPosition());
-                    if (dist < (m_lightSource->getRadius() + obstacle->getRadius() + 40.0f)) { // Increased from 30.0f
-                        isValid = false;
-                        break;
-                    }
-                }
-                
-                // Check screen bounds
-                if (newPos.x < minX || newPos.x > maxX || newPos.y < minY || newPos.y > maxY) {
-                    isValid = false;
-                    continue;
-                }
-                
-                if (isValid) {
-                    m_lightTargetPos = newPos;
-                    foundValidPosition = true;
-                    std::cout << "Light auto-move: New target position: (" 
-                              << m_lightTargetPos.x << ", " << m_lightTargetPos.y << ")" << std::endl;
-                    break;
-                }
-            }
-            
-            // If no valid position found, try again with reduced minimum distance
-            if (!foundValidPosition) {
-                minDistance = 250.0f; // Increased from 150.0f
-                for (int i = 0; i < maxAttempts; i++) {
-                    glm::vec2 newPos = glm::vec2(xDist(gen), yDist(gen));
-                    
-                    if (glm::length(newPos - currentPos) < minDistance) {
-                        continue;
-                    }
-                    
-                    bool isValid = true;
-                    if (newPos.x > controlsXMin && newPos.y > controlsYMin) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    float distToMain = glm::length(newPos - m_mainObject->getPosition());
-                    if (distToMain < (m_lightSource->getRadius() + m_mainObject->getRadius() + 35.0f)) { // Increased from 30.0f
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    for (const auto& obstacle : m_obstacles) {
-                        float dist = glm::length(newPos - obstacle->getPosition());
-                        if (dist < (m_lightSource->getRadius() + obstacle->getRadius() + 35.0f)) { // Increased from 30.0f
-                            isValid = false;
-                            break;
-                        }
-                    }
-                    
-                    if (newPos.x < minX || newPos.x > maxX || newPos.y < minY || newPos.y > maxY) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    if (isValid) {
-                        m_lightTargetPos = newPos;
-                        foundValidPosition = true;
-                        std::cout << "Light auto-move: New target position (reduced distance): (" 
-                                  << m_lightTargetPos.x << ", " << m_lightTargetPos.y << ")" << std::endl;
-                        break;
-                    }
-                }
-            }
-            
-            // If still no valid position found, try with medium distance
-            if (!foundValidPosition) {
-                minDistance = 150.0f; // New medium distance threshold
-                for (int i = 0; i < maxAttempts; i++) {
-                    glm::vec2 newPos = glm::vec2(xDist(gen), yDist(gen));
-                    
-                    if (glm::length(newPos - currentPos) < minDistance) {
-                        continue;
-                    }
-                    
-                    bool isValid = true;
-                    if (newPos.x > controlsXMin && newPos.y > controlsYMin) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    float distToMain = glm::length(newPos - m_mainObject->getPosition());
-                    if (distToMain < (m_lightSource->getRadius() + m_mainObject->getRadius() + 30.0f)) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    for (const auto& obstacle : m_obstacles) {
-                        float dist = glm::length(newPos - obstacle->getPosition());
-                        if (dist < (m_lightSource->getRadius() + obstacle->getRadius() + 30.0f)) {
-                            isValid = false;
-                            break;
-                        }
-                    }
-                    
-                    if (newPos.x < minX || newPos.x > maxX || newPos.y < minY || newPos.y > maxY) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    if (isValid) {
-                        m_lightTargetPos = newPos;
-                        foundValidPosition = true;
-                        std::cout << "Light auto-move: New target position (medium distance): (" 
-                                  << m_lightTargetPos.x << ", " << m_lightTargetPos.y << ")" << std::endl;
-                        break;
-                    }
-                }
-            }
-            
-            // If still no valid position found, try with minimal distance
-            if (!foundValidPosition) {
-                minDistance = 75.0f; // Increased from 50.0f
-                for (int i = 0; i < maxAttempts; i++) {
-                    glm::vec2 newPos = glm::vec2(xDist(gen), yDist(gen));
-                    
-                    if (glm::length(newPos - currentPos) < minDistance) {
-                        continue;
-                    }
-                    
-                    bool isValid = true;
-                    if (newPos.x > controlsXMin && newPos.y > controlsYMin) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    float distToMain = glm::length(newPos - m_mainObject->getPosition());
-                    if (distToMain < (m_lightSource->getRadius() + m_mainObject->getRadius() + 25.0f)) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    for (const auto& obstacle : m_obstacles) {
-                        float dist = glm::length(newPos - obstacle->getPosition());
-                        if (dist < (m_lightSource->getRadius() + obstacle->getRadius() + 25.0f)) {
-                            isValid = false;
-                            break;
-                        }
-                    }
-                    
-                    if (newPos.x < minX || newPos.x > maxX || newPos.y < minY || newPos.y > maxY) {
-                        isValid = false;
-                        continue;
-                    }
-                    
-                    if (isValid) {
-                        m_lightTargetPos = newPos;
-                        foundValidPosition = true;
-                        std::cout << "Light auto-move: New target position (minimal distance): (" 
-                                  << m_lightTargetPos.x << ", " << m_lightTargetPos.y << ")" << std::endl;
-                        break;
-                    }
-                }
-            }
-            
-            // Only reset to safe position if all attempts fail
-            if (!foundValidPosition) {
+            glm::vec2 target;
+            if (pickLightTarget(currentPos, target)) {
+                m_lightTargetPos = target;
+                LOG_DEBUG(Scene, "Light auto-move: New target position: (%g, %g)", m_lightTargetPos.x, m_lightTargetPos.y);
+            } else {
+                // Only reset to safe position if there is no free space at all
                 glm::vec2 safePos = findSafePosition();
                 m_lightSource->setPosition(safePos);
+                m_lightPreviousPosition = safePos;
                 m_lightTargetPos = safePos;
-                m_lightSource->updateRays();
-                std::cout << "Light auto-move: All attempts failed, resetting to safe position: (" 
-                          << safePos.x << ", " << safePos.y << ")" << std::endl;
+                LOG_INFO(Scene, "Light auto-move: No free space, resetting to safe position: (%g, %g)", safePos.x, safePos.y);
                 return;
             }
         }
@@ -785,64 +520,84 @@ void Scene::update() {
             
             glm::vec2 newPos = currentPos + direction * moveAmount;
             
-            // Check if the new position is valid
-            bool isValid = true;
-            
-            // Calculate controls area bounds
-            float controlsXMin = m_screenWidth/2.0f - CONTROLS_WIDTH - CONTROLS_MARGIN;
-            float controlsYMin = -m_screenHeight/2.0f + CONTROLS_MARGIN;
-            
-            // Check if position is in controls area
-            if (newPos.x > controlsXMin && newPos.y > controlsYMin) {
-                isValid = false;
-            }
-            
-            // Check distance to main object
-            float distToMain = glm::length(newPos - m_mainObject->getPosition());
-            if (distToMain < (m_lightSource->getRadius() + m_mainObject->getRadius() + 20.0f)) {
-                isValid = false;
-            }
-            
-            // Check distance to obstacles
-            for (const auto& obstacle : m_obstacles) {
-                float dist = glm::length(newPos - obstacle->getPosition());
-                if (dist < (m_lightSource->getRadius() + obstacle->getRadius() + 20.0f)) {
-                    isValid = false;
-                    break;
-                }
-            }
-            
-            // Check screen bounds
-            float padding = m_lightSource->getRadius() + 20.0f;
-            if (newPos.x < -m_screenWidth/2.0f + padding || newPos.x > controlsXMin - padding ||
-                newPos.y < -m_screenHeight/2.0f + padding || newPos.y > m_screenHeight/2.0f - padding) {
-                isValid = false;
-            }
+            // Level 0 holds every rule a step must satisfy: screen bounds
+            // left of the controls section and clearance from the main
+            // object, obstacles and walls
+            bool isValid = getLightSpace(0).isFree(newPos);
             
             if (isValid) {
                 m_lightSource->setPosition(newPos);
-                m_lightSource->updateRays();
             } else {
                 // If new position is invalid, reset to a safe position
                 glm::vec2 safePos = findSafePosition();
                 m_lightSource->setPosition(safePos);
+                m_lightPreviousPosition = safePos;
                 m_lightTargetPos = safePos;
-                m_lightSource->updateRays();
-                std::cout << "Light auto-move: Invalid movement detected, reset to safe position: (" 
-                          << safePos.x << ", " << safePos.y << ")" << std::endl;
+                LOG_INFO(Scene, "Light auto-move: Invalid movement detected, reset to safe position: (%g, %g)",
+                         safePos.x, safePos.y);
             }
         }
     }
 }
 
-void Scene::render(const glm::mat4& projection) {
-    m_lightSource->render(projection, m_shaderProgram);
+void Scene::prepareRender(const glm::mat4& projection, float alpha) {
+    m_renderStats = RenderStats();
+    m_renderAlpha = alpha;
+    glUseProgram(m_shaderProgram);
+    
+    // Per-frame and per-instance data are uploaded once per frame
+    {
+        PROFILE_SCOPE("Upload frame data");
+        updateFrameUniforms(projection);
+        updateCircleInstances();
+        if (m_wallsChanged) {
+            updateWallVertices();
+        }
+    }
     
-    for (const auto& obstacle : m_obstacles) {
-        obstacle->render(projection, m_shaderProgram);
+    m_lightSource->traceRays();
+}
+
+glm::vec2 Scene::getLightRenderPosition() const {
+    // Only the auto-move is simulated; a dragged light follows the mouse directly
+    if (!m_lightAutoMove || m_lightSource->isDragging()) {
+        return m_lightSource->getPosition();
+    }
+    return glm::mix(m_lightPreviousPosition, m_lightSource->getPosition(), m_renderAlpha);
+}
+
+void Scene::setLightAutoMove(bool enabled) {
+    m_lightAutoMove = enabled;
+    m_lightPreviousPosition = m_lightSource->getPosition();
+}
+
+void Scene::render() {
+    PROFILE_SCOPE("Scene::render");
+    glUseProgram(m_shaderProgram);
+    
+    // Light source circle first so its rays and crosshair are drawn on top of it
+    glBindVertexArray(m_circleVAO);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_FAN, 0, CIRCLE_VERTEX_COUNT, 1, 0);
+    countDrawCall();
+    
+    m_lightSource->renderRays();
+    m_lightSource->renderCrosshair();
+    
+    if (!m_wallVertices.empty()) {
+        setDrawConstants(glm::vec2(0.0f), 1.0f, glm::vec3(1.0f));
+        glLineWidth(3.0f);
+        glBindVertexArray(m_wallVAO);
+        glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(m_wallVertices.size()));
+        countDrawCall();
+        glLineWidth(1.0f);
     }
     
-    m_mainObject->render(projection, m_shaderProgram);
+    // Obstacles and the main object in a single instanced draw
+    glBindVertexArray(m_circleVAO);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_FAN, 0, CIRCLE_VERTEX_COUNT,
+                                      static_cast<GLsizei>(m_circleInstances.size() - 1), 1);
+    countDrawCall();
+    glBindVertexArray(0);
 }
 
 GameObject* Scene::getClickedObject(const glm::vec2& mousePos) {
@@ -865,6 +620,7 @@ void Scene::handleMousePress(const glm::vec2& mousePos) {
     m_draggedObject = getClickedObject(mousePos);
     if (m_draggedObject) {
         m_draggedObject->setDragging(true);
+        updateObstacleHash();
         // Initialize both current and target positions to avoid initial jump
         m_currentMousePos = mousePos;
         m_targetMousePos = mousePos;
@@ -876,6 +632,14 @@ void Scene::handleMousePress(const glm::vec2& mousePos) {
     }
 }
 
+void Scene::updateObstacleHash() {
+    // Every change to the obstacles bumps m_layoutVersion, so a press held
+    // across frames and drags over still obstacles reuse the last build
+    if (m_obstacleHashVersion == m_layoutVersion) return;
+    m_obstacleHash.build(m_obstacles.view());
+    m_obstacleHashVersion = m_layoutVersion;
+}
+
 void Scene::handleMouseRelease() {
     if (m_draggedObject) {
         m_draggedObject->setDragging(false);
@@ -891,7 +655,7 @@ void Scene::handleMouseMove(const glm::vec2& mousePos) {
     m_currentMousePos = glm::mix(m_currentMousePos, m_targetMousePos, m_mouseLerpSpeed);
     
     if (m_draggedObject && m_draggedObject->isDragging()) {
-        // Store old position in case we need to revert
+        // The sweep starts from where the object was last frame
         glm::vec2 oldPos = m_draggedObject->getPosition();
         
         // Use actual screen dimensions
@@ -908,87 +672,163 @@ void Scene::handleMouseMove(const glm::vec2& mousePos) {
             glm::clamp(newPos.y, -screenHeight/2.0f + padding, screenHeight/2.0f - padding)
         );
         
-        m_draggedObject->setPosition(clampedPos);
+        // Sweep from the old position so fast drags cannot tunnel through
+        // obstacles or walls; the object stops at the first contact and slides along it
+        GameObject* other = m_draggedObject == m_lightSource.get()
+            ? static_cast<GameObject*>(m_mainObject.get())
+            : static_cast<GameObject*>(m_lightSource.get());
+        glm::vec2 otherPos = other->getPosition();
+        float otherRadius = other->getRadius();
+        CircleView others{&otherPos.x, &otherPos.y, &otherRadius, 1};
+        OccluderView walls = m_walls.view();
         
-        // Update rays if the light source is being moved
-        if (m_draggedObject == m_lightSource.get()) {
-            m_lightSource->updateRays();
-        }
-        
-        bool collision = false;
-        for (const auto& obstacle : m_obstacles) {
-            if (m_draggedObject->checkCollision(*obstacle)) {
-                collision = true;
-                break;
-            }
+        glm::vec2 slidPos;
+        {
+            PROFILE_SCOPE("Drag sweep");
+            updateObstacleHash();
+            slidPos = Collision::slideCircle(m_obstacleHash, m_obstacles.view(), others, walls, oldPos, clampedPos, padding);
         }
         
-        // Also check collision between light source and main object
-        if (!collision && m_draggedObject == m_lightSource.get()) {
-            collision = m_lightSource->checkCollision(*m_mainObject);
-        } else if (!collision && m_draggedObject == m_mainObject.get()) {
-            collision = m_mainObject->checkCollision(*m_lightSource);
+        // A slide can leave the screen; sweep straight to the clamped point
+        // instead, which cannot since both ends lie inside
+        glm::vec2 boundedPos = glm::vec2(
+            glm::clamp(slidPos.x, -screenWidth/2.0f + padding, screenWidth/2.0f - padding),
+            glm::clamp(slidPos.y, -screenHeight/2.0f + padding, screenHeight/2.0f - padding)
+        );
+        if (boundedPos != slidPos) {
+            slidPos = Collision::slideCircle(m_obstacleHash, m_obstacles.view(), others, walls, oldPos, boundedPos, padding, 0);
         }
-        
-        if (collision) {
-            m_draggedObject->setPosition(oldPos);
+        m_draggedObject->setPosition(slidPos);
+        if (m_draggedObject == m_mainObject.get()) {
+            // The obstacles did not move, so a current hash stays current
+            bool hashCurrent = m_obstacleHashVersion == m_layoutVersion;
+            invalidateLightSpace();
+            if (hashCurrent) {
+                m_obstacleHashVersion = m_layoutVersion;
+            }
         }
     }
 }
 
-bool Scene::checkValidPosition(const glm::vec2& position, float radius, bool isLightSource) const {
-    // Define minimum safe distances
-    const float MIN_DISTANCE_TO_LIGHT = isLightSource ? 20.0f : 100.0f;  // Much smaller distance for light source
-    const float MIN_DISTANCE_TO_MAIN = isLightSource ? 20.0f : 80.0f;    // Much smaller distance for light source
-    const float MIN_DISTANCE_TO_OBSTACLE = isLightSource ? 20.0f : 60.0f; // Much smaller distance for light source
-    
-    // Check collision with light source with minimum distance
-    // Only check if the position is not the current light position
-    if (position != m_lightSource->getPosition()) {
-        float distToLight = glm::length(position - m_lightSource->getPosition());
-        if (distToLight < (radius + m_lightSource->getRadius() + MIN_DISTANCE_TO_LIGHT)) {
-            if (isLightSource) {
-                std::cout << "Position invalid: Too close to light source (distance: " << distToLight 
-                          << ", min required: " << (radius + m_lightSource->getRadius() + MIN_DISTANCE_TO_LIGHT) << ")" << std::endl;
-            }
-            return false;
-        }
+void Scene::setObstacleIor(float ior) {
+    m_obstacleIor = ior;
+    for (size_t i = 0; i < m_obstacles.size(); ++i) {
+        m_obstacles.setIor(i, ior);
     }
-    
-    // Check collision with main object with minimum distance
-    float distToMain = glm::length(position - m_mainObject->getPosition());
-    if (distToMain < (radius + m_mainObject->getRadius() + MIN_DISTANCE_TO_MAIN)) {
-        if (isLightSource) {
-            std::cout << "Position invalid: Too close to main object (distance: " << distToMain 
-                      << ", min required: " << (radius + m_mainObject->getRadius() + MIN_DISTANCE_TO_MAIN) << ")" << std::endl;
-        }
-        return false;
+}
+
+void Scene::addRoomWalls() {
+    // Replaces the walls, so pressing again does not stack copies
+    m_walls.clear();
+    SceneLayout::addRoomWalls(m_walls, m_screenWidth, m_screenHeight);
+    m_wallsChanged = true;
+    invalidateLightSpace();
+}
+
+void Scene::clearWalls() {
+    m_walls.clear();
+    m_wallsChanged = true;
+    invalidateLightSpace();
+}
+
+void Scene::setObstaclesMoving(bool moving) {
+    m_obstaclesMoving = moving;
+    if (moving) {
+        m_obstacleMotion.reset(m_obstacles.size(), m_obstacleSpeed, m_random);
     }
-    
-    // Check collision with other obstacles with minimum distance
-    for (const auto& obstacle : m_obstacles) {
-        float dist = glm::length(position - obstacle->getPosition());
-        if (dist < (radius + obstacle->getRadius() + MIN_DISTANCE_TO_OBSTACLE)) {
-            if (isLightSource) {
-                std::cout << "Position invalid: Too close to obstacle (distance: " << dist 
-                          << ", min required: " << (radius + obstacle->getRadius() + MIN_DISTANCE_TO_OBSTACLE) << ")" << std::endl;
-            }
-            return false;
-        }
+}
+
+void Scene::setObstacleSpeed(float speed) {
+    m_obstacleSpeed = speed;
+    if (m_obstaclesMoving) {
+        m_obstacleMotion.reset(m_obstacles.size(), m_obstacleSpeed, m_random);
     }
-    
-    // Check if position is within screen bounds with padding
-    float padding = radius + (isLightSource ? 20.0f : 50.0f); // Much smaller padding for light source
-    if (position.x < -m_screenWidth/2.0f + padding || position.x > m_screenWidth/2.0f - padding ||
-        position.y < -m_screenHeight/2.0f + padding || position.y > m_screenHeight/2.0f - padding) {
-        if (isLightSource) {
-            std::cout << "Position invalid: Outside screen bounds (x: " << position.x 
-                      << ", y: " << position.y << ", padding: " << padding << ")" << std::endl;
-        }
-        return false;
+}
+
+SceneDescription Scene::describe() const {
+    SceneDescription description;
+    description.width = m_screenWidth;
+    description.height = m_screenHeight;
+    description.lightPosition = m_lightSource->getPosition();
+    description.lightRadius = m_lightSource->getRadius();
+    description.lightColor = m_lightSource->getColor();
+    description.mainPosition = m_mainObject->getPosition();
+    description.mainRadius = m_mainObject->getRadius();
+    description.mainColor = m_mainObject->getColor();
+    description.obstacles = m_obstacles;
+    description.walls = m_walls;
+    description.rayCount = s_rayCount;
+    description.reflections = m_reflectionsEnabled;
+    description.dispersion = m_dispersion;
+    return description;
+}
+
+void Scene::applyDescription(const SceneDescription& description) {
+    if (m_draggedObject) {
+        m_draggedObject->setDragging(false);
+        m_draggedObject = nullptr;
     }
     
-    return true;
+    m_lightSource->setPosition(description.lightPosition);
+    m_lightSource->setRadius(description.lightRadius);
+    m_lightSource->setColor(description.lightColor);
+    // Start the auto-move and its interpolation from the loaded position
+    m_lightTargetPos = description.lightPosition;
+    m_lightPreviousPosition = description.lightPosition;
+    m_lightAutoMoveTimer = 0.0f;
+    
+    m_mainObject->setPosition(description.mainPosition);
+    m_mainObject->setRadius(description.mainRadius);
+    m_mainObject->setColor(description.mainColor);
+    
+    m_obstacles = description.obstacles;
+    // Velocities of the previous layout do not carry over, even when the
+    // obstacle count matches
+    if (m_obstaclesMoving) {
+        m_obstacleMotion.reset(m_obstacles.size(), m_obstacleSpeed, m_random);
+    }
+    invalidateLightSpace();
+    m_walls = description.walls;
+    m_wallsChanged = true;
+    s_rayCount = description.rayCount;
+    m_reflectionsEnabled = description.reflections;
+    m_dispersion = description.dispersion;
+}
+
+void Scene::saveScene(const std::string& path) const {
+    if (SceneText::isTextScenePath(path)) {
+        SceneText::save(path, describe());
+    } else {
+        SceneBinary::write(path, describe());
+    }
+}
+
+void Scene::loadScene(const std::string& path) {
+    if (SceneText::isTextScenePath(path)) {
+        applyDescription(SceneText::load(path));
+    } else {
+        MappedScene file(path);
+        applyDescription(file.toDescription());
+    }
+}
+
+void Scene::startTraceRecording(const std::string& path) {
+    // Closes any previous recording first
+    m_traceRecorder.reset();
+    m_traceRecorder = std::make_unique<TraceRecorder>(path);
+    m_recordedFrame = 0;
+    m_recordingStartTime = m_simulationTime;
+}
+
+void Scene::stopTraceRecording() {
+    if (!m_traceRecorder) return;
+    std::unique_ptr<TraceRecorder> recorder = std::move(m_traceRecorder);
+    recorder->close();
+}
+
+void Scene::recordTrace(const std::vector<TraceSegment>& segments) {
+    if (!m_traceRecorder) return;
+    m_traceRecorder->recordFrame(m_recordedFrame++, m_simulationTime - m_recordingStartTime, segments);
 }
 
 void Scene::handleWindowResize(int width, int height) {
@@ -1016,20 +856,17 @@ void Scene::handleWindowResize(int width, int height) {
     }
     
     // Ensure obstacles stay within new bounds
-    for (auto& obstacle : m_obstacles) {
-        glm::vec2 pos = obstacle->getPosition();
-        pos.x = glm::clamp(pos.x, -m_screenWidth/2.0f + obstacle->getRadius(),
-                          m_screenWidth/2.0f - obstacle->getRadius());
-        pos.y = glm::clamp(pos.y, -m_screenHeight/2.0f + obstacle->getRadius(),
-                          m_screenHeight/2.0f - obstacle->getRadius());
-        obstacle->setPosition(pos);
+    for (size_t i = 0; i < m_obstacles.size(); ++i) {
+        glm::vec2 pos = m_obstacles.getPosition(i);
+        float radius = m_obstacles.getRadius(i);
+        pos.x = glm::clamp(pos.x, -m_screenWidth/2.0f + radius, m_screenWidth/2.0f - radius);
+        pos.y = glm::clamp(pos.y, -m_screenHeight/2.0f + radius, m_screenHeight/2.0f - radius);
+        m_obstacles.setPosition(i, pos);
     }
+    invalidateLightSpace();
 }
 
 void Scene::generateRandomObstacles(int count) {
-    // Clear existing obstacles
-    m_obstacles.clear();
-    
     // Use a static counter that increments each time the function is called
     static unsigned int seedCounter = 0;
     seedCounter++;
@@ -1037,76 +874,77 @@ void Scene::generateRandomObstacles(int count) {
     // Create a deterministic but different seed each time
     unsigned int finalSeed = seedCounter * 2654435761u; // Large prime number for better distribution
     
-    std::mt19937 gen(finalSeed);
-    
-    // Adjust distribution based on screen size
-    float margin = 50.0f; // Keep obstacles away from edges
-    
-    // Define the controls section area to avoid (bottom right corner)
-    float controlsWidth = 484.0f;  // Width of controls window
-    float controlsHeight = 275.0f; // Height of controls window
-    float controlsMargin = 20.0f;  // Additional margin around controls
-    
-    // Calculate the area to avoid
-    float avoidXMin = m_screenWidth/2.0f - controlsWidth - controlsMargin;
-    float avoidYMin = -m_screenHeight/2.0f + controlsMargin;
-    
-    // Create distributions that avoid the controls area
-    std::uniform_real_distribution<float> xDist(-m_screenWidth/2.0f + margin, m_screenWidth/2.0f - margin);
-    std::uniform_real_distribution<float> yDist(-m_screenHeight/2.0f + margin, m_screenHeight/2.0f - margin);
-    std::uniform_real_distribution<float> grayDist(0.3f, 0.7f);
-    
-    int placedObstacles = 0;
-    int maxAttempts = 1000; // Prevent infinite loop
-    int attempts = 0;
-    
-    while (placedObstacles < count && attempts < maxAttempts) {
-        glm::vec2 position(xDist(gen), yDist(gen));
-        
-        // Check if position is in the controls area
-        bool inControlsArea = (position.x > avoidXMin && position.y > avoidYMin);
-        
-        // Check if position is valid (not overlapping with other objects and not in controls area)
-        if (!inControlsArea && checkValidPosition(position, 30.0f, false)) {
-            auto obstacle = std::make_unique<Obstacle>(this, position);
-            // Set a random gray color
-            float gray = grayDist(gen);
-            obstacle->setColor(glm::vec3(gray, gray, gray));
-            m_obstacles.push_back(std::move(obstacle));
-            placedObstacles++;
-        }
-        attempts++;
+    SceneDescription layout = describe();
+    int placed = SceneLayout::generateObstacles(layout, count, finalSeed);
+    if (placed < count) {
+        LOG_WARNING(Scene, "Only %d of %d obstacles fit on screen", placed, count);
     }
+    m_obstacles = std::move(layout.obstacles);
+    setObstacleIor(m_obstacleIor);
+    invalidateLightSpace();
 }
 
-glm::vec2 Scene::findSafePosition() const {
-    // Calculate safe area bounds (excluding controls section)
+void Scene::getLightTargetBounds(glm::vec2& boundsMin, glm::vec2& boundsMax) const {
+    // Screen bounds with padding, left of the controls section
     float controlsXMin = m_screenWidth/2.0f - CONTROLS_WIDTH - CONTROLS_MARGIN;
-    float controlsYMin = -m_screenHeight/2.0f + CONTROLS_MARGIN;
-    
-    // Use screen bounds with padding, avoiding controls area
     float padding = m_lightSource->getRadius() + 30.0f;
-    float minX = -m_screenWidth/2.0f + padding;
-    float maxX = controlsXMin - padding;
-    float minY = -m_screenHeight/2.0f + padding;
-    float maxY = m_screenHeight/2.0f - padding;
-    
-    // Create a random number generator
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> xDist(minX, maxX);
-    static std::uniform_real_distribution<float> yDist(minY, maxY);
+    boundsMin = glm::vec2(-m_screenWidth/2.0f + padding, -m_screenHeight/2.0f + padding);
+    boundsMax = glm::vec2(controlsXMin - padding, m_screenHeight/2.0f - padding);
+}
+
+bool Scene::pickLightTarget(const glm::vec2& currentPos, glm::vec2& target) const {
+    PROFILE_SCOPE("Pick light target");
     
-    // Try to find a safe position
-    for (int i = 0; i < 100; i++) {
-        glm::vec2 position(xDist(gen), yDist(gen));
-        
-        // Check if position is valid
-        if (checkValidPosition(position, m_lightSource->getRadius(), true)) {
-            return position;
+    for (int tier = 0; tier < LIGHT_TARGET_TIER_COUNT; ++tier) {
+        if (getLightSpace(1 + tier).sampleOutside(m_random, currentPos, LIGHT_TARGET_TIERS[tier].minDistance, target)) {
+            return true;
         }
     }
+    return false;
+}
+
+glm::vec2 Scene::findSafePosition() const {
+    glm::vec2 boundsMin, boundsMax;
+    getLightTargetBounds(boundsMin, boundsMax);
+    
+    // Anywhere a step may go; the light's current position does not block
+    // it, since the light is what moves there
+    float radius = m_lightSource->getRadius();
+    glm::vec2 position;
+    if (getLightSpace(0).sample(m_random, position)) {
+        return position;
+    }
     
     // If no safe position found, return a default position (top-left corner)
-    return glm::vec2(minX + padding, maxY - padding);
+    float padding = radius + 30.0f;
+    return glm::vec2(boundsMin.x + padding, boundsMax.y - padding);
+}
+
+const FreeSpaceSampler& Scene::getLightSpace(int level) const {
+    FreeSpaceSampler& space = m_lightSpace[level];
+    if (m_lightSpaceVersion[level] == m_layoutVersion) {
+        return space;
+    }
+    PROFILE_SCOPE("Build light space");
+    
+    float radius = m_lightSource->getRadius();
+    float clearance = LIGHT_STEP_CLEARANCE;
+    glm::vec2 boundsMin, boundsMax;
+    if (level == 0) {
+        // Screen bounds with the step padding, left of the controls section
+        float controlsXMin = m_screenWidth/2.0f - CONTROLS_WIDTH - CONTROLS_MARGIN;
+        float padding = radius + LIGHT_STEP_CLEARANCE;
+        boundsMin = glm::vec2(-m_screenWidth/2.0f + padding, -m_screenHeight/2.0f + padding);
+        boundsMax = glm::vec2(controlsXMin - padding, m_screenHeight/2.0f - padding);
+    } else {
+        clearance = LIGHT_TARGET_TIERS[level - 1].clearance;
+        getLightTargetBounds(boundsMin, boundsMax);
+    }
+    space.reset(boundsMin, boundsMax);
+    space.block(m_mainObject->getPosition(), radius + m_mainObject->getRadius() + clearance);
+    space.blockCircles(m_obstacles.view(), radius + clearance);
+    space.blockWalls(m_walls, radius + clearance);
+    space.finalize();
+    m_lightSpaceVersion[level] = m_layoutVersion;
+    return space;
 }
\ No newline at end of file
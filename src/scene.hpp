@@ -3,7 +3,18 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
-#include <memory>
+#include <string>
+#include <random>
+#include <cstdint>
+#include "ray.hpp"
+#include "tracer.hpp"
+#include "gpu_tracer.hpp"
+#include "obstacle_store.hpp"
+#include "scene_layout.hpp"
+#include "trace_recorder.hpp"
+#include "free_space.hpp"
+#include "spatial_hash.hpp"
+#include "obstacle_motion.hpp"
 
 class Scene;  // Forward declaration
 
@@ -15,11 +26,11 @@ public:
     virtual ~GameObject() = default;
     
     virtual void update() {}
-    virtual void render(const glm::mat4& projection, unsigned int shaderProgram) {}
     
     const glm::vec2& getPosition() const { return m_position; }
     void setPosition(const glm::vec2& position) { m_position = position; }
     float getRadius() const { return m_radius; }
+    void setRadius(float radius) { m_radius = radius; }
     
     const glm::vec3& getColor() const { return m_color; }
     void setColor(const glm::vec3& color) { m_color = color; }
@@ -38,41 +49,13 @@ protected:
     float m_radius;
     glm::vec3 m_color;
     bool m_isDragging;
-    unsigned int m_VAO = 0;
-    unsigned int m_VBO = 0;
 };
 
-struct Ray {
-    glm::vec2 origin;
-    glm::vec2 direction;
-    float length;
-    bool isReflected{false};
-    int reflectionCount{0};
-    glm::vec3 color{1.0f};
-    static constexpr int MAX_REFLECTIONS = 3;
-    
-    // Helper function to check intersection with a circle
-    bool intersectsCircle(const glm::vec2& center, float radius, float& intersectionDist) const {
-        glm::vec2 toCircle = center - origin;
-        float a = glm::dot(direction, direction);
-        float b = -2.0f * glm::dot(toCircle, direction);
-        float c = glm::dot(toCircle, toCircle) - radius * radius;
-        
-        float discriminant = b * b - 4.0f * a * c;
-        if (discriminant < 0.0f) return false;
-        
-        float t = (-b - sqrt(discriminant)) / (2.0f * a);
-        if (t < 0.0f) return false;
-        
-        intersectionDist = t;
-        return t < length;
-    }
-
-    // Calculate reflection direction using Fresnel equations
-    glm::vec2 calculateReflection(const glm::vec2& normal) const {
-        // For 2D, we can use a simpler reflection formula
-        return direction - 2.0f * glm::dot(direction, normal) * normal;
-    }
+// GL work submitted by the scene in the last frame
+struct RenderStats {
+    uint32_t drawCalls = 0;
+    uint64_t rayVertexBytes = 0;  // Uploaded to the ray vertex buffer (CPU backend)
+    uint64_t uploadBytes = 0;     // All buffer uploads, the ray vertices included
 };
 
 class LightSource : public GameObject {
@@ -82,24 +65,28 @@ public:
     
     float getIntensity() const { return m_intensity; }
     void setIntensity(float intensity) { m_intensity = intensity; }
-    void render(const glm::mat4& projection, unsigned int shaderProgram) override;
-    void updateRays();
-    void renderRays(const glm::mat4& projection, unsigned int shaderProgram);
-    void renderCrosshair(const glm::mat4& projection, unsigned int shaderProgram);
+    // Traces the rays and uploads them (CPU backend) or dispatches the
+    // compute trace (GPU backend); renderRays then draws the result
+    void traceRays();
+    void renderRays();
+    void renderCrosshair();
+    
+    // Result of the last GPU-vs-CPU comparison, if validation ran
+    bool hasGpuValidationResult() const { return m_hasValidationResult; }
+    const GpuTracer::ValidationResult& getGpuValidationResult() const { return m_validationResult; }
+    
+    // Tracer counters of the last frame; only available when it was traced
+    // on the CPU (the GPU backend does not read its work back)
+    bool hasTraceStats() const { return !m_tracedOnGpu; }
+    const TraceStats& getTraceStats() const { return m_tracer.getLastStats(); }
 
 private:
     float m_intensity;
     
     // Ray configuration - Adjust these values to modify ray behavior
     // ============================================================
-    
-    // Number of rays to emit (higher = more detailed but slower)
-    // Recommended range: 72 to 90 (1 ray per 5 degrees to 1 ray per 0.5 degrees)
-    static constexpr int NUM_RAYS = 90;  // Default value, will be overridden by Scene::s_rayCount
-    
-    // Maximum length of rays (how far they can travel)
-    // Increase for larger scenes, decrease for better performance
-    static constexpr float MAX_RAY_LENGTH = 2000.0f;
+    // Ray count comes from Scene::s_rayCount; lengths and reflection
+    // falloff are in TraceSettings.
     
     // Crosshair configuration
     static constexpr float CROSSHAIR_LENGTH = 10.0f;  // Reduced from 25.0f
@@ -109,39 +96,38 @@ private:
     // Range: 0.0f to 1.0f
     // Higher values = brighter rays
     static constexpr float RAY_INTENSITY = 0.9f;
-
-    // Reflection configuration
-    static constexpr float REFLECTION_INTENSITY_FACTOR = 0.7f;  // How much intensity is preserved after reflection
-    static constexpr float REFLECTION_LENGTH_FACTOR = 0.05f;     // How much length is preserved after reflection (reduced from 0.5f)
     
-    std::vector<Ray> m_rays;
-    std::vector<Ray> m_reflectedRays;  // Store reflected rays separately
+    // Per-frame segment budget, per primary ray. Reflected and refracted
+    // rays are traced highest energy first until it runs out, so the frame
+    // cost stays bounded however rays split.
+    static constexpr uint64_t SEGMENT_BUDGET_PER_RAY = 8;
+    
+    Tracer m_tracer{TraceKernel::Simd, 0};  // All hardware threads once the ray count is large enough
+    std::vector<TraceSegment> m_segments;  // Segments traced this frame
+    std::unique_ptr<GpuTracer> m_gpuTracer;  // Created on first use of the GPU backend
+    GpuTracer::ValidationResult m_validationResult;
+    bool m_hasValidationResult = false;
+    bool m_tracedOnGpu = false;  // Backend that produced this frame's rays
+    
+    std::vector<RayVertex> m_rayVertices;  // Reused between frames to avoid reallocating
     unsigned int m_rayVAO = 0;
     unsigned int m_rayVBO = 0;
+    size_t m_rayVBOCapacity = 0;  // In vertices
     unsigned int m_crosshairVAO = 0;
     unsigned int m_crosshairVBO = 0;
 
-    // Helper methods for ray reflection
-    void processReflections(const Ray& incidentRay, const glm::vec2& intersectionPoint, 
-                          const glm::vec2& normal, const GameObject* hitObject);
-    glm::vec3 calculateReflectionColor(const glm::vec3& baseColor, int reflectionCount) const;
-};
-
-class Obstacle : public GameObject {
-public:
-    Obstacle(Scene* scene, const glm::vec2& position);
-    ~Obstacle();
-    void render(const glm::mat4& projection, unsigned int shaderProgram) override;
+    TraceScene makeTraceScene() const;
+    TraceSettings makeTraceSettings() const;
+    void traceRaysCpu(const TraceScene& traceScene, const TraceSettings& settings);
+    bool traceRaysGpu(const TraceScene& traceScene, const TraceSettings& settings);
 };
 
 class MainObject : public GameObject {
 public:
     MainObject(Scene* scene, const glm::vec2& position);
-    ~MainObject();
     
     bool isDragging() const { return m_isDragging; }
     void setDragging(bool dragging) { m_isDragging = dragging; }
-    void render(const glm::mat4& projection, unsigned int shaderProgram) override;
 
 private:
     bool m_isDragging;
@@ -153,16 +139,24 @@ public:
     ~Scene();
     
     // Control section dimensions
-    static constexpr float CONTROLS_WIDTH{484.0f};
-    static constexpr float CONTROLS_HEIGHT{275.0f};
-    static constexpr float CONTROLS_MARGIN{20.0f};
+    static constexpr float CONTROLS_WIDTH{SceneLayout::CONTROLS_WIDTH};
+    static constexpr float CONTROLS_HEIGHT{SceneLayout::CONTROLS_HEIGHT};
+    static constexpr float CONTROLS_MARGIN{SceneLayout::CONTROLS_MARGIN};
+    
+    // Radius of generated obstacles
+    static constexpr float OBSTACLE_RADIUS{SceneLayout::OBSTACLE_RADIUS};
     
     // Ray count control
     static int getRayCount() { return s_rayCount; }
     static void setRayCount(int count) { s_rayCount = count; }
     
-    void update();
-    void render(const glm::mat4& projection);
+    // Advances the simulation by one fixed step (see FixedTimestep)
+    void update(float deltaTime);
+    // Uploads the per-frame data and traces the rays, then render() draws.
+    // alpha is the fraction of a step since the last update, used to
+    // interpolate the moving light between simulation states.
+    void prepareRender(const glm::mat4& projection, float alpha = 1.0f);
+    void render();
     
     void handleMousePress(const glm::vec2& mousePos);
     void handleMouseRelease();
@@ -170,18 +164,59 @@ public:
     void handleWindowResize(int width, int height);
     
     void generateRandomObstacles(int count);
-    int getObstacleCount() const { return m_obstacles.size(); }
+    int getObstacleCount() const { return static_cast<int>(m_obstacles.size()); }
     static int getDesiredObstacleCount() { return s_desiredObstacleCount; }
     static void setDesiredObstacleCount(int count) { s_desiredObstacleCount = count; }
     
+    // Moving obstacles (stress mode): stepped in update() with the light
+    // and the main object as fixed colliders
+    bool areObstaclesMoving() const { return m_obstaclesMoving; }
+    void setObstaclesMoving(bool moving);
+    float getObstacleSpeed() const { return m_obstacleSpeed; }
+    // Gives every obstacle a new random direction at this speed
+    void setObstacleSpeed(float speed);
+    const ObstacleMotion& getObstacleMotion() const { return m_obstacleMotion; }
+    
+    // Glass obstacles: index of refraction of every obstacle, generated
+    // ones included; ObstacleStore::OPAQUE makes them mirrors again. The GPU
+    // backend only traces mirrors, so scenes with glass use the CPU.
+    float getObstacleIor() const { return m_obstacleIor; }
+    void setObstacleIor(float ior);
+    // Dispersion of the glass (TraceSettings::dispersion), 0 for none
+    float getDispersion() const { return m_dispersion; }
+    void setDispersion(float dispersion) { m_dispersion = dispersion; }
+    
+    // Walls (segments, polygons and arcs), traced alongside the circles.
+    // The GPU backend traces circles only, so scenes with walls use the CPU.
+    const OccluderStore& getWalls() const { return m_walls; }
+    // Replaces the walls with the SceneLayout::addRoomWalls room for the
+    // current window size
+    void addRoomWalls();
+    void clearWalls();
+    
     // Light source auto-move controls
     bool isLightAutoMoving() const { return m_lightAutoMove; }
-    void setLightAutoMove(bool enabled) { m_lightAutoMove = enabled; }
+    void setLightAutoMove(bool enabled);
+    // Light position for this frame's draws and trace origin
+    glm::vec2 getLightRenderPosition() const;
+    // Seeds the auto-move target picker; random_device seeded by default
+    void setRandomSeed(uint32_t seed) { m_random.seed(seed); }
+    double getSimulationTime() const { return m_simulationTime; }
     
     // Reflection controls
     bool areReflectionsEnabled() const { return m_reflectionsEnabled; }
     void setReflectionsEnabled(bool enabled) { m_reflectionsEnabled = enabled; }
     
+    // Tracing backend controls
+    enum class TracingBackend { Cpu, GpuCompute };
+    TracingBackend getTracingBackend() const { return m_tracingBackend; }
+    void setTracingBackend(TracingBackend backend) { m_tracingBackend = backend; }
+    bool isGpuValidationEnabled() const { return m_gpuValidation; }
+    // Kernel of the CPU backend (and of the GPU validation reference)
+    TraceKernel getCpuTraceKernel() const { return m_cpuTraceKernel; }
+    void setCpuTraceKernel(TraceKernel kernel) { m_cpuTraceKernel = kernel; }
+    void setGpuValidationEnabled(bool enabled) { m_gpuValidation = enabled; }
+    
     // Const access for reading
     const LightSource* getLightSource() const { return m_lightSource.get(); }
     const MainObject* getMainObject() const { return m_mainObject.get(); }
@@ -189,16 +224,52 @@ public:
     // Non-const access for modification
     LightSource* getLightSource() { return m_lightSource.get(); }
     MainObject* getMainObject() { return m_mainObject.get(); }
-    const std::vector<std::unique_ptr<Obstacle>>& getObstacles() const { return m_obstacles; }
+    const ObstacleStore& getObstacles() const { return m_obstacles; }
+    
+    // GL-free snapshot of the current layout and tracing settings
+    SceneDescription describe() const;
+    // Replaces the layout and tracing settings; the window size is kept
+    void applyDescription(const SceneDescription& description);
+    
+    // Scene files: .json/.csv text (scene_text.hpp), anything else binary
+    // (scene_binary.hpp). Throw std::runtime_error on failure.
+    void saveScene(const std::string& path) const;
+    void loadScene(const std::string& path);
+    
+    // Trace recording: streams every frame's traced segments to a .rttrace
+    // file (see trace_recorder.hpp). Start throws std::runtime_error on failure.
+    void startTraceRecording(const std::string& path);
+    void stopTraceRecording();
+    bool isTraceRecording() const { return m_traceRecorder != nullptr; }
+    const TraceRecorder* getTraceRecorder() const { return m_traceRecorder.get(); }
+    void recordTrace(const std::vector<TraceSegment>& segments);
 
-    // Shader uniform helper
-    void setShaderUniforms(const glm::mat4& projection, const glm::vec2& position,
-                          float scale, const glm::vec3& color);
+    unsigned int getShaderProgram() const { return m_shaderProgram; }
+    
+    // Per-object values for the crosshair/ray draws, which are not instanced
+    void setDrawConstants(const glm::vec2& position, float scale, const glm::vec3& color) const;
+    
+    // Work counters, reset by prepareRender
+    const RenderStats& getRenderStats() const { return m_renderStats; }
+    void countDrawCall() { ++m_renderStats.drawCalls; }
+    void countUpload(uint64_t bytes) { m_renderStats.uploadBytes += bytes; }
+    void countRayVertexUpload(uint64_t bytes) {
+        m_renderStats.rayVertexBytes += bytes;
+        m_renderStats.uploadBytes += bytes;
+    }
 
 private:
     std::unique_ptr<LightSource> m_lightSource;
     std::unique_ptr<MainObject> m_mainObject;
-    std::vector<std::unique_ptr<Obstacle>> m_obstacles;
+    ObstacleStore m_obstacles;
+    SpatialHash m_obstacleHash;  // Rebuilt for drags only after the layout has changed
+    uint64_t m_obstacleHashVersion{0};  // m_layoutVersion m_obstacleHash was built at
+    ObstacleMotion m_obstacleMotion;
+    bool m_obstaclesMoving{false};
+    float m_obstacleSpeed{ObstacleMotion::DEFAULT_SPEED};
+    float m_obstacleIor{ObstacleStore::OPAQUE};
+    float m_dispersion{0.0f};
+    OccluderStore m_walls;
     GameObject* m_draggedObject;
     glm::vec2 m_currentMousePos{0.0f};
     glm::vec2 m_targetMousePos{0.0f};
@@ -210,10 +281,28 @@ private:
     static constexpr float LIGHT_AUTO_MOVE_INTERVAL{1.0f}; // Time between auto-moves in seconds (increased from 0.5f)
     glm::vec2 m_lightTargetPos{0.0f};
     float m_lightMoveSpeed{50.0f}; // Speed of light movement (increased from 15.0f)
+    glm::vec2 m_lightPreviousPosition{0.0f};
+    float m_renderAlpha{1.0f};
+    mutable std::mt19937 m_random{std::random_device{}()};
+    
+    // Sum of the fixed steps taken; drives shader time and trace recording
+    double m_simulationTime{0.0};
     
     // Reflection state
     bool m_reflectionsEnabled{true};
     
+    // Tracing backend state
+    TracingBackend m_tracingBackend{TracingBackend::Cpu};
+    bool m_gpuValidation{false};
+    TraceKernel m_cpuTraceKernel{TraceKernel::Simd};
+    
+    RenderStats m_renderStats;
+    
+    // Trace recording state
+    std::unique_ptr<TraceRecorder> m_traceRecorder;
+    uint64_t m_recordedFrame{0};
+    double m_recordingStartTime{0.0};
+    
     // Screen dimensions
     float m_screenWidth{1280.0f};
     float m_screenHeight{720.0f};
@@ -224,21 +313,72 @@ private:
     // Static member for ray count
     static int s_rayCount;
     
-    bool checkValidPosition(const glm::vec2& position, float radius, bool isLightSource = false) const;
     GameObject* getClickedObject(const glm::vec2& mousePos);
-    
-    // Add this new method declaration
+    // Rebuilds m_obstacleHash if the layout changed since the last build
+    void updateObstacleHash();
+    
+    // Light auto-move targets: uniform over the free space in the bounds.
+    // Targets prefer to lie far from the light; each tier relaxes the travel
+    // distance and the clearance around the other objects.
+    struct LightTargetTier {
+        float minDistance;
+        float clearance;
+    };
+    static constexpr int LIGHT_TARGET_TIER_COUNT = 4;
+    static constexpr LightTargetTier LIGHT_TARGET_TIERS[LIGHT_TARGET_TIER_COUNT] = {
+        {400.0f, 40.0f}, {250.0f, 35.0f}, {150.0f, 30.0f}, {75.0f, 25.0f}};
+    // Clearance every step of the light keeps from the other objects
+    static constexpr float LIGHT_STEP_CLEARANCE{20.0f};
+    void getLightTargetBounds(glm::vec2& boundsMin, glm::vec2& boundsMax) const;
+    bool pickLightTarget(const glm::vec2& currentPos, glm::vec2& target) const;
     glm::vec2 findSafePosition() const;
     
+    // Occupancy grids of the main object, obstacles and walls for the light:
+    // level 0 holds the step checks (bounds and LIGHT_STEP_CLEARANCE), level
+    // 1 + i the target tier i. Each is built on first use after the layout
+    // changes, so neither the per-step checks nor target picks walk the
+    // obstacles.
+    const FreeSpaceSampler& getLightSpace(int level) const;
+    void invalidateLightSpace() { ++m_layoutVersion; }
+    mutable FreeSpaceSampler m_lightSpace[1 + LIGHT_TARGET_TIER_COUNT];
+    mutable uint64_t m_lightSpaceVersion[1 + LIGHT_TARGET_TIER_COUNT] = {};
+    uint64_t m_layoutVersion{1};  // Bumped whenever the light's surroundings change
+    
     // Shader related members
     unsigned int m_shaderProgram;
-    struct {
-        GLint projection;
-        GLint position;
-        GLint scale;
-        GLint color;
-    } m_uniforms;
+    
+    // Per-frame constants, std140 layout of the FrameData uniform block
+    struct FrameUniforms {
+        glm::mat4 projection;
+        glm::vec4 viewport;  // x, y, width, height
+        float time;
+        float padding[3];
+    };
+    unsigned int m_frameUBO = 0;
+    
+    // Per-instance data for circle draws (light source, obstacles, main object)
+    struct CircleInstance {
+        glm::vec2 position;
+        float scale;
+        glm::vec3 color;
+    };
+    std::vector<CircleInstance> m_circleInstances;
+    unsigned int m_circleVAO = 0;
+    unsigned int m_circleVBO = 0;
+    unsigned int m_instanceVBO = 0;
+    size_t m_instanceCapacity = 0;
+    
+    // Wall outlines as solid lines in the ray vertex layout, uploaded again
+    // only when the walls change
+    static constexpr float WALL_ARC_STEP{0.1f};  // Radians per line piece of an arc
+    std::vector<RayVertex> m_wallVertices;
+    unsigned int m_wallVAO = 0;
+    unsigned int m_wallVBO = 0;
+    bool m_wallsChanged{true};
     
     void initShaders();
-    void cacheUniformLocations();
+    void initBuffers();
+    void updateFrameUniforms(const glm::mat4& projection);
+    void updateCircleInstances();
+    void updateWallVertices();
 };
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "scene_binary.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Obstacle colors are stored as packed float triples");
+
+namespace {
+
+uint64_t alignUp(uint64_t value) {
+    return (value + SceneBinary::ALIGNMENT - 1) / SceneBinary::ALIGNMENT * SceneBinary::ALIGNMENT;
+}
+
+void writeBlock(std::ofstream& file, uint64_t offset, const void* data, uint64_t size) {
+    // Pad up to the aligned block start
+    static const char zeros[SceneBinary::ALIGNMENT] = {};
+    uint64_t position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, static_cast<std::streamsize>(offset - position));
+    if (size > 0) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+}
+
+// Wall table contents in file order, see scene_binary.hpp
+void packWalls(const OccluderStore& walls, std::vector<unsigned char>& table) {
+    SceneBinary::WallTableHeader header{walls.segmentCount(), walls.polygonCount(), 0, walls.arcCount()};
+    std::vector<float> segments;
+    for (std::size_t i = 0; i < walls.segmentCount(); ++i) {
+        glm::vec2 from = walls.getSegmentStart(i);
+        glm::vec2 to = walls.getSegmentEnd(i);
+        segments.insert(segments.end(), {from.x, from.y, to.x, to.y});
+    }
+    std::vector<uint32_t> sizes;
+    std::vector<float> points;
+    for (std::size_t p = 0; p < walls.polygonCount(); ++p) {
+        sizes.push_back(static_cast<uint32_t>(walls.getPolygonVertexCount(p)));
+        for (std::size_t k = 0; k < walls.getPolygonVertexCount(p); ++k) {
+            glm::vec2 point = walls.getPolygonVertex(p, k);
+            points.insert(points.end(), {point.x, point.y});
+        }
+    }
+    header.polygonPointCount = points.size() / 2;
+    std::vector<float> arcs;
+    for (std::size_t i = 0; i < walls.arcCount(); ++i) {
+        glm::vec2 center = walls.getArcCenter(i);
+        arcs.insert(arcs.end(), {center.x, center.y, walls.getArcRadius(i), walls.getArcStartAngle(i),
+                                 walls.getArcEndAngle(i)});
+    }
+    
+    table.clear();
+    auto append = [&](const void* data, std::size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        table.insert(table.end(), bytes, bytes + size);
+    };
+    append(&header, sizeof(header));
+    append(segments.data(), segments.size() * sizeof(float));
+    append(sizes.data(), sizes.size() * sizeof(uint32_t));
+    append(points.data(), points.size() * sizeof(float));
+    append(arcs.data(), arcs.size() * sizeof(float));
+}
+
+} // namespace
+
+namespace SceneBinary {
+
+void write(const std::string& path, const SceneDescription& scene) {
+    const uint64_t count = scene.obstacles.size();
+    const uint64_t floatBlock = count * sizeof(float);
+    
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.width = scene.width;
+    header.height = scene.height;
+    header.lightPosition[0] = scene.lightPosition.x;
+    header.lightPosition[1] = scene.lightPosition.y;
+    header.lightRadius = scene.lightRadius;
+    std::memcpy(header.lightColor, &scene.lightColor, sizeof(header.lightColor));
+    header.mainPosition[0] = scene.mainPosition.x;
+    header.mainPosition[1] = scene.mainPosition.y;
+    header.mainRadius = scene.mainRadius;
+    std::memcpy(header.mainColor, &scene.mainColor, sizeof(header.mainColor));
+    header.rayCount = scene.rayCount;
+    header.flags = scene.reflections ? FLAG_REFLECTIONS : 0u;
+    header.dispersion = scene.dispersion;
+    
+    header.obstacleCount = count;
+    header.xOffset = alignUp(sizeof(FileHeader));
+    header.yOffset = alignUp(header.xOffset + floatBlock);
+    header.radiusOffset = alignUp(header.yOffset + floatBlock);
+    header.colorOffset = alignUp(header.radiusOffset + floatBlock);
+    header.fileSize = header.colorOffset + 3 * floatBlock;
+    if (scene.obstacles.refractiveCount() > 0) {
+        header.iorOffset = alignUp(header.fileSize);
+        header.fileSize = header.iorOffset + floatBlock;
+    }
+    
+    std::vector<unsigned char> wallTable;
+    if (!scene.walls.empty()) {
+        packWalls(scene.walls, wallTable);
+        header.wallOffset = alignUp(header.fileSize);
+        header.wallSize = wallTable.size();
+        header.fileSize = header.wallOffset + header.wallSize;
+    }
+    
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file for writing: " + path);
+    }
+    
+    CircleView view = scene.obstacles.view();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeBlock(file, header.xOffset, view.x, floatBlock);
+    writeBlock(file, header.yOffset, view.y, floatBlock);
+    writeBlock(file, header.radiusOffset, view.radius, floatBlock);
+    writeBlock(file, header.colorOffset, scene.obstacles.colors(), 3 * floatBlock);
+    if (header.iorOffset != 0) {
+        writeBlock(file, header.iorOffset, scene.obstacles.iors(), floatBlock);
+    }
+    if (!wallTable.empty()) {
+        writeBlock(file, header.wallOffset, wallTable.data(), wallTable.size());
+    }
+    
+    if (!file) {
+        throw std::runtime_error("Failed to write scene file: " + path);
+    }
+}
+
+} // namespace SceneBinary
+
+MappedScene::MappedScene(const std::string& path)
+    : m_file(path),
+      m_data(m_file.data()),
+      m_size(m_file.size()),
+      m_header(reinterpret_cast<const SceneBinary::FileHeader*>(m_data)) {
+    validate(path);
+    readWalls(path);
+}
+
+void MappedScene::validate(const std::string& path) const {
+    if (m_size < SceneBinary::HEADER_SIZE_V1 ||
+        std::memcmp(m_header->magic, SceneBinary::MAGIC, sizeof(SceneBinary::MAGIC)) != 0) {
+        throw std::runtime_error("Not a RayTracerNG scene file: " + path);
+    }
+    uint32_t minHeaderSize = m_header->version == 1 ? SceneBinary::HEADER_SIZE_V1
+                           : m_header->version == 2 ? SceneBinary::HEADER_SIZE_V2
+                           : m_header->version == 3 ? SceneBinary::HEADER_SIZE_V3
+                                                    : static_cast<uint32_t>(sizeof(SceneBinary::FileHeader));
+    if (m_header->version < 1 || m_header->version > SceneBinary::VERSION || m_header->headerSize < minHeaderSize ||
+        m_header->headerSize > m_size) {
+        throw std::runtime_error("Unsupported scene file version " + std::to_string(m_header->version) + ": " + path);
+    }
+    
+    const uint64_t count = m_header->obstacleCount;
+    if (count > m_size / sizeof(float)) {
+        throw std::runtime_error("Scene file obstacle count exceeds file size: " + path);
+    }
+    // Compared as the room left after the offset, so a crafted offset cannot
+    // wrap the block end around to below the file size
+    auto checkBlock = [&](uint64_t offset, uint64_t floats) {
+        if (offset % alignof(float) != 0 || offset < m_header->headerSize || offset > m_size ||
+            floats > (m_size - offset) / sizeof(float)) {
+            throw std::runtime_error("Scene file obstacle table is truncated or misaligned: " + path);
+        }
+    };
+    checkBlock(m_header->xOffset, count);
+    checkBlock(m_header->yOffset, count);
+    checkBlock(m_header->radiusOffset, count);
+    checkBlock(m_header->colorOffset, 3 * count);
+    if (obstacleIors()) {
+        checkBlock(m_header->iorOffset, count);
+    }
+}
+
+void MappedScene::readWalls(const std::string& path) {
+    // Version 1 headers end before the wall fields
+    if (m_header->version < 2 || m_header->wallOffset == 0) return;
+    
+    uint64_t offset = m_header->wallOffset;
+    uint64_t end = offset + m_header->wallSize;
+    if (offset < m_header->headerSize || end < offset || end > m_size) {
+        throw std::runtime_error("Scene file wall table is truncated: " + path);
+    }
+    // Throws unless count items of itemSize bytes remain in the table
+    auto require = [&](uint64_t count, uint64_t itemSize) {
+        if (count > (end - offset) / itemSize) {
+            throw std::runtime_error("Scene file wall table is truncated: " + path);
+        }
+    };
+    // Copies count values from the table, which need not be aligned
+    auto read = [&](auto* out, uint64_t count) {
+        require(count, sizeof(*out));
+        std::memcpy(out, m_data + offset, count * sizeof(*out));
+        offset += count * sizeof(*out);
+    };
+    std::vector<float> values;
+    auto readFloats = [&](uint64_t count, uint64_t stride) {
+        require(count, stride * sizeof(float));
+        values.resize(static_cast<std::size_t>(count * stride));
+        read(values.data(), count * stride);
+    };
+    
+    SceneBinary::WallTableHeader table;
+    read(&table, 1);
+    
+    readFloats(table.segmentCount, 4);
+    for (std::size_t i = 0; i < table.segmentCount; ++i) {
+        m_walls.addSegment(glm::vec2(values[4 * i], values[4 * i + 1]), glm::vec2(values[4 * i + 2], values[4 * i + 3]));
+    }
+    
+    require(table.polygonCount, sizeof(uint32_t));
+    std::vector<uint32_t> sizes(static_cast<std::size_t>(table.polygonCount));
+    read(sizes.data(), table.polygonCount);
+    readFloats(table.polygonPointCount, 2);
+    std::vector<glm::vec2> points;
+    std::size_t next = 0;
+    for (uint32_t size : sizes) {
+        if (size < 3 || size > table.polygonPointCount - next) {
+            throw std::runtime_error("Scene file wall table has an invalid polygon: " + path);
+        }
+        points.clear();
+        for (uint32_t k = 0; k < size; ++k, ++next) {
+            points.push_back(glm::vec2(values[2 * next], values[2 * next + 1]));
+        }
+        m_walls.addPolygon(points);
+    }
+    
+    readFloats(table.arcCount, 5);
+    for (std::size_t i = 0; i < table.arcCount; ++i) {
+        const float* arc = &values[5 * i];
+        m_walls.addArc(glm::vec2(arc[0], arc[1]), arc[2], arc[3], arc[4]);
+    }
+}
+
+CircleView MappedScene::obstacles() const {
+    return CircleView{
+        reinterpret_cast<const float*>(m_data + m_header->xOffset),
+        reinterpret_cast<const float*>(m_data + m_header->yOffset),
+        reinterpret_cast<const float*>(m_data + m_header->radiusOffset),
+        static_cast<std::size_t>(m_header->obstacleCount)
+    };
+}
+
+const glm::vec3* MappedScene::obstacleColors() const {
+    return reinterpret_cast<const glm::vec3*>(m_data + m_header->colorOffset);
+}
+
+const float* MappedScene::obstacleIors() const {
+    // Version 1 and 2 headers end before iorOffset
+    if (m_header->version < 3 || m_header->iorOffset == 0) return nullptr;
+    return reinterpret_cast<const float*>(m_data + m_header->iorOffset);
+}
+
+TraceScene MappedScene::traceScene() const {
+    TraceScene scene;
+    scene.lightOrigin = glm::vec2(m_header->lightPosition[0], m_header->lightPosition[1]);
+    scene.mainPosition = glm::vec2(m_header->mainPosition[0], m_header->mainPosition[1]);
+    scene.mainRadius = m_header->mainRadius;
+    scene.obstacles = obstacles();
+    scene.obstacleIor = obstacleIors();
+    scene.obstacleColors = obstacleColors();
+    scene.occluders = m_walls.view();
+    scene.mainReflectance =
+        Tracer::reflectance(glm::vec3(m_header->mainColor[0], m_header->mainColor[1], m_header->mainColor[2]));
+    return scene;
+}
+
+SceneDescription MappedScene::toDescription(bool includeObstacles) const {
+    const SceneBinary::FileHeader& h = *m_header;
+    SceneDescription scene;
+    scene.width = h.width;
+    scene.height = h.height;
+    scene.lightPosition = glm::vec2(h.lightPosition[0], h.lightPosition[1]);
+    scene.lightRadius = h.lightRadius;
+    scene.lightColor = glm::vec3(h.lightColor[0], h.lightColor[1], h.lightColor[2]);
+    scene.mainPosition = glm::vec2(h.mainPosition[0], h.mainPosition[1]);
+    scene.mainRadius = h.mainRadius;
+    scene.mainColor = glm::vec3(h.mainColor[0], h.mainColor[1], h.mainColor[2]);
+    scene.rayCount = h.rayCount;
+    scene.reflections = (h.flags & SceneBinary::FLAG_REFLECTIONS) != 0;
+    // Version 1 to 3 headers end before dispersion
+    scene.dispersion = h.version >= 4 ? h.dispersion : 0.0f;
+    scene.walls = m_walls;
+    
+    if (includeObstacles) {
+        CircleView view = obstacles();
+        const glm::vec3* colors = obstacleColors();
+        const float* iors = obstacleIors();
+        scene.obstacles.reserve(view.count);
+        for (std::size_t i = 0; i < view.count; ++i) {
+            scene.obstacles.add(glm::vec2(view.x[i], view.y[i]), view.radius[i], colors[i],
+                                iors ? iors[i] : ObstacleStore::OPAQUE);
+        }
+    }
+    return scene;
+}
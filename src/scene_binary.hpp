@@ -0,0 +1,120 @@
+#pragma once
+#include "scene_layout.hpp"
+#include "tracer.hpp"
+#include "mapped_file.hpp"
+#include <glm/glm.hpp>
+#include <string>
+#include <cstdint>
+
+// Binary scene file (.rtscene)
+//
+// Layout, little-endian:
+//   SceneFileHeader
+//   obstacle x      float[count]
+//   obstacle y      float[count]
+//   obstacle radius float[count]
+//   obstacle color  float[3 * count]  (r, g, b interleaved)
+//   obstacle ior    float[count]      (version 3, only if any obstacle is glass)
+//   wall table      (version 2, only if the scene has walls)
+//     WallTableHeader
+//     segments        float[4 * segmentCount]       (x0, y0, x1, y1)
+//     polygon sizes   uint32_t[polygonCount]        (vertices per polygon)
+//     polygon points  float[2 * polygonPointCount]  (x, y)
+//     arcs            float[5 * arcCount]           (x, y, radius, start, end)
+// Each array starts at a SCENE_FILE_ALIGNMENT-aligned offset recorded in the
+// header, so a mapped file can be handed to the tracer as a CircleView. The
+// wall table is small and is read into an OccluderStore instead.
+namespace SceneBinary {
+    constexpr char MAGIC[8] = {'R', 'T', 'N', 'G', 'S', 'C', 'N', '\0'};
+    constexpr uint32_t VERSION = 4;
+    constexpr uint32_t HEADER_SIZE_V1 = 128;  // Version 1 headers end after fileSize
+    constexpr uint32_t HEADER_SIZE_V2 = 144;  // Version 2 headers end after wallSize
+    constexpr uint32_t HEADER_SIZE_V3 = 152;  // Version 3 headers end after iorOffset
+    constexpr uint64_t ALIGNMENT = 64;
+    
+    constexpr uint32_t FLAG_REFLECTIONS = 1u << 0;
+    
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;  // sizeof(FileHeader) when written; lets later versions grow it
+        
+        float width;
+        float height;
+        float lightPosition[2];
+        float lightRadius;
+        float lightColor[3];
+        float mainPosition[2];
+        float mainRadius;
+        float mainColor[3];
+        int32_t rayCount;
+        uint32_t flags;
+        
+        uint64_t obstacleCount;
+        uint64_t xOffset;       // Byte offsets from the start of the file
+        uint64_t yOffset;
+        uint64_t radiusOffset;
+        uint64_t colorOffset;
+        uint64_t fileSize;
+        
+        // Version 2
+        uint64_t wallOffset;  // 0 if the scene has no walls
+        uint64_t wallSize;
+        
+        // Version 3
+        uint64_t iorOffset;  // 0 if every obstacle is opaque
+        
+        // Version 4
+        float dispersion;  // TraceSettings::dispersion, 0 for none
+        uint32_t reserved;
+    };
+    static_assert(sizeof(FileHeader) == 160, "FileHeader layout is part of the file format");
+    
+    struct WallTableHeader {
+        uint64_t segmentCount;
+        uint64_t polygonCount;
+        uint64_t polygonPointCount;
+        uint64_t arcCount;
+    };
+    
+    // Writes the scene. Throws std::runtime_error on I/O failure.
+    void write(const std::string& path, const SceneDescription& scene);
+}
+
+// Read-only memory mapping of a binary scene file. Obstacle arrays are used
+// in place; only the wall table is copied out. The mapping lives as long as
+// the object. Version 1 (no walls), 2 (no glass) and 3 (no dispersion) files
+// are read as well.
+class MappedScene {
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is malformed
+    explicit MappedScene(const std::string& path);
+    
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+    
+    const SceneBinary::FileHeader& header() const { return *m_header; }
+    
+    CircleView obstacles() const;
+    const glm::vec3* obstacleColors() const;
+    // Indices of refraction, nullptr if every obstacle is opaque
+    const float* obstacleIors() const;
+    const OccluderStore& walls() const { return m_walls; }
+    
+    // Tracer input referencing the mapped obstacle arrays and walls()
+    TraceScene traceScene() const;
+    
+    // Copy of the scene. With includeObstacles false only the light, main
+    // object, walls and settings are filled in (for use alongside obstacles()).
+    SceneDescription toDescription(bool includeObstacles = true) const;
+
+private:
+    MappedFile m_file;
+    const unsigned char* m_data;
+    uint64_t m_size;
+    const SceneBinary::FileHeader* m_header;
+    OccluderStore m_walls;
+    
+    void validate(const std::string& path) const;
+    void readWalls(const std::string& path);
+};
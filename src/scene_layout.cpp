@@ -0,0 +1,282 @@
+#include "scene_layout.hpp"
+#include "free_space.hpp"
+#include "log.hpp"
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace SceneLayout {
+
+bool checkValidPosition(const PlacementView& view, const glm::vec2& position, float radius, bool isLightSource) {
+    // Define minimum safe distances
+    const float MIN_DISTANCE_TO_LIGHT = isLightSource ? 20.0f : 100.0f;  // Much smaller distance for light source
+    const float MIN_DISTANCE_TO_MAIN = isLightSource ? 20.0f : 80.0f;    // Much smaller distance for light source
+    const float MIN_DISTANCE_TO_OBSTACLE = isLightSource ? 20.0f : 60.0f; // Much smaller distance for light source
+    
+    // Check collision with light source with minimum distance
+    // Only check if the position is not the current light position
+    if (position != view.light.position) {
+        float distToLight = glm::length(position - view.light.position);
+        if (distToLight < (radius + view.light.radius + MIN_DISTANCE_TO_LIGHT)) {
+            if (isLightSource) {
+                LOG_DEBUG(Layout, "Position invalid: Too close to light source (distance: %g, min required: %g)",
+                          distToLight, radius + view.light.radius + MIN_DISTANCE_TO_LIGHT);
+            }
+            return false;
+        }
+    }
+    
+    // Check collision with main object with minimum distance
+    float distToMain = glm::length(position - view.main.position);
+    if (distToMain < (radius + view.main.radius + MIN_DISTANCE_TO_MAIN)) {
+        if (isLightSource) {
+            LOG_DEBUG(Layout, "Position invalid: Too close to main object (distance: %g, min required: %g)",
+                      distToMain, radius + view.main.radius + MIN_DISTANCE_TO_MAIN);
+        }
+        return false;
+    }
+    
+    // Check collision with other obstacles with minimum distance
+    const CircleView& obstacles = view.obstacles;
+    for (std::size_t i = 0; i < obstacles.count; ++i) {
+        float dist = glm::length(position - glm::vec2(obstacles.x[i], obstacles.y[i]));
+        if (dist < (radius + obstacles.radius[i] + MIN_DISTANCE_TO_OBSTACLE)) {
+            if (isLightSource) {
+                LOG_DEBUG(Layout, "Position invalid: Too close to obstacle (distance: %g, min required: %g)",
+                          dist, radius + obstacles.radius[i] + MIN_DISTANCE_TO_OBSTACLE);
+            }
+            return false;
+        }
+    }
+    
+    // Check if position is within screen bounds with padding
+    float padding = radius + (isLightSource ? 20.0f : 50.0f); // Much smaller padding for light source
+    if (position.x < -view.width/2.0f + padding || position.x > view.width/2.0f - padding ||
+        position.y < -view.height/2.0f + padding || position.y > view.height/2.0f - padding) {
+        if (isLightSource) {
+            LOG_DEBUG(Layout, "Position invalid: Outside screen bounds (x: %g, y: %g, padding: %g)",
+                      position.x, position.y, padding);
+        }
+        return false;
+    }
+    
+    return true;
+}
+
+namespace {
+
+// Rules an obstacle center must satisfy besides the spacing between
+// obstacles; the clearances match checkValidPosition
+struct ObstacleDomain {
+    glm::vec2 boundsMin;
+    glm::vec2 boundsMax;
+    glm::vec2 controlsMin;  // Controls section: x and y above this are excluded
+    LayoutCircle light;
+    LayoutCircle main;
+    float radius;
+    const FreeSpaceSampler* wallSpace = nullptr;  // Clearance around the walls, if there are any
+    
+    bool contains(const glm::vec2& p) const {
+        if (p.x < boundsMin.x || p.x > boundsMax.x || p.y < boundsMin.y || p.y > boundsMax.y) return false;
+        if (p.x > controlsMin.x && p.y > controlsMin.y) return false;
+        if (glm::length(p - light.position) < radius + light.radius + 100.0f) return false;
+        if (glm::length(p - main.position) < radius + main.radius + 80.0f) return false;
+        if (wallSpace && !wallSpace->isFree(p)) return false;
+        return true;
+    }
+};
+
+// Bridson's Poisson-disk sampling: a maximal set of points at least spacing
+// apart. A background grid with cells of spacing/sqrt(2) holds at most one
+// point per cell, so every candidate is checked against a 5x5 block of
+// cells and the whole fill runs in time linear in the number of points.
+std::vector<glm::vec2> poissonDiskFill(const ObstacleDomain& domain, float spacing, std::mt19937& gen) {
+    constexpr int CANDIDATES_PER_POINT = 30;  // Bridson's k
+    constexpr int SEED_ATTEMPTS = 30;         // Restarts for regions the front did not reach
+    
+    std::vector<glm::vec2> points;
+    glm::vec2 extent = domain.boundsMax - domain.boundsMin;
+    if (extent.x <= 0.0f || extent.y <= 0.0f) return points;
+    
+    const float cellSize = spacing / std::sqrt(2.0f);
+    const int columns = static_cast<int>(std::ceil(extent.x / cellSize)) + 1;
+    const int rows = static_cast<int>(std::ceil(extent.y / cellSize)) + 1;
+    std::vector<int32_t> grid(static_cast<std::size_t>(columns) * rows, -1);
+    const float spacingSq = spacing * spacing;
+    
+    auto cellOf = [&](const glm::vec2& p, int& column, int& row) {
+        column = static_cast<int>((p.x - domain.boundsMin.x) / cellSize);
+        row = static_cast<int>((p.y - domain.boundsMin.y) / cellSize);
+    };
+    auto accepts = [&](const glm::vec2& p) {
+        if (!domain.contains(p)) return false;
+        int column, row;
+        cellOf(p, column, row);
+        for (int y = std::max(0, row - 2); y <= std::min(rows - 1, row + 2); ++y) {
+            for (int x = std::max(0, column - 2); x <= std::min(columns - 1, column + 2); ++x) {
+                int32_t other = grid[static_cast<std::size_t>(y) * columns + x];
+                if (other >= 0) {
+                    glm::vec2 d = points[other] - p;
+                    if (d.x * d.x + d.y * d.y < spacingSq) return false;
+                }
+            }
+        }
+        return true;
+    };
+    std::vector<int32_t> active;
+    auto insert = [&](const glm::vec2& p) {
+        int column, row;
+        cellOf(p, column, row);
+        grid[static_cast<std::size_t>(row) * columns + column] = static_cast<int32_t>(points.size());
+        active.push_back(static_cast<int32_t>(points.size()));
+        points.push_back(p);
+    };
+    
+    std::uniform_real_distribution<float> xDist(domain.boundsMin.x, domain.boundsMax.x);
+    std::uniform_real_distribution<float> yDist(domain.boundsMin.y, domain.boundsMax.y);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float twoPi = 6.28318530718f;
+    glm::vec2 steps[CANDIDATES_PER_POINT];  // Unit rotations by i / k of a turn
+    for (int i = 0; i < CANDIDATES_PER_POINT; ++i) {
+        float angle = twoPi * i / CANDIDATES_PER_POINT;
+        steps[i] = glm::vec2(std::cos(angle), std::sin(angle));
+    }
+    
+    for (int seedAttempt = 0; seedAttempt < SEED_ATTEMPTS; ++seedAttempt) {
+        glm::vec2 seedPoint(xDist(gen), yDist(gen));
+        if (!accepts(seedPoint)) continue;
+        insert(seedPoint);
+        
+        while (!active.empty()) {
+            std::size_t slot = std::uniform_int_distribution<std::size_t>(0, active.size() - 1)(gen);
+            glm::vec2 center = points[active[slot]];
+            bool placed = false;
+            // Candidates just outside the spacing circle at evenly stepped
+            // angles from a random start (Roberts' variant of Bridson's
+            // annulus sampling): denser fills with far fewer rejections
+            float startAngle = twoPi * unit(gen);
+            glm::vec2 start = spacing * 1.001f * glm::vec2(std::cos(startAngle), std::sin(startAngle));
+            for (int i = 0; i < CANDIDATES_PER_POINT; ++i) {
+                const glm::vec2& step = steps[i];
+                glm::vec2 candidate = center + glm::vec2(start.x * step.x - start.y * step.y,
+                                                         start.x * step.y + start.y * step.x);
+                if (accepts(candidate)) {
+                    insert(candidate);
+                    placed = true;
+                    break;
+                }
+            }
+            if (!placed) {
+                active[slot] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+    return points;
+}
+
+} // namespace
+
+int generateObstacles(SceneDescription& scene, int count, unsigned int seed) {
+    // Clear existing obstacles
+    scene.obstacles.clear();
+    if (count <= 0) return 0;
+    
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> grayDist(0.3f, 0.7f);
+    
+    // Obstacles keep OBSTACLE_RADIUS and the usual 60 px gap while count fits
+    // on screen at that spacing; beyond that radius and gap shrink together
+    // so the fill reaches count, down to MIN_OBSTACLE_RADIUS
+    const float baseSpacing = 2.0f * OBSTACLE_RADIUS + 60.0f;
+    const float minScale = MIN_OBSTACLE_RADIUS / OBSTACLE_RADIUS;
+    auto makeDomain = [&](float radius) {
+        float padding = radius + 50.0f;
+        ObstacleDomain domain;
+        domain.boundsMin = glm::vec2(-scene.width/2.0f + padding, -scene.height/2.0f + padding);
+        domain.boundsMax = glm::vec2(scene.width/2.0f - padding, scene.height/2.0f - padding);
+        domain.controlsMin = glm::vec2(scene.width/2.0f - CONTROLS_WIDTH - CONTROLS_MARGIN,
+                                       -scene.height/2.0f + CONTROLS_MARGIN);
+        domain.light = LayoutCircle{scene.lightPosition, scene.lightRadius};
+        domain.main = LayoutCircle{scene.mainPosition, scene.mainRadius};
+        domain.radius = radius;
+        return domain;
+    };
+    
+    // These Poisson-disk fills hold about 1.2 points per spacing^2 of
+    // free area; the free area leaves out the controls section and the
+    // clearance disks around the light and main object
+    constexpr float FILL_DENSITY = 1.1f;  // Slightly low, so one fill nearly always suffices
+    ObstacleDomain baseDomain = makeDomain(OBSTACLE_RADIUS);
+    glm::vec2 extent = glm::max(baseDomain.boundsMax - baseDomain.boundsMin, glm::vec2(0.0f));
+    glm::vec2 controlsExtent = glm::max(baseDomain.boundsMax - glm::max(baseDomain.controlsMin, baseDomain.boundsMin),
+                                        glm::vec2(0.0f));
+    float lightClearance = OBSTACLE_RADIUS + scene.lightRadius + 100.0f;
+    float mainClearance = OBSTACLE_RADIUS + scene.mainRadius + 80.0f;
+    float area = extent.x * extent.y - controlsExtent.x * controlsExtent.y -
+                 3.14159265f * (lightClearance * lightClearance + mainClearance * mainClearance);
+    float scale = 1.0f;
+    if (area > 0.0f && count > area * FILL_DENSITY / (baseSpacing * baseSpacing)) {
+        scale = std::max(minScale, std::sqrt(area * FILL_DENSITY / count) / baseSpacing);
+    }
+    
+    // The estimate is approximate, so shrink further until the fill is large enough
+    std::vector<glm::vec2> points;
+    float radius = OBSTACLE_RADIUS;
+    FreeSpaceSampler wallSpace;
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        radius = OBSTACLE_RADIUS * scale;
+        float spacing = baseSpacing * scale;
+        ObstacleDomain domain = makeDomain(radius);
+        if (!scene.walls.empty()) {
+            // Walls keep half the spacing from obstacle centers, the gap an
+            // obstacle would leave to its mirror image across the wall
+            wallSpace.reset(domain.boundsMin, domain.boundsMax, 2.0f * spacing);
+            wallSpace.blockWalls(scene.walls, 0.5f * spacing);
+            wallSpace.finalize();
+            domain.wallSpace = &wallSpace;
+        }
+        points = poissonDiskFill(domain, spacing, gen);
+        if (static_cast<int>(points.size()) >= count || scale <= minScale) break;
+        float shortfall = points.empty() ? 0.5f : std::sqrt(static_cast<float>(points.size()) / count);
+        scale = std::max(minScale, scale * std::min(shortfall, 0.95f));
+    }
+    
+    // A random subset of a Poisson-disk set is spread as evenly as the set
+    std::shuffle(points.begin(), points.end(), gen);
+    int placed = std::min(count, static_cast<int>(points.size()));
+    scene.obstacles.reserve(placed);
+    for (int i = 0; i < placed; ++i) {
+        float gray = grayDist(gen);
+        scene.obstacles.add(points[i], radius, glm::vec3(gray, gray, gray));
+    }
+    return placed;
+}
+
+void addRoomWalls(OccluderStore& walls, float width, float height) {
+    const float INSET = 8.0f;
+    glm::vec2 half(width / 2.0f - INSET, height / 2.0f - INSET);
+    walls.addPolygon({glm::vec2(-half.x, -half.y), glm::vec2(half.x, -half.y), glm::vec2(half.x, half.y),
+                      glm::vec2(-half.x, half.y)});
+    
+    // Partition hanging from the top edge, leaving a doorway below it
+    float partitionX = -0.25f * width;
+    walls.addSegment(glm::vec2(partitionX, half.y), glm::vec2(partitionX, 0.15f * height));
+    
+    // Hexagonal pillar
+    glm::vec2 pillar(0.22f * width, 0.22f * height);
+    float pillarRadius = 0.05f * height;
+    std::vector<glm::vec2> corners;
+    for (int i = 0; i < 6; ++i) {
+        float angle = 3.14159265f * static_cast<float>(i) / 3.0f;
+        corners.push_back(pillar + pillarRadius * glm::vec2(std::cos(angle), std::sin(angle)));
+    }
+    walls.addPolygon(corners);
+    
+    // Curved wall below and left of the main object
+    walls.addArc(glm::vec2(-0.1f * width, -0.2f * height), 0.12f * height, 3.6f, 5.8f);
+}
+
+} // namespace SceneLayout
@@ -0,0 +1,73 @@
+#pragma once
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include <glm/glm.hpp>
+
+// Circle used for the light source and main object in placement checks
+struct LayoutCircle {
+    glm::vec2 position{0.0f};
+    float radius{0.0f};
+};
+
+// Everything placement rules test a candidate position against
+struct PlacementView {
+    LayoutCircle light;
+    LayoutCircle main;
+    CircleView obstacles;
+    float width{1280.0f};
+    float height{720.0f};
+};
+
+// GL-free description of a scene: what Scene holds in its game objects,
+// plus the tracing settings. Used by the batch renderer and scene files.
+struct SceneDescription {
+    float width{1280.0f};
+    float height{720.0f};
+    
+    glm::vec2 lightPosition{-500.0f, 0.0f};
+    float lightRadius{20.0f};
+    glm::vec3 lightColor{1.0f, 0.95f, 0.4f};
+    
+    glm::vec2 mainPosition{0.0f, 0.0f};
+    float mainRadius{25.0f};
+    glm::vec3 mainColor{0.0f, 1.0f, 0.0f};
+    
+    ObstacleStore obstacles;
+    OccluderStore walls;
+    
+    int rayCount{90};
+    bool reflections{true};
+    float dispersion{0.0f};  // TraceSettings::dispersion of the glass
+    
+    PlacementView placementView() const {
+        return PlacementView{{lightPosition, lightRadius}, {mainPosition, mainRadius},
+                             obstacles.view(), width, height};
+    }
+};
+
+namespace SceneLayout {
+    // Control section footprint kept free of obstacles (bottom right corner)
+    constexpr float CONTROLS_WIDTH = 484.0f;
+    constexpr float CONTROLS_HEIGHT = 275.0f;
+    constexpr float CONTROLS_MARGIN = 20.0f;
+    
+    constexpr float OBSTACLE_RADIUS = 30.0f;
+    // Smallest radius generated obstacles shrink to when many are requested
+    constexpr float MIN_OBSTACLE_RADIUS = 0.25f;
+    
+    // Checks a circle against the light, main object, obstacles and screen
+    // bounds with the clearances used for obstacle (or light) placement
+    bool checkValidPosition(const PlacementView& view, const glm::vec2& position, float radius,
+                            bool isLightSource = false);
+    
+    // Replaces the obstacles with up to count randomly placed ones, drawn
+    // from a Poisson-disk fill in linear time. Counts that do not fit at
+    // OBSTACLE_RADIUS get smaller obstacles. Returns the number placed, below
+    // count only when even MIN_OBSTACLE_RADIUS obstacles do not fit.
+    int generateObstacles(SceneDescription& scene, int count, unsigned int seed);
+    
+    // Adds a room to walls for a width x height screen: a polygon along the
+    // screen edges, a partition wall with a doorway, a pillar and a curved
+    // wall, all clear of the default light and main object positions
+    void addRoomWalls(OccluderStore& walls, float width, float height);
+}
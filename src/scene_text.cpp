@@ -0,0 +1,738 @@
+#include "scene_text.hpp"
+#include <charconv>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <initializer_list>
+#include <vector>
+#include <cstdio>
+
+namespace {
+
+constexpr int TEXT_FORMAT_VERSION = 1;
+constexpr size_t READ_BUFFER_SIZE = 1 << 16;
+constexpr size_t MAX_TOKEN_LENGTH = 64;
+
+// Buffered character source with line/column tracking for error messages
+class StreamReader {
+public:
+    explicit StreamReader(std::istream& in) : m_in(in), m_buffer(READ_BUFFER_SIZE) {}
+
+    int peek() {
+        if (m_pos == m_end && !refill()) return EOF;
+        return static_cast<unsigned char>(m_buffer[m_pos]);
+    }
+
+    int get() {
+        int c = peek();
+        if (c != EOF) {
+            ++m_pos;
+            if (c == '\n') {
+                ++m_line;
+                m_column = 1;
+            } else {
+                ++m_column;
+            }
+        }
+        return c;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("line " + std::to_string(m_line) + ", column " + std::to_string(m_column) + ": " + message);
+    }
+
+private:
+    std::istream& m_in;
+    std::vector<char> m_buffer;
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    size_t m_line = 1;
+    size_t m_column = 1;
+
+    bool refill() {
+        m_in.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_end = static_cast<size_t>(m_in.gcount());
+        m_pos = 0;
+        return m_end > 0;
+    }
+};
+
+// Shortest round-trip representation
+void writeFloat(std::ostream& out, float value) {
+    char buffer[MAX_TOKEN_LENGTH];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.write(buffer, result.ptr - buffer);
+}
+
+float parseFloatToken(StreamReader& reader, const char* begin, const char* end) {
+    float value = 0.0f;
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || result.ptr != end) {
+        reader.fail("invalid number '" + std::string(begin, end) + "'");
+    }
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// JSON
+
+class JsonSceneReader {
+public:
+    JsonSceneReader(StreamReader& reader, SceneDescription& scene) : m_reader(reader), m_scene(scene) {}
+
+    void parse() {
+        parseObject([this](const std::string& key) { parseSceneField(key); });
+        skipWhitespace();
+        if (m_reader.peek() != EOF) {
+            m_reader.fail("unexpected data after the scene object");
+        }
+    }
+
+private:
+    StreamReader& m_reader;
+    SceneDescription& m_scene;
+
+    void parseSceneField(const std::string& key) {
+        if (key == "version") {
+            if (static_cast<int>(parseNumber()) != TEXT_FORMAT_VERSION) {
+                m_reader.fail("unsupported scene version");
+            }
+        } else if (key == "width") {
+            m_scene.width = parseNumber();
+        } else if (key == "height") {
+            m_scene.height = parseNumber();
+        } else if (key == "light") {
+            parseCircle(m_scene.lightPosition, m_scene.lightRadius, m_scene.lightColor);
+        } else if (key == "main") {
+            parseCircle(m_scene.mainPosition, m_scene.mainRadius, m_scene.mainColor);
+        } else if (key == "tracing") {
+            parseObject([this](const std::string& field) {
+                if (field == "rays") {
+                    m_scene.rayCount = static_cast<int>(parseNumber());
+                } else if (field == "reflections") {
+                    m_scene.reflections = parseBool();
+                } else if (field == "dispersion") {
+                    m_scene.dispersion = parseNumber();
+                } else {
+                    skipValue();
+                }
+            });
+        } else if (key == "walls") {
+            m_scene.walls.clear();
+            parseObject([this](const std::string& field) { parseWalls(field); });
+        } else if (key == "obstacles") {
+            m_scene.obstacles.clear();
+            parseArray([this]() {
+                glm::vec2 position(0.0f);
+                float radius = SceneLayout::OBSTACLE_RADIUS;
+                glm::vec3 color(0.5f);
+                float ior = ObstacleStore::OPAQUE;
+                parseObject([&](const std::string& field) {
+                    if (field == "x") {
+                        position.x = parseNumber();
+                    } else if (field == "y") {
+                        position.y = parseNumber();
+                    } else if (field == "radius") {
+                        radius = parseNumber();
+                    } else if (field == "color") {
+                        color = parseVec3();
+                    } else if (field == "ior") {
+                        ior = parseNumber();
+                    } else {
+                        skipValue();
+                    }
+                });
+                m_scene.obstacles.add(position, radius, color, ior);
+            });
+        } else {
+            skipValue();
+        }
+    }
+
+    void parseWalls(const std::string& key) {
+        if (key == "segments") {
+            parseArray([this]() {
+                glm::vec2 from(0.0f);
+                glm::vec2 to(0.0f);
+                parseObject([&](const std::string& field) {
+                    if (field == "from") {
+                        from = parseVec2();
+                    } else if (field == "to") {
+                        to = parseVec2();
+                    } else {
+                        skipValue();
+                    }
+                });
+                m_scene.walls.addSegment(from, to);
+            });
+        } else if (key == "polygons") {
+            std::vector<glm::vec2> points;
+            parseArray([&]() {
+                points.clear();
+                parseArray([&]() { points.push_back(parseVec2()); });
+                if (points.size() < 3) m_reader.fail("a polygon needs at least 3 points");
+                m_scene.walls.addPolygon(points);
+            });
+        } else if (key == "arcs") {
+            parseArray([this]() {
+                glm::vec2 center(0.0f);
+                float radius = 0.0f;
+                float start = 0.0f;
+                float end = 0.0f;
+                parseObject([&](const std::string& field) {
+                    if (field == "center") {
+                        center = parseVec2();
+                    } else if (field == "radius") {
+                        radius = parseNumber();
+                    } else if (field == "start") {
+                        start = parseNumber();
+                    } else if (field == "end") {
+                        end = parseNumber();
+                    } else {
+                        skipValue();
+                    }
+                });
+                m_scene.walls.addArc(center, radius, start, end);
+            });
+        } else {
+            skipValue();
+        }
+    }
+
+    void parseCircle(glm::vec2& position, float& radius, glm::vec3& color) {
+        parseObject([&](const std::string& field) {
+            if (field == "position") {
+                position = parseVec2();
+            } else if (field == "radius") {
+                radius = parseNumber();
+            } else if (field == "color") {
+                color = parseVec3();
+            } else {
+                skipValue();
+            }
+        });
+    }
+
+    void skipWhitespace() {
+        for (int c = m_reader.peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = m_reader.peek()) {
+            m_reader.get();
+        }
+    }
+
+    void expect(char expected) {
+        skipWhitespace();
+        if (m_reader.get() != expected) {
+            m_reader.fail(std::string("expected '") + expected + "'");
+        }
+    }
+
+    // Calls onField(key) with the reader positioned at each value
+    template <typename OnField>
+    void parseObject(OnField&& onField) {
+        expect('{');
+        skipWhitespace();
+        if (m_reader.peek() == '}') {
+            m_reader.get();
+            return;
+        }
+        while (true) {
+            skipWhitespace();
+            std::string key;  // Keys are short enough for the small string buffer
+            parseString(key);
+            expect(':');
+            onField(key);
+            skipWhitespace();
+            int c = m_reader.get();
+            if (c == '}') return;
+            if (c != ',') m_reader.fail("expected ',' or '}'");
+        }
+    }
+
+    template <typename OnElement>
+    void parseArray(OnElement&& onElement) {
+        expect('[');
+        skipWhitespace();
+        if (m_reader.peek() == ']') {
+            m_reader.get();
+            return;
+        }
+        while (true) {
+            onElement();
+            skipWhitespace();
+            int c = m_reader.get();
+            if (c == ']') return;
+            if (c != ',') m_reader.fail("expected ',' or ']'");
+        }
+    }
+
+    void parseString(std::string& out) {
+        out.clear();
+        if (m_reader.get() != '"') m_reader.fail("expected string");
+        while (true) {
+            int c = m_reader.get();
+            if (c == EOF) m_reader.fail("unterminated string");
+            if (c == '"') return;
+            if (c == '\\') {
+                c = m_reader.get();
+                switch (c) {
+                    case '"': case '\\': case '/': break;
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u':
+                        // Keys and values we read are ASCII; keep a placeholder
+                        for (int i = 0; i < 4; ++i) m_reader.get();
+                        c = '?';
+                        break;
+                    default: m_reader.fail("invalid escape in string");
+                }
+            }
+            out.push_back(static_cast<char>(c));
+        }
+    }
+
+    float parseNumber() {
+        skipWhitespace();
+        char token[MAX_TOKEN_LENGTH];
+        size_t length = 0;
+        for (int c = m_reader.peek(); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+             c = m_reader.peek()) {
+            if (length == sizeof(token)) m_reader.fail("number too long");
+            token[length++] = static_cast<char>(m_reader.get());
+        }
+        if (length == 0) m_reader.fail("expected number");
+        return parseFloatToken(m_reader, token, token + length);
+    }
+
+    bool parseBool() {
+        skipWhitespace();
+        if (matchLiteral("true")) return true;
+        if (matchLiteral("false")) return false;
+        m_reader.fail("expected true or false");
+    }
+
+    bool matchLiteral(const char* literal) {
+        if (m_reader.peek() != literal[0]) return false;
+        for (const char* p = literal; *p; ++p) {
+            if (m_reader.get() != *p) m_reader.fail(std::string("invalid literal, expected ") + literal);
+        }
+        return true;
+    }
+
+    glm::vec2 parseVec2() {
+        glm::vec2 v(0.0f);
+        int count = 0;
+        parseArray([&]() {
+            if (count >= 2) m_reader.fail("expected 2 components");
+            v[count++] = parseNumber();
+        });
+        if (count != 2) m_reader.fail("expected 2 components");
+        return v;
+    }
+
+    glm::vec3 parseVec3() {
+        glm::vec3 v(0.0f);
+        int count = 0;
+        parseArray([&]() {
+            if (count >= 3) m_reader.fail("expected 3 components");
+            v[count++] = parseNumber();
+        });
+        if (count != 3) m_reader.fail("expected 3 components");
+        return v;
+    }
+
+    void skipValue() {
+        skipWhitespace();
+        int c = m_reader.peek();
+        if (c == '{') {
+            parseObject([this](const std::string&) { skipValue(); });
+        } else if (c == '[') {
+            parseArray([this]() { skipValue(); });
+        } else if (c == '"') {
+            std::string ignored;
+            parseString(ignored);
+        } else if (c == 't' || c == 'f') {
+            parseBool();
+        } else if (c == 'n') {
+            matchLiteral("null");
+        } else {
+            parseNumber();
+        }
+    }
+};
+
+void writeVec(std::ostream& out, const float* values, int count) {
+    out << "[";
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) out << ", ";
+        writeFloat(out, values[i]);
+    }
+    out << "]";
+}
+
+void writeJsonCircle(std::ostream& out, const char* name, const glm::vec2& position, float radius, const glm::vec3& color) {
+    out << "  \"" << name << "\": {\"position\": ";
+    writeVec(out, &position.x, 2);
+    out << ", \"radius\": ";
+    writeFloat(out, radius);
+    out << ", \"color\": ";
+    writeVec(out, &color.x, 3);
+    out << "},\n";
+}
+
+void writeJsonWalls(std::ostream& out, const OccluderStore& walls) {
+    out << "  \"walls\": {\n    \"segments\": [";
+    for (size_t i = 0; i < walls.segmentCount(); ++i) {
+        glm::vec2 from = walls.getSegmentStart(i);
+        glm::vec2 to = walls.getSegmentEnd(i);
+        out << (i > 0 ? ",\n      " : "\n      ") << "{\"from\": ";
+        writeVec(out, &from.x, 2);
+        out << ", \"to\": ";
+        writeVec(out, &to.x, 2);
+        out << "}";
+    }
+    out << (walls.segmentCount() == 0 ? "],\n" : "\n    ],\n");
+    out << "    \"polygons\": [";
+    for (size_t p = 0; p < walls.polygonCount(); ++p) {
+        out << (p > 0 ? ",\n      [" : "\n      [");
+        for (size_t k = 0; k < walls.getPolygonVertexCount(p); ++k) {
+            glm::vec2 point = walls.getPolygonVertex(p, k);
+            if (k > 0) out << ", ";
+            writeVec(out, &point.x, 2);
+        }
+        out << "]";
+    }
+    out << (walls.polygonCount() == 0 ? "],\n" : "\n    ],\n");
+    out << "    \"arcs\": [";
+    for (size_t i = 0; i < walls.arcCount(); ++i) {
+        glm::vec2 center = walls.getArcCenter(i);
+        out << (i > 0 ? ",\n      " : "\n      ") << "{\"center\": ";
+        writeVec(out, &center.x, 2);
+        out << ", \"radius\": ";
+        writeFloat(out, walls.getArcRadius(i));
+        out << ", \"start\": ";
+        writeFloat(out, walls.getArcStartAngle(i));
+        out << ", \"end\": ";
+        writeFloat(out, walls.getArcEndAngle(i));
+        out << "}";
+    }
+    out << (walls.arcCount() == 0 ? "]\n" : "\n    ]\n");
+    out << "  }";
+}
+
+void writeJson(std::ostream& out, const SceneDescription& scene) {
+    out << "{\n";
+    out << "  \"version\": " << TEXT_FORMAT_VERSION << ",\n";
+    out << "  \"width\": ";
+    writeFloat(out, scene.width);
+    out << ", \"height\": ";
+    writeFloat(out, scene.height);
+    out << ",\n";
+    writeJsonCircle(out, "light", scene.lightPosition, scene.lightRadius, scene.lightColor);
+    writeJsonCircle(out, "main", scene.mainPosition, scene.mainRadius, scene.mainColor);
+    out << "  \"tracing\": {\"rays\": " << scene.rayCount
+        << ", \"reflections\": " << (scene.reflections ? "true" : "false");
+    if (scene.dispersion > 0.0f) {
+        out << ", \"dispersion\": ";
+        writeFloat(out, scene.dispersion);
+    }
+    out << "},\n";
+    out << "  \"obstacles\": [";
+    for (size_t i = 0; i < scene.obstacles.size(); ++i) {
+        glm::vec2 position = scene.obstacles.getPosition(i);
+        out << (i > 0 ? ",\n    " : "\n    ") << "{\"x\": ";
+        writeFloat(out, position.x);
+        out << ", \"y\": ";
+        writeFloat(out, position.y);
+        out << ", \"radius\": ";
+        writeFloat(out, scene.obstacles.getRadius(i));
+        out << ", \"color\": ";
+        writeVec(out, &scene.obstacles.getColor(i).x, 3);
+        if (scene.obstacles.getIor(i) > 0.0f) {
+            out << ", \"ior\": ";
+            writeFloat(out, scene.obstacles.getIor(i));
+        }
+        out << "}";
+    }
+    out << (scene.obstacles.empty() ? "]" : "\n  ]");
+    if (!scene.walls.empty()) {
+        out << ",\n";
+        writeJsonWalls(out, scene.walls);
+    }
+    out << "\n}\n";
+}
+
+// ---------------------------------------------------------------------------
+// CSV
+
+class CsvSceneReader {
+public:
+    CsvSceneReader(StreamReader& reader, SceneDescription& scene) : m_reader(reader), m_scene(scene) {}
+
+    void parse() {
+        while (m_reader.peek() != EOF) {
+            if (m_reader.peek() != '#' && readRecord()) {
+                parseRecord();
+            }
+            skipLine();
+        }
+        finishPolygon();
+    }
+
+private:
+    static constexpr size_t MAX_FIELDS = 8;
+
+    StreamReader& m_reader;
+    SceneDescription& m_scene;
+    std::string m_fields[MAX_FIELDS];  // Reused between records
+    size_t m_fieldCount = 0;
+    bool m_inPolygon = false;           // Vertex records go to m_polygon
+    std::vector<glm::vec2> m_polygon;
+
+    void parseRecord() {
+        const std::string& type = m_fields[0];
+        if (type == "vertex") {
+            requireFields(3, 3);
+            if (!m_inPolygon) m_reader.fail("vertex outside a polygon");
+            m_polygon.push_back(glm::vec2(number(1), number(2)));
+            return;
+        }
+        finishPolygon();
+
+        if (type == "viewport") {
+            requireFields(3, 3);
+            m_scene.width = number(1);
+            m_scene.height = number(2);
+        } else if (type == "tracing") {
+            requireFields(3, 4);
+            m_scene.rayCount = static_cast<int>(number(1));
+            m_scene.reflections = number(2) != 0.0f;
+            m_scene.dispersion = m_fieldCount == 4 ? number(3) : 0.0f;
+        } else if (type == "light") {
+            requireFields(7, 7);
+            readCircle(m_scene.lightPosition, m_scene.lightRadius, m_scene.lightColor);
+        } else if (type == "main") {
+            requireFields(7, 7);
+            readCircle(m_scene.mainPosition, m_scene.mainRadius, m_scene.mainColor);
+        } else if (type == "obstacle") {
+            requireFields(4, 8);
+            glm::vec2 position;
+            float radius;
+            glm::vec3 color(0.5f);
+            float ior = ObstacleStore::OPAQUE;
+            if (m_fieldCount >= 7) {
+                readCircle(position, radius, color);
+                if (m_fieldCount == 8) {
+                    ior = number(7);
+                }
+            } else if (m_fieldCount == 4) {
+                position = glm::vec2(number(1), number(2));
+                radius = number(3);
+            } else {
+                m_reader.fail("obstacle needs 3, 6 or 7 values");
+            }
+            m_scene.obstacles.add(position, radius, color, ior);
+        } else if (type == "segment") {
+            requireFields(5, 5);
+            m_scene.walls.addSegment(glm::vec2(number(1), number(2)), glm::vec2(number(3), number(4)));
+        } else if (type == "polygon") {
+            requireFields(1, 1);
+            m_inPolygon = true;
+        } else if (type == "arc") {
+            requireFields(6, 6);
+            m_scene.walls.addArc(glm::vec2(number(1), number(2)), number(3), number(4), number(5));
+        } else {
+            m_reader.fail("unknown record type '" + type + "'");
+        }
+    }
+
+    // Adds the polygon whose vertices were read since its polygon record
+    void finishPolygon() {
+        if (!m_inPolygon) return;
+        if (m_polygon.size() < 3) m_reader.fail("a polygon needs at least 3 vertices");
+        m_scene.walls.addPolygon(m_polygon);
+        m_polygon.clear();
+        m_inPolygon = false;
+    }
+
+    void skipLine() {
+        for (int c = m_reader.get(); c != EOF && c != '\n'; c = m_reader.get()) {}
+    }
+
+    // Reads the fields of one line. Returns false for blank lines.
+    bool readRecord() {
+        m_fieldCount = 0;
+        bool blank = true;
+        while (true) {
+            if (m_fieldCount == MAX_FIELDS) m_reader.fail("too many fields");
+            std::string& field = m_fields[m_fieldCount++];
+            field.clear();
+            int c = m_reader.peek();
+            for (; c != EOF && c != ',' && c != '\n'; c = m_reader.peek()) {
+                m_reader.get();
+                if (c == ' ' || c == '\t' || c == '\r') continue;
+                field.push_back(static_cast<char>(c));
+                blank = false;
+            }
+            if (c == ',') {
+                m_reader.get();
+                blank = false;
+                continue;
+            }
+            return !blank;  // Leaves the newline for skipLine
+        }
+    }
+
+    void requireFields(size_t min, size_t max) {
+        if (m_fieldCount < min || m_fieldCount > max) {
+            m_reader.fail("wrong number of fields for '" + m_fields[0] + "'");
+        }
+    }
+
+    float number(size_t index) {
+        const std::string& field = m_fields[index];
+        return parseFloatToken(m_reader, field.data(), field.data() + field.size());
+    }
+
+    void readCircle(glm::vec2& position, float& radius, glm::vec3& color) {
+        position = glm::vec2(number(1), number(2));
+        radius = number(3);
+        color = glm::vec3(number(4), number(5), number(6));
+    }
+};
+
+// An index of refraction is only written for glass obstacles
+void writeCsvCircle(std::ostream& out, const char* type, const glm::vec2& position, float radius, const glm::vec3& color,
+                    float ior = ObstacleStore::OPAQUE) {
+    const float values[] = {position.x, position.y, radius, color.r, color.g, color.b};
+    out << type;
+    for (float value : values) {
+        out << ",";
+        writeFloat(out, value);
+    }
+    if (ior > 0.0f) {
+        out << ",";
+        writeFloat(out, ior);
+    }
+    out << "\n";
+}
+
+void writeCsv(std::ostream& out, const SceneDescription& scene) {
+    out << "# RayTracerNG scene v" << TEXT_FORMAT_VERSION << "\n";
+    out << "viewport,";
+    writeFloat(out, scene.width);
+    out << ",";
+    writeFloat(out, scene.height);
+    out << "\n";
+    out << "tracing," << scene.rayCount << "," << (scene.reflections ? 1 : 0);
+    if (scene.dispersion > 0.0f) {
+        out << ",";
+        writeFloat(out, scene.dispersion);
+    }
+    out << "\n";
+    writeCsvCircle(out, "light", scene.lightPosition, scene.lightRadius, scene.lightColor);
+    writeCsvCircle(out, "main", scene.mainPosition, scene.mainRadius, scene.mainColor);
+    out << "# obstacle,x,y,radius,r,g,b[,ior]\n";
+    for (size_t i = 0; i < scene.obstacles.size(); ++i) {
+        writeCsvCircle(out, "obstacle", scene.obstacles.getPosition(i), scene.obstacles.getRadius(i),
+                       scene.obstacles.getColor(i), scene.obstacles.getIor(i));
+    }
+
+    const OccluderStore& walls = scene.walls;
+    if (walls.empty()) return;
+    out << "# segment,x0,y0,x1,y1 / polygon then vertex,x,y per point / arc,x,y,radius,start,end\n";
+    auto writeValues = [&](const char* type, std::initializer_list<float> values) {
+        out << type;
+        for (float value : values) {
+            out << ",";
+            writeFloat(out, value);
+        }
+        out << "\n";
+    };
+    for (size_t i = 0; i < walls.segmentCount(); ++i) {
+        glm::vec2 from = walls.getSegmentStart(i);
+        glm::vec2 to = walls.getSegmentEnd(i);
+        writeValues("segment", {from.x, from.y, to.x, to.y});
+    }
+    for (size_t p = 0; p < walls.polygonCount(); ++p) {
+        out << "polygon\n";
+        for (size_t k = 0; k < walls.getPolygonVertexCount(p); ++k) {
+            glm::vec2 point = walls.getPolygonVertex(p, k);
+            writeValues("vertex", {point.x, point.y});
+        }
+    }
+    for (size_t i = 0; i < walls.arcCount(); ++i) {
+        glm::vec2 center = walls.getArcCenter(i);
+        writeValues("arc", {center.x, center.y, walls.getArcRadius(i), walls.getArcStartAngle(i),
+                            walls.getArcEndAngle(i)});
+    }
+}
+
+bool hasExtension(const std::string& path, const char* extension) {
+    std::string ext(extension);
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+} // namespace
+
+namespace SceneText {
+
+Format formatFromPath(const std::string& path) {
+    if (hasExtension(path, ".json")) return Format::Json;
+    if (hasExtension(path, ".csv")) return Format::Csv;
+    throw std::runtime_error("Unknown scene text format (expected .json or .csv): " + path);
+}
+
+bool isTextScenePath(const std::string& path) {
+    return hasExtension(path, ".json") || hasExtension(path, ".csv");
+}
+
+void write(std::ostream& out, const SceneDescription& scene, Format format) {
+    if (format == Format::Json) {
+        writeJson(out, scene);
+    } else {
+        writeCsv(out, scene);
+    }
+}
+
+SceneDescription read(std::istream& in, Format format) {
+    SceneDescription scene;
+    StreamReader reader(in);
+    if (format == Format::Json) {
+        JsonSceneReader(reader, scene).parse();
+    } else {
+        CsvSceneReader(reader, scene).parse();
+    }
+    return scene;
+}
+
+void save(const std::string& path, const SceneDescription& scene) {
+    Format format = formatFromPath(path);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file for writing: " + path);
+    }
+    write(file, scene, format);
+    if (!file) {
+        throw std::runtime_error("Failed to write scene file: " + path);
+    }
+}
+
+SceneDescription load(const std::string& path) {
+    Format format = formatFromPath(path);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open scene file: " + path);
+    }
+    try {
+        return read(file, format);
+    }
+    catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+} // namespace SceneText
@@ -0,0 +1,61 @@
+#pragma once
+#include "scene_layout.hpp"
+#include <iosfwd>
+#include <string>
+
+// Human-editable scene interchange in JSON or CSV.
+//
+// JSON:
+//   {
+//     "version": 1,
+//     "width": 1280, "height": 720,
+//     "light": {"position": [-500, 0], "radius": 20, "color": [1, 0.95, 0.4]},
+//     "main": {"position": [0, 0], "radius": 25, "color": [0, 1, 0]},
+//     "tracing": {"rays": 90, "reflections": true, "dispersion": 0.02},
+//     "obstacles": [
+//       {"x": 120, "y": -40, "radius": 30, "color": [0.5, 0.5, 0.5]},
+//       {"x": -80, "y": 60, "radius": 30, "color": [0.5, 0.5, 0.5], "ior": 1.5}
+//     ],
+//     "walls": {
+//       "segments": [{"from": [-300, 200], "to": [-300, 50]}],
+//       "polygons": [[[200, 100], [260, 100], [230, 150]]],
+//       "arcs": [{"center": [0, -100], "radius": 80, "start": 3.6, "end": 5.8}]
+//     }
+//   }
+// Unknown keys are skipped; missing keys keep SceneDescription defaults.
+// Arc angles are in radians, counter-clockwise from start to end; "walls"
+// is only written for scenes that have any. "ior" is the index of
+// refraction of glass obstacles and is omitted for opaque ones. "dispersion"
+// is the glass's TraceSettings::dispersion and is omitted when it is 0.
+//
+// CSV: one record per line, '#' lines are comments. The first field selects
+// the record type:
+//   viewport,<width>,<height>
+//   tracing,<rays>,<reflections 0|1>[,<dispersion>]
+//   light,<x>,<y>,<radius>,<r>,<g>,<b>
+//   main,<x>,<y>,<radius>,<r>,<g>,<b>
+//   obstacle,<x>,<y>,<radius>[,<r>,<g>,<b>[,<ior>]]
+//   segment,<x0>,<y0>,<x1>,<y1>
+//   polygon                  (its points follow as vertex records)
+//   vertex,<x>,<y>
+//   arc,<x>,<y>,<radius>,<start>,<end>
+//
+// Both readers stream: input is consumed through a fixed-size buffer and
+// obstacles are appended as they are parsed, with no intermediate document.
+// Floats are written with the shortest representation that parses back to
+// the same value, so export followed by import is lossless.
+namespace SceneText {
+    enum class Format { Json, Csv };
+    
+    // Picks the format from a .json or .csv extension. Throws std::runtime_error otherwise.
+    Format formatFromPath(const std::string& path);
+    bool isTextScenePath(const std::string& path);
+    
+    void write(std::ostream& out, const SceneDescription& scene, Format format);
+    
+    // Throws std::runtime_error with the line and column of the first error
+    SceneDescription read(std::istream& in, Format format);
+    
+    void save(const std::string& path, const SceneDescription& scene);
+    SceneDescription load(const std::string& path);
+}
@@ -2,26 +2,201 @@
 #include <string>
 
 namespace Shaders {
+    // Uniform block binding for the per-frame constants (see Scene::FrameUniforms)
+    constexpr unsigned int FRAME_UBO_BINDING = 0;
+
+    // Vertex attribute locations
+    // Attributes 1-3 are per-instance for circles; for rays and the crosshair
+    // they are left disabled and read from the current generic attribute value.
+    constexpr unsigned int ATTRIB_POSITION = 0;
+    constexpr unsigned int ATTRIB_INSTANCE_POSITION = 1;
+    constexpr unsigned int ATTRIB_INSTANCE_SCALE = 2;
+    constexpr unsigned int ATTRIB_COLOR = 3;
+    constexpr unsigned int ATTRIB_DASH = 4;
+
     const std::string vertexShaderSource = R"(
         #version 450 core
+        layout (std140, binding = 0) uniform FrameData {
+            mat4 projection;
+            vec4 viewport;  // x, y, width, height
+            float time;
+        };
+
         layout (location = 0) in vec2 aPos;
-        uniform mat4 projection;
-        uniform vec2 position;
-        uniform float scale;
+        layout (location = 1) in vec2 iPosition;
+        layout (location = 2) in float iScale;
+        layout (location = 3) in vec3 iColor;
+        layout (location = 4) in vec2 aDash;  // x: distance along the line, y: 1 if dashed
+
+        out vec3 vColor;
+        out vec2 vDash;
 
         void main() {
-            vec2 worldPos = aPos * scale + position;
+            vec2 worldPos = aPos * iScale + iPosition;
             gl_Position = projection * vec4(worldPos, 0.0, 1.0);
+            vColor = iColor;
+            vDash = aDash;
         }
     )";
 
     const std::string fragmentShaderSource = R"(
         #version 450 core
-        uniform vec3 color;
+        in vec3 vColor;
+        in vec2 vDash;
         out vec4 FragColor;
 
+        // Dash pattern for reflected rays: 5 units drawn, 5 units gap
+        const float DASH_LENGTH = 5.0;
+        const float GAP_LENGTH = 5.0;
+
         void main() {
-            FragColor = vec4(color, 1.0);
+            if (vDash.y > 0.5 && mod(vDash.x, DASH_LENGTH + GAP_LENGTH) >= DASH_LENGTH) {
+                discard;
+            }
+            FragColor = vec4(vColor, 1.0);
+        }
+    )";
+
+    // Shader storage bindings used by the compute ray caster (see GpuTracer)
+    constexpr unsigned int TRACE_CIRCLES_BINDING = 0;
+    constexpr unsigned int TRACE_VERTICES_BINDING = 1;
+    constexpr unsigned int TRACE_SEGMENTS_BINDING = 2;
+    constexpr unsigned int TRACE_COMMAND_BINDING = 3;
+    constexpr unsigned int TRACE_WORKGROUP_SIZE = 64;
+
+    // Traces one primary ray and its reflection chain per invocation and
+    // appends the segments as RayVertex pairs to the line vertex buffer.
+    // The vertex count is accumulated in a glDrawArraysIndirect command.
+    // Mirrors Tracer::trace; circle 0 is the main object.
+    const std::string traceComputeShaderSource = R"(
+        #version 450 core
+        layout (local_size_x = 64) in;
+
+        struct SegmentRecord {
+            vec2 origin;
+            vec2 end;
+            int ray;
+            int depth;
+            int hitId;
+            float energy;
+            float attenuation;
+            int padding;
+        };
+
+        layout (std430, binding = 0) readonly buffer Circles { vec4 circles[]; };  // x, y, radius, reflectance
+        layout (std430, binding = 1) writeonly buffer Vertices { float vertices[]; };
+        layout (std430, binding = 2) writeonly buffer Segments { SegmentRecord segments[]; };
+        layout (std430, binding = 3) buffer DrawCommand {
+            uint vertexCount;
+            uint instanceCount;
+            uint firstVertex;
+            uint baseInstance;
+        };
+
+        uniform vec2 lightOrigin;
+        uniform int rayCount;
+        uniform int circleCount;
+        uniform bool reflections;
+        uniform int maxReflections;
+        uniform float maxRayLength;
+        uniform float reflectionLengthFactor;
+        uniform vec3 primaryColor;
+        uniform float minEnergy;
+        uniform float rouletteEnergy;
+        uniform float attenuationLength;
+
+        const int RAY_VERTEX_FLOATS = 7;  // position(2), color(3), dash(2)
+
+        bool intersectsCircle(vec2 origin, vec2 direction, float len, vec4 circle, out float t) {
+            vec2 toCircle = circle.xy - origin;
+            float a = dot(direction, direction);
+            float b = -2.0 * dot(toCircle, direction);
+            float c = dot(toCircle, toCircle) - circle.z * circle.z;
+            float discriminant = b * b - 4.0 * a * c;
+            if (discriminant < 0.0) return false;
+            t = (-b - sqrt(discriminant)) / (2.0 * a);
+            return t >= 0.0 && t < len;
+        }
+
+        // Same as Tracer::attenuate
+        float attenuate(float energy, float dist) {
+            return attenuationLength > 0.0 ? energy * exp(-dist / attenuationLength) : energy;
+        }
+
+        // Same as mixBits in tracer.cpp
+        uint mixBits(uint x) {
+            x ^= x >> 16;
+            x *= 0x7feb352du;
+            x ^= x >> 15;
+            x *= 0x846ca68bu;
+            x ^= x >> 16;
+            return x;
+        }
+
+        void writeVertex(uint v, vec2 position, vec3 color, float dist, float dashed) {
+            uint base = v * RAY_VERTEX_FLOATS;
+            vertices[base + 0] = position.x;
+            vertices[base + 1] = position.y;
+            vertices[base + 2] = color.r;
+            vertices[base + 3] = color.g;
+            vertices[base + 4] = color.b;
+            vertices[base + 5] = dist;
+            vertices[base + 6] = dashed;
+        }
+
+        void main() {
+            int rayIndex = int(gl_GlobalInvocationID.x);
+            if (rayIndex >= rayCount) return;
+
+            float angle = 2.0 * 3.14159 * float(rayIndex) / float(rayCount);
+            vec2 origin = lightOrigin;
+            vec2 direction = vec2(cos(angle), sin(angle));
+            float len = maxRayLength;
+            float energy = 1.0;
+
+            for (int depth = 0; depth <= maxReflections; ++depth) {
+                // Cut off where the energy falls below minEnergy
+                if (attenuationLength > 0.0 && minEnergy > 0.0) {
+                    len = min(len, attenuationLength * log(energy / minEnergy));
+                }
+
+                float minDist = len;
+                int hitId = -1;
+                for (int i = 0; i < circleCount; ++i) {
+                    float t;
+                    if (intersectsCircle(origin, direction, len, circles[i], t) && t < minDist) {
+                        minDist = t;
+                        hitId = i;
+                    }
+                }
+
+                vec2 endPoint = origin + direction * minDist;
+                float dashed = depth > 0 ? 1.0 : 0.0;
+                vec3 color = primaryColor * energy;
+                float attenuation = attenuate(1.0, minDist);
+                uint v = atomicAdd(vertexCount, 2u);
+                writeVertex(v, origin, color, 0.0, dashed);
+                writeVertex(v + 1u, endPoint, color * attenuation, minDist * length(direction), dashed);
+                segments[v / 2u] = SegmentRecord(origin, endPoint, rayIndex, depth, hitId, energy, attenuation, 0);
+
+                if (hitId < 0 || !reflections || depth >= maxReflections) break;
+
+                // Energy floor and Russian roulette as in keepSpawnedRay;
+                // a mirror chain is always branch 0
+                energy = attenuate(energy, minDist) * circles[hitId].w;
+                if (energy < minEnergy) break;
+                if (energy < rouletteEnergy) {
+                    uint hash = mixBits(mixBits(mixBits(mixBits(uint(rayIndex)) ^ uint(depth + 1))));
+                    float roll = float(hash >> 8) * (1.0 / 16777216.0);
+                    if (roll * rouletteEnergy >= energy) break;
+                    energy = rouletteEnergy;
+                }
+
+                vec2 normal = normalize(endPoint - circles[hitId].xy);
+                direction = direction - 2.0 * dot(direction, normal) * normal;
+                origin = endPoint;
+                len = maxRayLength * reflectionLengthFactor * pow(0.7, float(depth));
+            }
         }
     )";
 }
\ No newline at end of file
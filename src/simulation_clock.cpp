@@ -0,0 +1,20 @@
+#include "simulation_clock.hpp"
+#include "platform.hpp"
+#include <algorithm>
+
+double SystemClock::frameTime() {
+    return Platform::monotonicSeconds();
+}
+
+int FixedTimestep::advance(double elapsed) {
+    m_accumulator += std::max(elapsed, 0.0);
+    int steps = static_cast<int>(m_accumulator / m_step);
+    if (steps > MAX_STEPS_PER_FRAME) {
+        steps = MAX_STEPS_PER_FRAME;
+        m_accumulator = 0.0;
+    } else {
+        m_accumulator -= steps * m_step;
+    }
+    m_stepCount += static_cast<uint64_t>(steps);
+    return steps;
+}
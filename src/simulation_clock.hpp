@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+// Time source for the simulation, sampled once per frame. The renderer
+// uses SystemClock by default; FixedFrameClock makes runs reproducible.
+class SimulationClock {
+public:
+    virtual ~SimulationClock() = default;
+    
+    // Seconds since an arbitrary origin for the frame that is starting
+    virtual double frameTime() = 0;
+};
+
+// Monotonic wall-clock time
+class SystemClock : public SimulationClock {
+public:
+    double frameTime() override;
+};
+
+// Advances by a fixed interval per frame regardless of real time
+class FixedFrameClock : public SimulationClock {
+public:
+    explicit FixedFrameClock(double frameInterval) : m_frameInterval(frameInterval) {}
+    
+    double frameTime() override {
+        double time = m_time;
+        m_time += m_frameInterval;
+        return time;
+    }
+
+private:
+    double m_frameInterval;
+    double m_time = 0.0;
+};
+
+// Fixed-timestep accumulator. Each frame adds the elapsed clock time and
+// runs as many whole steps as have accumulated; the remainder is carried
+// over and exposed as an interpolation factor for rendering.
+class FixedTimestep {
+public:
+    static constexpr double DEFAULT_STEP = 1.0 / 120.0;
+    // Frames slower than this many steps drop the excess instead of
+    // running ever more steps to catch up
+    static constexpr int MAX_STEPS_PER_FRAME = 8;
+    
+    explicit FixedTimestep(double step = DEFAULT_STEP) : m_step(step) {}
+    
+    // Returns the number of simulation steps to run for this frame
+    int advance(double elapsed);
+    
+    double getStep() const { return m_step; }
+    // Fraction of a step between the last simulated state and now, in [0, 1)
+    double getAlpha() const { return m_accumulator / m_step; }
+    uint64_t getStepCount() const { return m_stepCount; }
+    double getSimulationTime() const { return m_stepCount * m_step; }
+
+private:
+    double m_step;
+    double m_accumulator = 0.0;
+    uint64_t m_stepCount = 0;
+};
@@ -0,0 +1,87 @@
+#include "software_raster.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+// Matches DASH_LENGTH / GAP_LENGTH in Shaders::fragmentShaderSource
+static constexpr float DASH_LENGTH = 5.0f;
+static constexpr float GAP_LENGTH = 5.0f;
+
+RasterImage::RasterImage(int width, int height, const glm::vec3& clearColor)
+    : m_width(std::max(width, 1)), m_height(std::max(height, 1)) {
+    m_pixels.resize(static_cast<size_t>(m_width) * m_height * 3);
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            setPixel(x, y, clearColor);
+        }
+    }
+}
+
+glm::vec2 RasterImage::toPixel(const glm::vec2& world) const {
+    return glm::vec2(world.x + m_width / 2.0f, m_height / 2.0f - world.y);
+}
+
+void RasterImage::setPixel(int x, int y, const glm::vec3& color) {
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) return;
+    size_t index = (static_cast<size_t>(y) * m_width + x) * 3;
+    glm::vec3 c = glm::clamp(color, 0.0f, 1.0f);
+    m_pixels[index + 0] = static_cast<uint8_t>(c.r * 255.0f + 0.5f);
+    m_pixels[index + 1] = static_cast<uint8_t>(c.g * 255.0f + 0.5f);
+    m_pixels[index + 2] = static_cast<uint8_t>(c.b * 255.0f + 0.5f);
+}
+
+void RasterImage::fillCircle(const glm::vec2& center, float radius, const glm::vec3& color) {
+    glm::vec2 c = toPixel(center);
+    int minX = std::max(0, static_cast<int>(std::floor(c.x - radius)));
+    int maxX = std::min(m_width - 1, static_cast<int>(std::ceil(c.x + radius)));
+    int minY = std::max(0, static_cast<int>(std::floor(c.y - radius)));
+    int maxY = std::min(m_height - 1, static_cast<int>(std::ceil(c.y + radius)));
+    
+    float radiusSq = radius * radius;
+    for (int y = minY; y <= maxY; ++y) {
+        float dy = (y + 0.5f) - c.y;
+        for (int x = minX; x <= maxX; ++x) {
+            float dx = (x + 0.5f) - c.x;
+            if (dx * dx + dy * dy <= radiusSq) {
+                setPixel(x, y, color);
+            }
+        }
+    }
+}
+
+void RasterImage::drawLine(const glm::vec2& from, const glm::vec2& to, const glm::vec3& fromColor,
+                           const glm::vec3& toColor, bool dashed) {
+    glm::vec2 a = toPixel(from);
+    glm::vec2 b = toPixel(to);
+    glm::vec2 delta = b - a;
+    
+    // One sample per pixel along the major axis
+    int steps = static_cast<int>(std::ceil(std::max(std::abs(delta.x), std::abs(delta.y))));
+    if (steps == 0) {
+        setPixel(static_cast<int>(a.x), static_cast<int>(a.y), fromColor);
+        return;
+    }
+    
+    float length = glm::length(delta);
+    for (int i = 0; i <= steps; ++i) {
+        float t = static_cast<float>(i) / steps;
+        if (dashed && std::fmod(t * length, DASH_LENGTH + GAP_LENGTH) >= DASH_LENGTH) {
+            continue;
+        }
+        glm::vec2 p = a + delta * t;
+        setPixel(static_cast<int>(std::floor(p.x)), static_cast<int>(std::floor(p.y)), glm::mix(fromColor, toColor, t));
+    }
+}
+
+void RasterImage::writePPM(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open image for writing: " + path);
+    }
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(m_pixels.data()), static_cast<std::streamsize>(m_pixels.size()));
+    if (!file) {
+        throw std::runtime_error("Failed to write image: " + path);
+    }
+}
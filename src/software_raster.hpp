@@ -0,0 +1,36 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Minimal CPU rasterizer for headless output. Uses the same world space as
+// the window: origin at the center of the image, y pointing up.
+class RasterImage {
+public:
+    RasterImage(int width, int height, const glm::vec3& clearColor = glm::vec3(0.0f));
+    
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    
+    void fillCircle(const glm::vec2& center, float radius, const glm::vec3& color);
+    
+    // Dashed lines use the same 5 on / 5 off pattern as the fragment shader
+    void drawLine(const glm::vec2& from, const glm::vec2& to, const glm::vec3& color, bool dashed = false) {
+        drawLine(from, to, color, color, dashed);
+    }
+    // Color interpolated from fromColor to toColor along the line
+    void drawLine(const glm::vec2& from, const glm::vec2& to, const glm::vec3& fromColor, const glm::vec3& toColor,
+                  bool dashed);
+    
+    // Writes a binary PPM (P6). Throws std::runtime_error on I/O failure.
+    void writePPM(const std::string& path) const;
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<uint8_t> m_pixels;  // RGB, top row first
+    
+    glm::vec2 toPixel(const glm::vec2& world) const;
+    void setPixel(int x, int y, const glm::vec3& color);
+};
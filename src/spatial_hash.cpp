@@ -0,0 +1,321 @@
+#include "spatial_hash.hpp"
+#include <algorithm>
+
+void SpatialHash::build(const CircleView& circles, float cellSize) {
+    m_maxRadius = 0.0f;
+    for (std::size_t i = 0; i < circles.count; ++i) {
+        m_maxRadius = std::max(m_maxRadius, circles.radius[i]);
+    }
+    m_cellSize = cellSize > 0.0f ? cellSize : std::max(MIN_CELL_SIZE, 2.0f * m_maxRadius);
+    m_inverseCellSize = 1.0f / m_cellSize;
+    
+    // Power-of-two bucket count of at least the circle count keeps buckets short
+    uint32_t bucketCount = 1;
+    while (bucketCount < circles.count) {
+        bucketCount <<= 1;
+    }
+    m_bucketMask = bucketCount - 1;
+    
+    // Counting sort of the circles by bucket
+    std::vector<uint32_t> buckets(circles.count);
+    m_bucketStart.assign(bucketCount + 1, 0);
+    for (std::size_t i = 0; i < circles.count; ++i) {
+        buckets[i] = bucketOf(cellCoordinate(circles.x[i]), cellCoordinate(circles.y[i]));
+        ++m_bucketStart[buckets[i] + 1];
+    }
+    for (uint32_t bucket = 0; bucket < bucketCount; ++bucket) {
+        m_bucketStart[bucket + 1] += m_bucketStart[bucket];
+    }
+    m_entries.resize(circles.count);
+    std::vector<uint32_t> fill(m_bucketStart.begin(), m_bucketStart.end() - 1);
+    for (std::size_t i = 0; i < circles.count; ++i) {
+        m_entries[fill[buckets[i]]++] = static_cast<uint32_t>(i);
+    }
+}
+
+namespace Collision {
+
+bool sweepCircle(const glm::vec2& from, const glm::vec2& delta, const glm::vec2& center, float radiusSum,
+                 float& t) {
+    glm::vec2 offset = from - center;
+    float a = glm::dot(delta, delta);
+    float b = 2.0f * glm::dot(offset, delta);
+    float c = glm::dot(offset, offset) - radiusSum * radiusSum;
+    
+    // Moving apart (or not at all) never makes a new contact
+    if (b >= 0.0f || a == 0.0f) return false;
+    if (c <= 0.0f) {
+        t = 0.0f;
+        return true;
+    }
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f) return false;
+    float hit = (-b - std::sqrt(discriminant)) / (2.0f * a);
+    if (hit > 1.0f) return false;
+    t = std::max(hit, 0.0f);
+    return true;
+}
+
+namespace {
+
+// Roots of |offset + delta t| = radius, smaller first
+bool solveCrossings(const glm::vec2& offset, const glm::vec2& delta, float radius, float& t0, float& t1) {
+    float a = glm::dot(delta, delta);
+    float b = 2.0f * glm::dot(offset, delta);
+    float c = glm::dot(offset, offset) - radius * radius;
+    float discriminant = b * b - 4.0f * a * c;
+    if (a == 0.0f || discriminant < 0.0f) return false;
+    float root = std::sqrt(discriminant);
+    t0 = (-b - root) / (2.0f * a);
+    t1 = (-b + root) / (2.0f * a);
+    return true;
+}
+
+// Shared start of the wall sweeps: a circle that already touches the wall
+// at nearest hits at t = 0 only if it is moving further in
+bool startsInContact(const glm::vec2& from, const glm::vec2& delta, const glm::vec2& nearest, float radius,
+                     bool& hit) {
+    glm::vec2 away = from - nearest;
+    if (glm::dot(away, away) > radius * radius) return false;
+    hit = glm::dot(delta, away) < 0.0f;
+    return true;
+}
+
+// Keeps the earliest of the contacts found so far
+void keepEarliest(float candidateT, const glm::vec2& candidateContact, bool& hit, float& t, glm::vec2& contact) {
+    if (!hit || candidateT < t) {
+        t = candidateT;
+        contact = candidateContact;
+        hit = true;
+    }
+}
+
+}
+
+bool sweepSegment(const glm::vec2& from, const glm::vec2& delta, const glm::vec2& a, const glm::vec2& b,
+                  float radius, float& t, glm::vec2& contact) {
+    glm::vec2 edge = b - a;
+    float edgeLength2 = glm::dot(edge, edge);
+    auto nearestTo = [&](const glm::vec2& point) {
+        float u = edgeLength2 > 0.0f ? glm::clamp(glm::dot(point - a, edge) / edgeLength2, 0.0f, 1.0f) : 0.0f;
+        return a + edge * u;
+    };
+    
+    bool hit = false;
+    glm::vec2 nearest = nearestTo(from);
+    if (startsInContact(from, delta, nearest, radius, hit)) {
+        t = 0.0f;
+        contact = nearest;
+        return hit;
+    }
+    
+    // Flat side, facing the start
+    if (edgeLength2 > 0.0f) {
+        glm::vec2 normal = glm::vec2(-edge.y, edge.x) / std::sqrt(edgeLength2);
+        float side = glm::dot(from - a, normal);
+        if (side < 0.0f) {
+            normal = -normal;
+            side = -side;
+        }
+        float approach = -glm::dot(delta, normal);
+        if (side > radius && approach > 0.0f && side - radius <= approach) {
+            float sideT = (side - radius) / approach;
+            float u = glm::dot(from + delta * sideT - a, edge) / edgeLength2;
+            if (u >= 0.0f && u <= 1.0f) {
+                keepEarliest(sideT, a + edge * u, hit, t, contact);
+            }
+        }
+    }
+    
+    // Rounded ends
+    for (const glm::vec2& end : {a, b}) {
+        float endT;
+        if (sweepCircle(from, delta, end, radius, endT)) {
+            keepEarliest(endT, end, hit, t, contact);
+        }
+    }
+    return hit;
+}
+
+bool sweepArc(const glm::vec2& from, const glm::vec2& delta, const ArcView& arcs, std::size_t i, float radius,
+              float& t, glm::vec2& contact) {
+    glm::vec2 center(arcs.x[i], arcs.y[i]);
+    float arcRadius = arcs.radius[i];
+    glm::vec2 middle(arcs.middleX[i], arcs.middleY[i]);
+    float cosHalfSpan = arcs.cosHalfSpan[i];
+    float sinHalfSpan = std::sqrt(std::max(0.0f, 1.0f - cosHalfSpan * cosHalfSpan));
+    glm::vec2 ends[2] = {
+        center + arcRadius * glm::vec2(middle.x * cosHalfSpan + middle.y * sinHalfSpan,
+                                       middle.y * cosHalfSpan - middle.x * sinHalfSpan),
+        center + arcRadius * glm::vec2(middle.x * cosHalfSpan - middle.y * sinHalfSpan,
+                                       middle.y * cosHalfSpan + middle.x * sinHalfSpan)};
+    // Point of the circle in the direction of point, if the arc covers it
+    auto onArc = [&](const glm::vec2& point, glm::vec2& onCircle) {
+        glm::vec2 offset = point - center;
+        float length = glm::length(offset);
+        if (length == 0.0f) return false;
+        onCircle = center + offset * (arcRadius / length);
+        return glm::dot(onCircle - center, middle) >= cosHalfSpan * arcRadius;
+    };
+    
+    bool hit = false;
+    glm::vec2 nearest;
+    bool facingArc = onArc(from, nearest);
+    if (!facingArc) {
+        nearest = glm::dot(from - ends[0], from - ends[0]) <= glm::dot(from - ends[1], from - ends[1]) ? ends[0] : ends[1];
+    }
+    // The inner face curves towards a circle resting against it, so there
+    // any move that is not inwards presses into the arc. The skin covers a
+    // circle left just short of the face by the previous slide.
+    glm::vec2 offset = from - center;
+    float reach = radius + CONTACT_SKIN;
+    bool againstInside = facingArc && glm::dot(offset, offset) < arcRadius * arcRadius &&
+                         glm::dot(from - nearest, from - nearest) <= reach * reach;
+    if (againstInside && glm::dot(delta, offset) >= 0.0f) {
+        t = 0.0f;
+        contact = nearest;
+        return true;
+    }
+    if (!againstInside && startsInContact(from, delta, nearest, radius, hit)) {
+        t = 0.0f;
+        contact = nearest;
+        return hit;
+    }
+    
+    // Outer face, entering the circle grown by radius; inner face, leaving
+    // the circle shrunk by it
+    float t0;
+    float t1;
+    glm::vec2 onCircle;
+    if (solveCrossings(offset, delta, arcRadius + radius, t0, t1) && t0 >= 0.0f && t0 <= 1.0f &&
+        onArc(from + delta * t0, onCircle)) {
+        keepEarliest(t0, onCircle, hit, t, contact);
+    }
+    if (arcRadius > radius && solveCrossings(offset, delta, arcRadius - radius, t0, t1) &&
+        (t1 >= 0.0f || againstInside) && t1 <= 1.0f && onArc(from + delta * t1, onCircle)) {
+        keepEarliest(std::max(t1, 0.0f), onCircle, hit, t, contact);
+    }
+    
+    for (const glm::vec2& end : ends) {
+        float endT;
+        if (sweepCircle(from, delta, end, radius, endT)) {
+            keepEarliest(endT, end, hit, t, contact);
+        }
+    }
+    return hit;
+}
+
+bool sweepWalls(const OccluderView& walls, const glm::vec2& from, const glm::vec2& delta, float radius, float& t,
+                glm::vec2& contact) {
+    bool hit = false;
+    // Walls are few, so they are culled by the bounds of the move alone
+    glm::vec2 moveMin = glm::min(from, from + delta) - glm::vec2(radius);
+    glm::vec2 moveMax = glm::max(from, from + delta) + glm::vec2(radius);
+    auto overlapsMove = [&](const glm::vec2& boundsMin, const glm::vec2& boundsMax) {
+        return boundsMin.x <= moveMax.x && boundsMax.x >= moveMin.x && boundsMin.y <= moveMax.y &&
+               boundsMax.y >= moveMin.y;
+    };
+    float wallT;
+    glm::vec2 wallContact;
+    for (const SegmentView* segments : {&walls.segments, &walls.polygonEdges}) {
+        for (std::size_t i = 0; i < segments->count; ++i) {
+            glm::vec2 a(segments->x0[i], segments->y0[i]);
+            glm::vec2 b(segments->x1[i], segments->y1[i]);
+            if (overlapsMove(glm::min(a, b), glm::max(a, b)) &&
+                sweepSegment(from, delta, a, b, radius, wallT, wallContact)) {
+                keepEarliest(wallT, wallContact, hit, t, contact);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < walls.arcs.count; ++i) {
+        glm::vec2 center(walls.arcs.x[i], walls.arcs.y[i]);
+        glm::vec2 extent(walls.arcs.radius[i]);
+        if (overlapsMove(center - extent, center + extent) &&
+            sweepArc(from, delta, walls.arcs, i, radius, wallT, wallContact)) {
+            keepEarliest(wallT, wallContact, hit, t, contact);
+        }
+    }
+    return hit;
+}
+
+namespace {
+
+// First contact along one straight move; hitPoint is the center of the
+// circle that was hit, or the touched point of a wall, so the contact
+// normal points from it to the moving circle either way
+bool firstContact(const SpatialHash& hash, const CircleView& obstacles, const CircleView& others,
+                  const OccluderView& walls, const glm::vec2& from, const glm::vec2& delta, float radius,
+                  float& bestT, glm::vec2& hitPoint) {
+    bool hit = false;
+    bestT = 1.0f;
+    auto test = [&](const CircleView& circles, uint32_t i) {
+        glm::vec2 center(circles.x[i], circles.y[i]);
+        float t;
+        if (sweepCircle(from, delta, center, radius + circles.radius[i], t)) {
+            keepEarliest(t, center, hit, bestT, hitPoint);
+        }
+    };
+    
+    for (std::size_t i = 0; i < others.count; ++i) {
+        test(others, static_cast<uint32_t>(i));
+    }
+    
+    float wallT;
+    glm::vec2 wallContact;
+    if (sweepWalls(walls, from, delta, radius, wallT, wallContact)) {
+        keepEarliest(wallT, wallContact, hit, bestT, hitPoint);
+    }
+    
+    // Walk the move in chunks of a few cells, so a long drag only visits the
+    // cells around its path. Once a contact lies within the chunks already
+    // searched, no later chunk can hold an earlier one.
+    float length = glm::length(delta);
+    int chunks = std::max(1, static_cast<int>(std::ceil(length / (4.0f * hash.getCellSize()))));
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        float t0 = static_cast<float>(chunk) / chunks;
+        float t1 = static_cast<float>(chunk + 1) / chunks;
+        if (hit && bestT <= t0) break;
+        glm::vec2 start = from + delta * t0;
+        glm::vec2 end = from + delta * t1;
+        hash.query(glm::min(start, end) - glm::vec2(radius), glm::max(start, end) + glm::vec2(radius), [&](uint32_t i) {
+            test(obstacles, i);
+        });
+    }
+    return hit;
+}
+
+}
+
+glm::vec2 slideCircle(const SpatialHash& hash, const CircleView& obstacles, const CircleView& others,
+                      const OccluderView& walls, const glm::vec2& from, const glm::vec2& to, float radius,
+                      int maxSlides) {
+    glm::vec2 position = from;
+    glm::vec2 delta = to - from;
+    for (int slide = 0; slide <= maxSlides; ++slide) {
+        float length = glm::length(delta);
+        if (length < 1e-4f) break;
+        
+        float t;
+        glm::vec2 hitPoint;
+        if (!firstContact(hash, obstacles, others, walls, position, delta, radius, t, hitPoint)) {
+            return position + delta;
+        }
+        
+        // Stop just short of the contact, then keep only the tangential part
+        // of the remaining motion
+        float travel = std::max(0.0f, t * length - CONTACT_SKIN);
+        position += delta * (travel / length);
+        delta *= 1.0f - travel / length;
+        glm::vec2 normal = position - hitPoint;
+        float normalLength = glm::length(normal);
+        if (normalLength > 0.0f) {
+            normal /= normalLength;
+            delta -= normal * std::min(0.0f, glm::dot(delta, normal));
+        } else {
+            break;
+        }
+    }
+    return position;
+}
+
+} // namespace Collision
@@ -0,0 +1,98 @@
+#pragma once
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Broadphase for circles: a uniform grid whose cells are hashed into a
+// bucket table sized to the circle count, so memory does not depend on
+// the extent of the scene. Each circle is stored once, in the cell of its
+// center; queries grow their bounds by the largest radius to compensate.
+class SpatialHash {
+public:
+    static constexpr float MIN_CELL_SIZE = 8.0f;
+    
+    // Rebuilds from circles; only indices are kept. A cellSize of 0 picks
+    // twice the largest radius (at least MIN_CELL_SIZE).
+    void build(const CircleView& circles, float cellSize = 0.0f);
+    
+    bool empty() const { return m_entries.empty(); }
+    float getCellSize() const { return m_cellSize; }
+    float getMaxRadius() const { return m_maxRadius; }
+    
+    // Calls visit(index) for every circle that may overlap the box.
+    // Cells sharing a bucket can report a circle more than once.
+    template <class Visit>
+    void query(const glm::vec2& boundsMin, const glm::vec2& boundsMax, Visit&& visit) const {
+        if (m_entries.empty()) return;
+        int x0 = cellCoordinate(boundsMin.x - m_maxRadius);
+        int x1 = cellCoordinate(boundsMax.x + m_maxRadius);
+        int y0 = cellCoordinate(boundsMin.y - m_maxRadius);
+        int y1 = cellCoordinate(boundsMax.y + m_maxRadius);
+        // Past the bucket count a scan of the whole table is cheaper
+        if (static_cast<double>(x1 - x0 + 1) * (y1 - y0 + 1) > m_bucketStart.size()) {
+            for (uint32_t index : m_entries) {
+                visit(index);
+            }
+            return;
+        }
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                uint32_t bucket = bucketOf(x, y);
+                for (uint32_t i = m_bucketStart[bucket]; i < m_bucketStart[bucket + 1]; ++i) {
+                    visit(m_entries[i]);
+                }
+            }
+        }
+    }
+
+private:
+    float m_cellSize = MIN_CELL_SIZE;
+    float m_inverseCellSize = 1.0f / MIN_CELL_SIZE;
+    float m_maxRadius = 0.0f;
+    uint32_t m_bucketMask = 0;
+    std::vector<uint32_t> m_bucketStart;  // Bucket count + 1 offsets into m_entries
+    std::vector<uint32_t> m_entries;      // Circle indices grouped by bucket
+    
+    int cellCoordinate(float value) const { return static_cast<int>(std::floor(value * m_inverseCellSize)); }
+    uint32_t bucketOf(int x, int y) const {
+        return (static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u) & m_bucketMask;
+    }
+};
+
+namespace Collision {
+    // Slides per move: each contact removes the motion into the surface and
+    // continues with the rest along the tangent
+    constexpr int MAX_SLIDES = 3;
+    // Gap left at a contact so the next sweep does not start overlapping
+    constexpr float CONTACT_SKIN = 0.01f;
+    
+    // Earliest t in [0, 1] at which a circle moving from `from` by `delta`
+    // comes within radiusSum of center. A circle that already overlaps hits
+    // at t = 0 only if it is moving further in, so it can always escape.
+    bool sweepCircle(const glm::vec2& from, const glm::vec2& delta, const glm::vec2& center, float radiusSum,
+                     float& t);
+    
+    // As sweepCircle, against the segment from a to b; contact is the point
+    // of the segment that is touched
+    bool sweepSegment(const glm::vec2& from, const glm::vec2& delta, const glm::vec2& a, const glm::vec2& b,
+                      float radius, float& t, glm::vec2& contact);
+    
+    // As sweepSegment, against arc i of arcs, from either side
+    bool sweepArc(const glm::vec2& from, const glm::vec2& delta, const ArcView& arcs, std::size_t i, float radius,
+                  float& t, glm::vec2& contact);
+    
+    // Earliest sweepSegment or sweepArc contact with any of the walls
+    bool sweepWalls(const OccluderView& walls, const glm::vec2& from, const glm::vec2& delta, float radius, float& t,
+                    glm::vec2& contact);
+    
+    // Moves a circle of the given radius from `from` towards `to`, stopping
+    // at the first contact with an obstacle (found through hash), one of the
+    // others or a wall (both tested directly) and sliding along it up to
+    // maxSlides times. Returns where the circle ends up.
+    glm::vec2 slideCircle(const SpatialHash& hash, const CircleView& obstacles, const CircleView& others,
+                          const OccluderView& walls, const glm::vec2& from, const glm::vec2& to, float radius,
+                          int maxSlides = MAX_SLIDES);
+}
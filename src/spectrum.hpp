@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Relative power of a ray in BINS wavelength bins, spread evenly
+// over 400-700 nm. The bins are kept at a mean of 1; a ray's energy scales
+// the whole spectrum. Rays only carry a spectrum in dispersion mode (see
+// TraceSettings::dispersion), where the bins are traced together as the
+// lanes of one ray until their paths diverge.
+struct Spectrum {
+    static constexpr int BINS = 8;
+    
+    alignas(16) float bin[BINS] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+    
+    // Center wavelength of bin k in micrometres
+    static float wavelength(int k) { return 0.4f + 0.3f * (static_cast<float>(k) + 0.5f) / BINS; }
+    
+    // Index of refraction in bin k by Cauchy's equation, through baseIor at
+    // the sodium D line (589.3 nm) with dispersion as the B coefficient in
+    // square micrometres
+    static float ior(float baseIor, float dispersion, int k) {
+        const float SODIUM_D = 0.5893f;
+        float lambda = wavelength(k);
+        return baseIor + dispersion * (1.0f / (lambda * lambda) - 1.0f / (SODIUM_D * SODIUM_D));
+    }
+    
+    float mean() const {
+        float sum = 0.0f;
+        for (int k = 0; k < BINS; ++k) {
+            sum += bin[k];
+        }
+        return sum / BINS;
+    }
+    
+    // Color of the spectrum relative to white light: a flat spectrum gives
+    // (1, 1, 1)
+    glm::vec3 tint() const {
+        // Approximate sRGB color of each bin, violet to deep red
+        static const glm::vec3 BIN_COLORS[BINS] = {
+            {0.45f, 0.0f, 0.75f}, {0.1f, 0.2f, 1.0f}, {0.0f, 0.75f, 0.85f}, {0.2f, 1.0f, 0.2f},
+            {0.75f, 1.0f, 0.0f}, {1.0f, 0.55f, 0.0f}, {1.0f, 0.15f, 0.0f}, {0.7f, 0.0f, 0.0f}};
+        static const glm::vec3 WHITE = [] {
+            glm::vec3 sum(0.0f);
+            for (const glm::vec3& color : BIN_COLORS) {
+                sum += color;
+            }
+            return sum;
+        }();
+        
+        glm::vec3 color(0.0f);
+        for (int k = 0; k < BINS; ++k) {
+            color += bin[k] * BIN_COLORS[k];
+        }
+        return color / WHITE;
+    }
+};
@@ -0,0 +1,141 @@
+// Reads a recorded trace stream (.rttrace) through a memory mapping and
+// prints statistics, or dumps the segments of selected frames as CSV.
+//
+// Usage: RayTracerNG_TraceDump <file.rttrace> [--frames] [--csv <first-frame> [<last-frame>]]
+//   (default)  summary: frame count, segments per depth, hit breakdown
+//   --frames   one line per frame: frame, time, segments, main/obstacle hits
+//   --csv      frame,ray,depth,hit_id,origin_x,origin_y,end_x,end_y,r,g,b
+#include "trace_file.hpp"
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: RayTracerNG_TraceDump <file.rttrace> [--frames] [--csv <first-frame> [<last-frame>]]" << std::endl;
+}
+
+struct Summary {
+    uint64_t frames = 0;
+    uint64_t segments = 0;
+    uint64_t mainHits = 0;
+    uint64_t obstacleHits = 0;
+    uint64_t misses = 0;
+    uint32_t maxSegmentsPerFrame = 0;
+    double totalLength = 0.0;
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+    std::vector<uint64_t> segmentsPerDepth;
+};
+
+void printSummary(TraceFileReader& reader) {
+    Summary summary;
+    reader.forEachFrame([&](const TraceFileReader::Frame& frame) {
+        if (summary.frames == 0) summary.firstTime = frame.header.time;
+        summary.lastTime = frame.header.time;
+        ++summary.frames;
+        summary.segments += frame.header.segmentCount;
+        summary.maxSegmentsPerFrame = std::max(summary.maxSegmentsPerFrame, frame.header.segmentCount);
+        for (uint32_t i = 0; i < frame.header.segmentCount; ++i) {
+            const TraceFile::SegmentRecord& s = frame.segments[i];
+            if (s.depth >= summary.segmentsPerDepth.size()) {
+                summary.segmentsPerDepth.resize(s.depth + 1);
+            }
+            ++summary.segmentsPerDepth[s.depth];
+            if (s.hitId == TRACE_NO_HIT) {
+                ++summary.misses;
+            } else if (s.hitId == TRACE_MAIN_OBJECT) {
+                ++summary.mainHits;
+            } else {
+                ++summary.obstacleHits;
+            }
+            summary.totalLength += std::hypot(s.end[0] - s.origin[0], s.end[1] - s.origin[1]);
+        }
+    });
+    
+    std::cout << "File size:        " << reader.getFileSize() << " bytes\n";
+    std::cout << "Frames:           " << summary.frames;
+    if (summary.frames > 1) {
+        std::cout << " over " << (summary.lastTime - summary.firstTime) << " s";
+    }
+    std::cout << "\n";
+    std::cout << "Segments:         " << summary.segments << " (max " << summary.maxSegmentsPerFrame << " per frame)\n";
+    for (size_t depth = 0; depth < summary.segmentsPerDepth.size(); ++depth) {
+        std::cout << "  depth " << depth << ":        " << summary.segmentsPerDepth[depth] << "\n";
+    }
+    std::cout << "Main object hits: " << summary.mainHits << "\n";
+    std::cout << "Obstacle/wall:    " << summary.obstacleHits << "\n";
+    std::cout << "Misses:           " << summary.misses << "\n";
+    if (summary.segments > 0) {
+        std::cout << "Mean length:      " << summary.totalLength / summary.segments << "\n";
+    }
+}
+
+void printFrames(TraceFileReader& reader) {
+    std::cout << "frame,time,segments,main_hits,obstacle_hits\n";
+    reader.forEachFrame([](const TraceFileReader::Frame& frame) {
+        uint64_t mainHits = 0;
+        uint64_t obstacleHits = 0;
+        for (uint32_t i = 0; i < frame.header.segmentCount; ++i) {
+            int32_t hitId = frame.segments[i].hitId;
+            if (hitId == TRACE_MAIN_OBJECT) ++mainHits;
+            else if (hitId > TRACE_MAIN_OBJECT) ++obstacleHits;
+        }
+        std::cout << frame.header.frame << "," << frame.header.time << "," << frame.header.segmentCount << ","
+                  << mainHits << "," << obstacleHits << "\n";
+    });
+}
+
+void printCsv(TraceFileReader& reader, uint64_t firstFrame, uint64_t lastFrame) {
+    std::cout << "frame,ray,depth,hit_id,origin_x,origin_y,end_x,end_y,r,g,b\n";
+    std::cout << std::setprecision(9);
+    reader.forEachFrame([&](const TraceFileReader::Frame& frame) {
+        if (frame.header.frame < firstFrame || frame.header.frame > lastFrame) return;
+        for (uint32_t i = 0; i < frame.header.segmentCount; ++i) {
+            const TraceFile::SegmentRecord& s = frame.segments[i];
+            std::cout << frame.header.frame << "," << s.ray << "," << int(s.depth) << "," << s.hitId << ","
+                      << s.origin[0] << "," << s.origin[1] << "," << s.end[0] << "," << s.end[1] << ","
+                      << int(s.color[0]) << "," << int(s.color[1]) << "," << int(s.color[2]) << "\n";
+        }
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    
+    try {
+        TraceFileReader reader(argv[1]);
+        std::string mode = argc > 2 ? argv[2] : "";
+        if (mode.empty()) {
+            printSummary(reader);
+        } else if (mode == "--frames") {
+            printFrames(reader);
+        } else if (mode == "--csv" && argc > 3) {
+            uint64_t first = std::stoull(argv[3]);
+            uint64_t last = argc > 4 ? std::stoull(argv[4]) : first;
+            printCsv(reader, first, last);
+        } else {
+            printUsage();
+            return 2;
+        }
+        
+        if (reader.isTruncated()) {
+            std::cerr << "Warning: trace ends with an incomplete frame (recording was interrupted)" << std::endl;
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,36 @@
+#include "trace_file.hpp"
+#include <stdexcept>
+#include <algorithm>
+
+namespace TraceFile {
+
+SegmentRecord packSegment(const TraceSegment& segment) {
+    SegmentRecord record;
+    record.origin[0] = segment.origin.x;
+    record.origin[1] = segment.origin.y;
+    record.end[0] = segment.end.x;
+    record.end[1] = segment.end.y;
+    record.ray = segment.ray;
+    record.hitId = segment.hitId;
+    for (int i = 0; i < 3; ++i) {
+        record.color[i] = static_cast<uint8_t>(std::clamp(segment.color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    record.depth = static_cast<uint8_t>(std::clamp(segment.depth, 0, 255));
+    return record;
+}
+
+} // namespace TraceFile
+
+TraceFileReader::TraceFileReader(const std::string& path) : m_file(path) {
+    TraceFile::FileHeader header;
+    if (m_file.size() < sizeof(header)) {
+        throw std::runtime_error("Not a RayTracerNG trace file: " + path);
+    }
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (std::memcmp(header.magic, TraceFile::MAGIC, sizeof(TraceFile::MAGIC)) != 0) {
+        throw std::runtime_error("Not a RayTracerNG trace file: " + path);
+    }
+    if (header.version != TraceFile::VERSION || header.recordSize != sizeof(TraceFile::SegmentRecord)) {
+        throw std::runtime_error("Unsupported trace file version " + std::to_string(header.version) + ": " + path);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "tracer.hpp"
+#include "mapped_file.hpp"
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+// Recorded trace stream (.rttrace)
+//
+// Layout, little-endian:
+//   FileHeader
+//   repeated per frame:
+//     FrameHeader
+//     SegmentRecord[segmentCount]
+// Every structure size is a multiple of 4, so segment records are float
+// aligned in a mapping. Frame headers are read with memcpy.
+namespace TraceFile {
+    constexpr char MAGIC[8] = {'R', 'T', 'N', 'G', 'T', 'R', 'C', '\0'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t FRAME_MARKER = 0x454D5246;  // "FRME"
+    
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;  // sizeof(SegmentRecord)
+    };
+    static_assert(sizeof(FileHeader) == 16, "FileHeader layout is part of the file format");
+    
+    struct FrameHeader {
+        uint32_t marker;
+        uint32_t segmentCount;
+        uint64_t frame;
+        double time;  // Seconds since the recording started
+    };
+    static_assert(sizeof(FrameHeader) == 24, "FrameHeader layout is part of the file format");
+    
+    struct SegmentRecord {
+        float origin[2];
+        float end[2];
+        int32_t ray;
+        int32_t hitId;     // TRACE_NO_HIT, TRACE_MAIN_OBJECT or obstacle index + 1
+        uint8_t color[3];  // 8-bit RGB
+        uint8_t depth;     // 0 for primary rays
+    };
+    static_assert(sizeof(SegmentRecord) == 28, "SegmentRecord layout is part of the file format");
+    
+    SegmentRecord packSegment(const TraceSegment& segment);
+}
+
+// Memory-mapped view of a recorded trace stream
+class TraceFileReader {
+public:
+    // Throws std::runtime_error if the file cannot be mapped or has a bad header
+    explicit TraceFileReader(const std::string& path);
+    
+    struct Frame {
+        TraceFile::FrameHeader header;
+        const TraceFile::SegmentRecord* segments;  // Points into the mapping
+    };
+    
+    // Calls onFrame(const Frame&) for each complete frame in file order.
+    // A frame cut short (recording interrupted) ends the iteration and is
+    // reported by isTruncated().
+    template <typename OnFrame>
+    void forEachFrame(OnFrame&& onFrame) {
+        const unsigned char* data = m_file.data();
+        uint64_t offset = sizeof(TraceFile::FileHeader);
+        m_truncated = false;
+        while (offset < m_file.size()) {
+            Frame frame;
+            if (m_file.size() - offset < sizeof(TraceFile::FrameHeader)) {
+                m_truncated = true;
+                return;
+            }
+            std::memcpy(&frame.header, data + offset, sizeof(frame.header));
+            offset += sizeof(TraceFile::FrameHeader);
+            uint64_t bytes = uint64_t(frame.header.segmentCount) * sizeof(TraceFile::SegmentRecord);
+            if (frame.header.marker != TraceFile::FRAME_MARKER || m_file.size() - offset < bytes) {
+                m_truncated = true;
+                return;
+            }
+            frame.segments = reinterpret_cast<const TraceFile::SegmentRecord*>(data + offset);
+            offset += bytes;
+            onFrame(frame);
+        }
+    }
+    
+    bool isTruncated() const { return m_truncated; }
+    uint64_t getFileSize() const { return m_file.size(); }
+
+private:
+    MappedFile m_file;
+    bool m_truncated = false;
+};
@@ -0,0 +1,209 @@
+#include "trace_grid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Ray test against primitive p (hit id - 1), in the order described in
+// Tracer::classifyHit
+bool intersectsPrimitive(const Ray& ray, const CircleView& circles, const OccluderView& occluders, std::size_t p,
+                         float& intersectionDist) {
+    if (p < circles.count) {
+        return ray.intersectsCircle(glm::vec2(circles.x[p], circles.y[p]), circles.radius[p], intersectionDist);
+    }
+    p -= circles.count;
+    for (const SegmentView* segments : {&occluders.segments, &occluders.polygonEdges}) {
+        if (p < segments->count) {
+            return ray.intersectsSegment(glm::vec2(segments->x0[p], segments->y0[p]),
+                                         glm::vec2(segments->x1[p], segments->y1[p]), intersectionDist);
+        }
+        p -= segments->count;
+    }
+    const ArcView& arcs = occluders.arcs;
+    return ray.intersectsArc(glm::vec2(arcs.x[p], arcs.y[p]), arcs.radius[p], glm::vec2(arcs.middleX[p], arcs.middleY[p]),
+                             arcs.cosHalfSpan[p], intersectionDist);
+}
+
+} // namespace
+
+void TraceGrid::build(const CircleView& circles, const OccluderView& occluders) {
+    m_columns = 0;
+    m_rows = 0;
+    m_cellStart.clear();
+    m_entries.clear();
+    std::size_t count = circles.count + occluders.count();
+    if (count == 0) return;
+    
+    m_boundsMin = glm::vec2(std::numeric_limits<float>::max());
+    m_boundsMax = glm::vec2(std::numeric_limits<float>::lowest());
+    auto include = [&](const glm::vec2& low, const glm::vec2& high) {
+        m_boundsMin = glm::min(m_boundsMin, low);
+        m_boundsMax = glm::max(m_boundsMax, high);
+    };
+    for (std::size_t i = 0; i < circles.count; ++i) {
+        glm::vec2 center(circles.x[i], circles.y[i]);
+        include(center - glm::vec2(circles.radius[i]), center + glm::vec2(circles.radius[i]));
+    }
+    for (const SegmentView* segments : {&occluders.segments, &occluders.polygonEdges}) {
+        for (std::size_t i = 0; i < segments->count; ++i) {
+            glm::vec2 from(segments->x0[i], segments->y0[i]);
+            glm::vec2 to(segments->x1[i], segments->y1[i]);
+            include(glm::min(from, to), glm::max(from, to));
+        }
+    }
+    for (std::size_t i = 0; i < occluders.arcs.count; ++i) {
+        glm::vec2 center(occluders.arcs.x[i], occluders.arcs.y[i]);
+        include(center - glm::vec2(occluders.arcs.radius[i]), center + glm::vec2(occluders.arcs.radius[i]));
+    }
+    glm::vec2 extent = glm::max(m_boundsMax - m_boundsMin, glm::vec2(1.0f));
+    m_boundsMax = m_boundsMin + extent;
+    
+    // About one cell per primitive keeps both the cells walked and the
+    // primitives tested per cell small
+    float side = std::sqrt(extent.x * extent.y / static_cast<float>(count));
+    m_columns = std::min(MAX_CELLS_PER_AXIS, std::max(1, static_cast<int>(std::ceil(extent.x / side))));
+    m_rows = std::min(MAX_CELLS_PER_AXIS, std::max(1, static_cast<int>(std::ceil(extent.y / side))));
+    m_cellSize = extent / glm::vec2(static_cast<float>(m_columns), static_cast<float>(m_rows));
+    m_inverseCellSize = glm::vec2(1.0f) / m_cellSize;
+    // Boxes are grown slightly so a hit point that rounds across a cell
+    // border is still found in the cell the walk visits
+    m_margin = 1e-3f * std::min(m_cellSize.x, m_cellSize.y) +
+               1e-6f * std::max(glm::length(m_boundsMin), glm::length(m_boundsMax));
+    
+    // Counting sort of (cell, primitive) pairs; primitives stay in index
+    // order within each cell
+    m_cellStart.assign(static_cast<std::size_t>(m_columns) * m_rows + 1, 0);
+    forEachCell(circles, occluders, [&](std::size_t cell, uint32_t) { ++m_cellStart[cell + 1]; });
+    for (std::size_t cell = 1; cell < m_cellStart.size(); ++cell) {
+        m_cellStart[cell] += m_cellStart[cell - 1];
+    }
+    m_entries.resize(m_cellStart.back());
+    m_fill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    forEachCell(circles, occluders, [&](std::size_t cell, uint32_t p) { m_entries[m_fill[cell]++] = p; });
+}
+
+int TraceGrid::columnOf(float x) const {
+    // Callers stay within a margin of the bounds, so truncation equals floor
+    // wherever the clamp does not apply
+    return std::min(m_columns - 1, std::max(0, static_cast<int>((x - m_boundsMin.x) * m_inverseCellSize.x)));
+}
+
+int TraceGrid::rowOf(float y) const {
+    return std::min(m_rows - 1, std::max(0, static_cast<int>((y - m_boundsMin.y) * m_inverseCellSize.y)));
+}
+
+template <class Visit>
+void TraceGrid::forEachCell(const CircleView& circles, const OccluderView& occluders, Visit&& visit) const {
+    uint32_t p = 0;
+    auto visitBox = [&](const glm::vec2& center, float radius) {
+        float reach = radius + m_margin;
+        int x0 = columnOf(center.x - reach);
+        int x1 = columnOf(center.x + reach);
+        for (int y = rowOf(center.y - reach), y1 = rowOf(center.y + reach); y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                visit(static_cast<std::size_t>(y) * m_columns + x, p);
+            }
+        }
+    };
+    
+    for (std::size_t i = 0; i < circles.count; ++i, ++p) {
+        visitBox(glm::vec2(circles.x[i], circles.y[i]), circles.radius[i]);
+    }
+    
+    // Segments visit, row by row, the columns of the piece of the segment
+    // inside that row
+    for (const SegmentView* segments : {&occluders.segments, &occluders.polygonEdges}) {
+        for (std::size_t i = 0; i < segments->count; ++i, ++p) {
+            glm::vec2 from(segments->x0[i], segments->y0[i]);
+            glm::vec2 to(segments->x1[i], segments->y1[i]);
+            float low = std::min(from.y, to.y) - m_margin;
+            float high = std::max(from.y, to.y) + m_margin;
+            for (int y = rowOf(low), y1 = rowOf(high); y <= y1; ++y) {
+                float xa = from.x;
+                float xb = to.x;
+                if (to.y != from.y) {
+                    float rowLow = std::max(low, m_boundsMin.y + y * m_cellSize.y - m_margin);
+                    float rowHigh = std::min(high, m_boundsMin.y + (y + 1) * m_cellSize.y + m_margin);
+                    float sa = std::min(1.0f, std::max(0.0f, (rowLow - from.y) / (to.y - from.y)));
+                    float sb = std::min(1.0f, std::max(0.0f, (rowHigh - from.y) / (to.y - from.y)));
+                    xa = from.x + (to.x - from.x) * sa;
+                    xb = from.x + (to.x - from.x) * sb;
+                }
+                for (int x = columnOf(std::min(xa, xb) - m_margin), x1 = columnOf(std::max(xa, xb) + m_margin);
+                     x <= x1; ++x) {
+                    visit(static_cast<std::size_t>(y) * m_columns + x, p);
+                }
+            }
+        }
+    }
+    
+    // Arcs are binned by their whole circle
+    for (std::size_t i = 0; i < occluders.arcs.count; ++i, ++p) {
+        visitBox(glm::vec2(occluders.arcs.x[i], occluders.arcs.y[i]), occluders.arcs.radius[i]);
+    }
+}
+
+void TraceGrid::findNearest(const Ray& ray, const CircleView& circles, const OccluderView& occluders,
+                            float& minDist, int32_t& hitId, uint64_t& tests) const {
+    if (m_columns == 0) return;
+    const float infinity = std::numeric_limits<float>::infinity();
+    
+    // Clip the ray to the grid bounds, in units of the ray parameter
+    float tEnter = 0.0f;
+    float tLeave = infinity;
+    for (int axis = 0; axis < 2; ++axis) {
+        if (ray.direction[axis] != 0.0f) {
+            float t0 = (m_boundsMin[axis] - ray.origin[axis]) / ray.direction[axis];
+            float t1 = (m_boundsMax[axis] - ray.origin[axis]) / ray.direction[axis];
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tLeave = std::min(tLeave, std::max(t0, t1));
+        } else if (ray.origin[axis] < m_boundsMin[axis] || ray.origin[axis] > m_boundsMax[axis]) {
+            return;
+        }
+    }
+    if (tEnter > tLeave || tEnter >= minDist) return;
+    
+    // Cell walk (Amanatides and Woo)
+    glm::vec2 start = (ray.origin + ray.direction * tEnter - m_boundsMin) * m_inverseCellSize;
+    int cellX = std::min(m_columns - 1, std::max(0, static_cast<int>(std::floor(start.x))));
+    int cellY = std::min(m_rows - 1, std::max(0, static_cast<int>(std::floor(start.y))));
+    int stepX = ray.direction.x > 0.0f ? 1 : (ray.direction.x < 0.0f ? -1 : 0);
+    int stepY = ray.direction.y > 0.0f ? 1 : (ray.direction.y < 0.0f ? -1 : 0);
+    float nextX = stepX == 0 ? infinity
+        : (m_boundsMin.x + (cellX + (stepX > 0 ? 1 : 0)) * m_cellSize.x - ray.origin.x) / ray.direction.x;
+    float nextY = stepY == 0 ? infinity
+        : (m_boundsMin.y + (cellY + (stepY > 0 ? 1 : 0)) * m_cellSize.y - ray.origin.y) / ray.direction.y;
+    float deltaX = stepX == 0 ? infinity : m_cellSize.x / std::abs(ray.direction.x);
+    float deltaY = stepY == 0 ? infinity : m_cellSize.y / std::abs(ray.direction.y);
+    
+    float intersectionDist;
+    for (;;) {
+        std::size_t cell = static_cast<std::size_t>(cellY) * m_columns + cellX;
+        for (uint32_t entry = m_cellStart[cell]; entry < m_cellStart[cell + 1]; ++entry) {
+            uint32_t p = m_entries[entry];
+            ++tests;
+            if (intersectsPrimitive(ray, circles, occluders, p, intersectionDist)) {
+                int32_t id = static_cast<int32_t>(p + 1);
+                if (intersectionDist < minDist || (intersectionDist == minDist && hitId > 0 && id < hitId)) {
+                    minDist = intersectionDist;
+                    hitId = id;
+                }
+            }
+        }
+        
+        // A hit before the cell exit cannot be beaten by a later cell; a hit
+        // exactly on the border may still tie with one in the next cell
+        float cellExit = std::min(nextX, nextY);
+        if (minDist < cellExit || cellExit >= tLeave) break;
+        if (nextX < nextY) {
+            cellX += stepX;
+            if (cellX < 0 || cellX >= m_columns) break;
+            nextX += deltaX;
+        } else {
+            cellY += stepY;
+            if (cellY < 0 || cellY >= m_rows) break;
+            nextY += deltaY;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "ray.hpp"
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over the obstacles and occluders, used by TraceKernel::Grid.
+// Each primitive is listed in every cell it may touch, in hit id order:
+// circles and arcs by their bounding box, segments by the cells along their
+// length. A ray walks the cells it crosses front to back and stops once the
+// nearest hit lies before the next cell.
+//
+// Building is a linear counting sort with no per-circle allocation, so the
+// grid is simply rebuilt for every trace: moving obstacles need no
+// separate refit path, and the cost shows up in TraceStats::buildMs.
+class TraceGrid {
+public:
+    // Cells per axis are capped so a few huge circles cannot blow up memory
+    static constexpr int MAX_CELLS_PER_AXIS = 2048;
+    
+    void build(const CircleView& circles, const OccluderView& occluders);
+    
+    // Nearest obstacle or occluder hit closer than minDist, as in the
+    // brute-force kernels: obstacle i is reported as hit id i + 1, occluders
+    // follow in Tracer::classifyHit order, and equally distant hits go to the
+    // lower id (or keep hitId if it is the main object). Must be given the
+    // primitives the grid was built from. tests counts the intersection
+    // tests done, repeats included.
+    void findNearest(const Ray& ray, const CircleView& circles, const OccluderView& occluders, float& minDist,
+                     int32_t& hitId, uint64_t& tests) const;
+    
+    int getColumns() const { return m_columns; }
+    int getRows() const { return m_rows; }
+    std::size_t getEntryCount() const { return m_entries.size(); }
+
+private:
+    glm::vec2 m_boundsMin{0.0f};
+    glm::vec2 m_boundsMax{0.0f};
+    glm::vec2 m_cellSize{1.0f};
+    glm::vec2 m_inverseCellSize{1.0f};
+    float m_margin = 0.0f;  // Added around every primitive when binning
+    int m_columns = 0;
+    int m_rows = 0;
+    std::vector<uint32_t> m_cellStart;  // m_columns * m_rows + 1 offsets into m_entries
+    std::vector<uint32_t> m_entries;    // Primitive indices (hit id - 1) grouped by cell
+    std::vector<uint32_t> m_fill;       // Build scratch, kept to avoid reallocating
+    
+    int columnOf(float x) const;
+    int rowOf(float y) const;
+    
+    // Calls visit(cell, primitive) for every cell of every primitive, in
+    // primitive order
+    template <class Visit>
+    void forEachCell(const CircleView& circles, const OccluderView& occluders, Visit&& visit) const;
+};
@@ -0,0 +1,133 @@
+#include "trace_recorder.hpp"
+#include "profiler.hpp"
+#include "log.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+TraceRecorder::TraceRecorder(const std::string& path, std::size_t blockSize) : m_path(path) {
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        throw std::runtime_error("Failed to open trace file for writing: " + path);
+    }
+    // Blocks are already large; skip the stdio buffer copy
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+    
+    for (Block& block : m_blocks) {
+        block.data.resize(std::max<std::size_t>(blockSize, sizeof(TraceFile::SegmentRecord)));
+    }
+    
+    TraceFile::FileHeader header{};
+    std::memcpy(header.magic, TraceFile::MAGIC, sizeof(TraceFile::MAGIC));
+    header.version = TraceFile::VERSION;
+    header.recordSize = sizeof(TraceFile::SegmentRecord);
+    append(&header, sizeof(header));
+    
+    m_writer = std::thread(&TraceRecorder::writerLoop, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+    try {
+        close();
+    } catch (const std::exception& e) {
+        LOG_ERROR(Tracing, "Trace recording: %s", e.what());
+    }
+}
+
+void TraceRecorder::recordFrame(uint64_t frame, double time, const std::vector<TraceSegment>& segments) {
+    if (!m_file) return;
+    PROFILE_SCOPE("Record trace frame");
+    
+    TraceFile::FrameHeader header;
+    header.marker = TraceFile::FRAME_MARKER;
+    header.segmentCount = static_cast<uint32_t>(segments.size());
+    header.frame = frame;
+    header.time = time;
+    append(&header, sizeof(header));
+    
+    // Pack straight into the block where the record fits
+    for (const TraceSegment& segment : segments) {
+        TraceFile::SegmentRecord record = TraceFile::packSegment(segment);
+        Block& block = m_blocks[m_active];
+        if (block.data.size() - block.size >= sizeof(record)) {
+            std::memcpy(block.data.data() + block.size, &record, sizeof(record));
+            block.size += sizeof(record);
+        } else {
+            append(&record, sizeof(record));
+        }
+    }
+    ++m_framesRecorded;
+}
+
+void TraceRecorder::append(const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    while (size > 0) {
+        Block& block = m_blocks[m_active];
+        std::size_t count = std::min(size, block.data.size() - block.size);
+        std::memcpy(block.data.data() + block.size, bytes, count);
+        block.size += count;
+        bytes += count;
+        size -= count;
+        if (block.size == block.data.size()) {
+            submitActiveBlock();
+        }
+    }
+}
+
+void TraceRecorder::submitActiveBlock() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Wait for the writer to release the other block before switching to it
+    m_condition.wait(lock, [this] { return m_pending < 0; });
+    m_pending = m_active;
+    m_active ^= 1;
+    m_blocks[m_active].size = 0;
+    m_condition.notify_all();
+}
+
+void TraceRecorder::writerLoop() {
+    Profiler::setThreadName("Trace writer");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this] { return m_pending >= 0 || m_stop; });
+        if (m_pending < 0) {
+            return;  // Stopped with nothing left to write
+        }
+        
+        Block& block = m_blocks[m_pending];
+        lock.unlock();
+        std::size_t written;
+        {
+            PROFILE_SCOPE("Write trace block");
+            written = std::fwrite(block.data.data(), 1, block.size, m_file);
+        }
+        m_bytesWritten += written;
+        lock.lock();
+        
+        if (written != block.size) {
+            m_writeFailed = true;
+        }
+        m_pending = -1;
+        m_condition.notify_all();
+    }
+}
+
+void TraceRecorder::close() {
+    if (!m_file) return;
+    
+    if (m_blocks[m_active].size > 0) {
+        submitActiveBlock();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    m_writer.join();
+    
+    bool closeFailed = std::fclose(m_file) != 0;
+    bool failed = m_writeFailed || closeFailed;
+    m_file = nullptr;
+    if (failed) {
+        throw std::runtime_error("Failed to write trace file: " + m_path);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "trace_file.hpp"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstddef>
+
+// Streams traced segments to a .rttrace file (see trace_file.hpp).
+//
+// Frames are packed into one of two large blocks on the calling thread.
+// When the active block fills up it is handed to a background writer thread,
+// which writes it with a single sequential fwrite while the caller fills the
+// other block. The caller only waits if the disk falls a whole block behind.
+class TraceRecorder {
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 8u << 20;  // 8 MiB per block
+    
+    // Creates or truncates the file. Throws std::runtime_error on failure.
+    explicit TraceRecorder(const std::string& path, std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~TraceRecorder();
+    
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    
+    // Appends one frame. time is in seconds, relative to any fixed origin.
+    void recordFrame(uint64_t frame, double time, const std::vector<TraceSegment>& segments);
+    
+    // Flushes outstanding blocks and closes the file. Called by the destructor.
+    // Throws std::runtime_error if any write failed.
+    void close();
+    
+    uint64_t getFramesRecorded() const { return m_framesRecorded; }
+    uint64_t getBytesWritten() const { return m_bytesWritten.load(); }
+    const std::string& getPath() const { return m_path; }
+
+private:
+    struct Block {
+        std::vector<unsigned char> data;
+        std::size_t size = 0;
+    };
+    
+    std::string m_path;
+    std::FILE* m_file = nullptr;
+    Block m_blocks[2];
+    int m_active = 0;
+    int m_pending = -1;  // Block queued for the writer, -1 if none
+    bool m_stop = false;
+    bool m_writeFailed = false;
+    uint64_t m_framesRecorded = 0;
+    std::atomic<uint64_t> m_bytesWritten{0};
+    
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::thread m_writer;
+    
+    void append(const void* data, std::size_t size);
+    void submitActiveBlock();
+    void writerLoop();
+};
@@ -0,0 +1,910 @@
+#include "tracer.hpp"
+#include "profiler.hpp"
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYTRACER_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Nearest obstacle hit closer than minDist, one circle at a time. Obstacle i
+// is reported as hit id i + 1; the first of equally distant hits wins.
+void findNearestObstacleScalar(const Ray& ray, const CircleView& obstacles, std::size_t first,
+                               float& minDist, int32_t& hitId) {
+    float intersectionDist;
+    for (std::size_t i = first; i < obstacles.count; ++i) {
+        if (ray.intersectsCircle(glm::vec2(obstacles.x[i], obstacles.y[i]), obstacles.radius[i], intersectionDist)) {
+            if (intersectionDist < minDist) {
+                minDist = intersectionDist;
+                hitId = static_cast<int32_t>(i + 1);
+            }
+        }
+    }
+}
+
+// Nearest segment hit closer than minDist; segment i is reported as hit id
+// firstId + i. Used for free segments and polygon edges alike.
+void findNearestSegmentScalar(const Ray& ray, const SegmentView& segments, std::size_t first, int32_t firstId,
+                              float& minDist, int32_t& hitId) {
+    float intersectionDist;
+    for (std::size_t i = first; i < segments.count; ++i) {
+        if (ray.intersectsSegment(glm::vec2(segments.x0[i], segments.y0[i]), glm::vec2(segments.x1[i], segments.y1[i]),
+                                  intersectionDist)) {
+            if (intersectionDist < minDist) {
+                minDist = intersectionDist;
+                hitId = firstId + static_cast<int32_t>(i);
+            }
+        }
+    }
+}
+
+// Nearest arc hit closer than minDist; arc i is reported as hit id firstId + i
+void findNearestArcScalar(const Ray& ray, const ArcView& arcs, std::size_t first, int32_t firstId, float& minDist,
+                          int32_t& hitId) {
+    float intersectionDist;
+    for (std::size_t i = first; i < arcs.count; ++i) {
+        if (ray.intersectsArc(glm::vec2(arcs.x[i], arcs.y[i]), arcs.radius[i], glm::vec2(arcs.middleX[i], arcs.middleY[i]),
+                              arcs.cosHalfSpan[i], intersectionDist)) {
+            if (intersectionDist < minDist) {
+                minDist = intersectionDist;
+                hitId = firstId + static_cast<int32_t>(i);
+            }
+        }
+    }
+}
+
+#ifdef RAYTRACER_HAS_SSE2
+// Folds the per-lane results of a four-wide kernel into minDist and hitId.
+// Lanes only ever improve on minDist, so the nearest lane wins; equal
+// distances go to the lower index, as in the scalar loops.
+void takeNearestLane(__m128 best, __m128i bestIndex, int32_t firstId, float& minDist, int32_t& hitId) {
+    alignas(16) float laneDist[4];
+    alignas(16) int32_t laneIndex[4];
+    _mm_store_ps(laneDist, best);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneIndex), bestIndex);
+    int32_t nearest = -1;
+    for (int lane = 0; lane < 4; ++lane) {
+        if (laneIndex[lane] < 0) continue;
+        if (nearest < 0 || laneDist[lane] < minDist || (laneDist[lane] == minDist && laneIndex[lane] < nearest)) {
+            minDist = laneDist[lane];
+            nearest = laneIndex[lane];
+        }
+    }
+    if (nearest >= 0) {
+        hitId = firstId + nearest;
+    }
+}
+
+// Same as findNearestObstacleScalar, four circles per step. The arithmetic
+// follows Ray::intersectsCircle operation by operation, so results are
+// bit-identical to the scalar kernel.
+void findNearestObstacleSse2(const Ray& ray, const CircleView& obstacles, float& minDist, int32_t& hitId) {
+    const float a = glm::dot(ray.direction, ray.direction);
+    const __m128 originX = _mm_set1_ps(ray.origin.x);
+    const __m128 originY = _mm_set1_ps(ray.origin.y);
+    const __m128 dirX = _mm_set1_ps(ray.direction.x);
+    const __m128 dirY = _mm_set1_ps(ray.direction.y);
+    const __m128 fourA = _mm_set1_ps(4.0f * a);
+    const __m128 twoA = _mm_set1_ps(2.0f * a);
+    const __m128 minusTwo = _mm_set1_ps(-2.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    
+    __m128 best = _mm_set1_ps(minDist);
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    
+    std::size_t i = 0;
+    for (; i + 4 <= obstacles.count; i += 4) {
+        __m128 toX = _mm_sub_ps(_mm_loadu_ps(obstacles.x + i), originX);
+        __m128 toY = _mm_sub_ps(_mm_loadu_ps(obstacles.y + i), originY);
+        __m128 radius = _mm_loadu_ps(obstacles.radius + i);
+        
+        __m128 b = _mm_mul_ps(minusTwo, _mm_add_ps(_mm_mul_ps(toX, dirX), _mm_mul_ps(toY, dirY)));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(toX, toX), _mm_mul_ps(toY, toY)), _mm_mul_ps(radius, radius));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(fourA, c));
+        __m128 t = _mm_div_ps(_mm_sub_ps(_mm_xor_ps(b, signMask), _mm_sqrt_ps(discriminant)), twoA);
+        
+        // Negative discriminants give NaN t, which fails both compares
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, zero),
+                                _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, best)));
+        __m128i hitInt = _mm_castps_si128(hit);
+        best = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, best));
+        bestIndex = _mm_or_si128(_mm_and_si128(hitInt, index), _mm_andnot_si128(hitInt, bestIndex));
+        index = _mm_add_epi32(index, step);
+    }
+    
+    takeNearestLane(best, bestIndex, 1, minDist, hitId);
+    findNearestObstacleScalar(ray, obstacles, i, minDist, hitId);
+}
+
+// Same as findNearestSegmentScalar, four segments per step, following
+// Ray::intersectsSegment operation by operation
+void findNearestSegmentSse2(const Ray& ray, const SegmentView& segments, int32_t firstId, float& minDist,
+                            int32_t& hitId) {
+    const __m128 originX = _mm_set1_ps(ray.origin.x);
+    const __m128 originY = _mm_set1_ps(ray.origin.y);
+    const __m128 dirX = _mm_set1_ps(ray.direction.x);
+    const __m128 dirY = _mm_set1_ps(ray.direction.y);
+    const __m128 epsilon = _mm_set1_ps(Ray::SURFACE_EPSILON);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    
+    __m128 best = _mm_set1_ps(minDist);
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    
+    std::size_t i = 0;
+    for (; i + 4 <= segments.count; i += 4) {
+        __m128 fromX = _mm_loadu_ps(segments.x0 + i);
+        __m128 fromY = _mm_loadu_ps(segments.y0 + i);
+        __m128 edgeX = _mm_sub_ps(_mm_loadu_ps(segments.x1 + i), fromX);
+        __m128 edgeY = _mm_sub_ps(_mm_loadu_ps(segments.y1 + i), fromY);
+        __m128 toStartX = _mm_sub_ps(fromX, originX);
+        __m128 toStartY = _mm_sub_ps(fromY, originY);
+        
+        __m128 denominator = _mm_sub_ps(_mm_mul_ps(dirX, edgeY), _mm_mul_ps(dirY, edgeX));
+        __m128 t = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(toStartX, edgeY), _mm_mul_ps(toStartY, edgeX)), denominator);
+        __m128 s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(toStartX, dirY), _mm_mul_ps(toStartY, dirX)), denominator);
+        
+        // Parallel segments divide by zero; their lanes are masked out
+        __m128 hit = _mm_and_ps(_mm_cmpneq_ps(denominator, zero),
+                                _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(s, zero), _mm_cmple_ps(s, one)),
+                                           _mm_and_ps(_mm_cmpge_ps(t, epsilon), _mm_cmplt_ps(t, best))));
+        __m128i hitInt = _mm_castps_si128(hit);
+        best = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, best));
+        bestIndex = _mm_or_si128(_mm_and_si128(hitInt, index), _mm_andnot_si128(hitInt, bestIndex));
+        index = _mm_add_epi32(index, step);
+    }
+    
+    takeNearestLane(best, bestIndex, firstId, minDist, hitId);
+    findNearestSegmentScalar(ray, segments, i, firstId, minDist, hitId);
+}
+
+// Same as findNearestArcScalar, four arcs per step, following
+// Ray::intersectsArc operation by operation
+void findNearestArcSse2(const Ray& ray, const ArcView& arcs, int32_t firstId, float& minDist, int32_t& hitId) {
+    const float a = glm::dot(ray.direction, ray.direction);
+    const __m128 originX = _mm_set1_ps(ray.origin.x);
+    const __m128 originY = _mm_set1_ps(ray.origin.y);
+    const __m128 dirX = _mm_set1_ps(ray.direction.x);
+    const __m128 dirY = _mm_set1_ps(ray.direction.y);
+    const __m128 fourA = _mm_set1_ps(4.0f * a);
+    const __m128 twoA = _mm_set1_ps(2.0f * a);
+    const __m128 minusTwo = _mm_set1_ps(-2.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 epsilon = _mm_set1_ps(Ray::SURFACE_EPSILON);
+    const __m128 zero = _mm_setzero_ps();
+    
+    __m128 best = _mm_set1_ps(minDist);
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    
+    std::size_t i = 0;
+    for (; i + 4 <= arcs.count; i += 4) {
+        __m128 centerX = _mm_loadu_ps(arcs.x + i);
+        __m128 centerY = _mm_loadu_ps(arcs.y + i);
+        __m128 radius = _mm_loadu_ps(arcs.radius + i);
+        __m128 middleX = _mm_loadu_ps(arcs.middleX + i);
+        __m128 middleY = _mm_loadu_ps(arcs.middleY + i);
+        __m128 toX = _mm_sub_ps(centerX, originX);
+        __m128 toY = _mm_sub_ps(centerY, originY);
+        
+        __m128 b = _mm_mul_ps(minusTwo, _mm_add_ps(_mm_mul_ps(toX, dirX), _mm_mul_ps(toY, dirY)));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(toX, toX), _mm_mul_ps(toY, toY)), _mm_mul_ps(radius, radius));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(fourA, c));
+        __m128 root = _mm_sqrt_ps(discriminant);
+        __m128 limit = _mm_mul_ps(_mm_loadu_ps(arcs.cosHalfSpan + i), radius);
+        __m128 minusB = _mm_xor_ps(b, signMask);
+        
+        auto onArc = [&](__m128 t) {
+            __m128 offsetX = _mm_sub_ps(_mm_add_ps(originX, _mm_mul_ps(dirX, t)), centerX);
+            __m128 offsetY = _mm_sub_ps(_mm_add_ps(originY, _mm_mul_ps(dirY, t)), centerY);
+            __m128 projection = _mm_add_ps(_mm_mul_ps(offsetX, middleX), _mm_mul_ps(offsetY, middleY));
+            return _mm_and_ps(_mm_cmpge_ps(t, epsilon), _mm_cmpge_ps(projection, limit));
+        };
+        __m128 tNear = _mm_div_ps(_mm_sub_ps(minusB, root), twoA);
+        __m128 tFar = _mm_div_ps(_mm_add_ps(minusB, root), twoA);
+        __m128 nearOnArc = onArc(tNear);
+        __m128 t = _mm_or_ps(_mm_and_ps(nearOnArc, tNear), _mm_andnot_ps(nearOnArc, tFar));
+        
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, zero),
+                                _mm_and_ps(_mm_or_ps(nearOnArc, onArc(tFar)), _mm_cmplt_ps(t, best)));
+        __m128i hitInt = _mm_castps_si128(hit);
+        best = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, best));
+        bestIndex = _mm_or_si128(_mm_and_si128(hitInt, index), _mm_andnot_si128(hitInt, bestIndex));
+        index = _mm_add_epi32(index, step);
+    }
+    
+    takeNearestLane(best, bestIndex, firstId, minDist, hitId);
+    findNearestArcScalar(ray, arcs, i, firstId, minDist, hitId);
+}
+#endif
+
+// Occluders follow the obstacles in hit id order: segments, polygon edges,
+// then arcs. Each group only replaces a hit that is strictly nearer, so ties
+// keep the lowest id as in the obstacle kernels.
+void findNearestOccluder(TraceKernel kernel, const Ray& ray, const TraceScene& scene, float& minDist,
+                         int32_t& hitId) {
+    const OccluderView& occluders = scene.occluders;
+    int32_t firstId = static_cast<int32_t>(scene.obstacles.count + 1);
+    int32_t edgeId = firstId + static_cast<int32_t>(occluders.segments.count);
+    int32_t arcId = edgeId + static_cast<int32_t>(occluders.polygonEdges.count);
+#ifdef RAYTRACER_HAS_SSE2
+    if (kernel == TraceKernel::Simd) {
+        findNearestSegmentSse2(ray, occluders.segments, firstId, minDist, hitId);
+        findNearestSegmentSse2(ray, occluders.polygonEdges, edgeId, minDist, hitId);
+        findNearestArcSse2(ray, occluders.arcs, arcId, minDist, hitId);
+        return;
+    }
+#endif
+    (void)kernel;
+    findNearestSegmentScalar(ray, occluders.segments, 0, firstId, minDist, hitId);
+    findNearestSegmentScalar(ray, occluders.polygonEdges, 0, edgeId, minDist, hitId);
+    findNearestArcScalar(ray, occluders.arcs, 0, arcId, minDist, hitId);
+}
+
+// 32-bit integer hash (lowbias32); 32-bit so the compute shader can
+// repeat it exactly
+uint32_t mixBits(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Cuts a ray off where attenuation takes its energy below minEnergy
+void limitToEnergy(const TraceSettings& settings, Ray& ray) {
+    if (settings.attenuationLength > 0.0f && settings.minEnergy > 0.0f) {
+        ray.length = std::min(ray.length, settings.attenuationLength * std::log(ray.energy / settings.minEnergy));
+    }
+}
+
+// Applies the energy floor and Russian roulette to a spawned ray. The
+// roulette draw is a hash of the ray's place in its primary ray's tree,
+// so the outcome does not depend on the kernel, threads or budget.
+bool keepSpawnedRay(const TraceSettings& settings, int32_t primary, int depth, uint64_t branch, float& energy,
+                    TraceStats& stats) {
+    if (energy < settings.minEnergy) {
+        ++stats.energyCulled;
+        return false;
+    }
+    if (energy < settings.rouletteEnergy) {
+        uint32_t hash = mixBits(mixBits(mixBits(mixBits(static_cast<uint32_t>(primary)) ^ static_cast<uint32_t>(depth)) ^
+                                        static_cast<uint32_t>(branch)) ^ static_cast<uint32_t>(branch >> 32));
+        float sample = static_cast<float>(hash >> 8) * (1.0f / 16777216.0f);
+        if (sample * settings.rouletteEnergy >= energy) {
+            ++stats.rouletteKilled;
+            return false;
+        }
+        energy = settings.rouletteEnergy;
+    }
+    return true;
+}
+
+// Fresnel reflectance, relative index eta = n1 / n2 and transmitted cosine
+// of every wavelength bin, following Ray::calculateRefraction operation by
+// operation. Bins in total internal reflection get reflectance 1.
+void refractBins(float cosIncident, const float* n1, const float* n2, float* eta, float* cosTransmitted,
+                 float* reflectance) {
+#ifdef RAYTRACER_HAS_SSE2
+    const __m128 cosI = _mm_set1_ps(cosIncident);
+    const __m128 sinI2 = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(cosI, cosI));
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (int k = 0; k < Spectrum::BINS; k += 4) {
+        __m128 a = _mm_loadu_ps(n1 + k);
+        __m128 b = _mm_loadu_ps(n2 + k);
+        __m128 e = _mm_div_ps(a, b);
+        __m128 sinT2 = _mm_mul_ps(_mm_mul_ps(e, e), sinI2);
+        __m128 tir = _mm_cmpge_ps(sinT2, one);
+        __m128 cosT = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, sinT2), zero));
+        
+        __m128 aCosI = _mm_mul_ps(a, cosI);
+        __m128 bCosT = _mm_mul_ps(b, cosT);
+        __m128 rs = _mm_div_ps(_mm_sub_ps(aCosI, bCosT), _mm_add_ps(aCosI, bCosT));
+        __m128 aCosT = _mm_mul_ps(a, cosT);
+        __m128 bCosI = _mm_mul_ps(b, cosI);
+        __m128 rp = _mm_div_ps(_mm_sub_ps(aCosT, bCosI), _mm_add_ps(aCosT, bCosI));
+        __m128 r = _mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(rs, rs), _mm_mul_ps(rp, rp)));
+        
+        _mm_storeu_ps(eta + k, e);
+        _mm_storeu_ps(cosTransmitted + k, cosT);
+        _mm_storeu_ps(reflectance + k, _mm_or_ps(_mm_and_ps(tir, one), _mm_andnot_ps(tir, r)));
+    }
+#else
+    float sinI2 = 1.0f - cosIncident * cosIncident;
+    for (int k = 0; k < Spectrum::BINS; ++k) {
+        eta[k] = n1[k] / n2[k];
+        float sinT2 = eta[k] * eta[k] * sinI2;
+        cosTransmitted[k] = std::sqrt(std::max(1.0f - sinT2, 0.0f));
+        if (sinT2 >= 1.0f) {
+            reflectance[k] = 1.0f;
+            continue;
+        }
+        float rs = (n1[k] * cosIncident - n2[k] * cosTransmitted[k]) / (n1[k] * cosIncident + n2[k] * cosTransmitted[k]);
+        float rp = (n1[k] * cosTransmitted[k] - n2[k] * cosIncident) / (n1[k] * cosTransmitted[k] + n2[k] * cosIncident);
+        reflectance[k] = 0.5f * (rs * rs + rp * rp);
+    }
+#endif
+}
+
+// Rays carrying more energy, then rays earlier in the breadth-first order
+struct HigherPriority {
+    template <typename PendingRay>
+    bool operator()(const PendingRay& a, const PendingRay& b) const {
+        if (a.ray.energy != b.ray.energy) return a.ray.energy > b.ray.energy;
+        if (a.primary != b.primary) return a.primary < b.primary;
+        if (a.ray.reflectionCount != b.ray.reflectionCount) return a.ray.reflectionCount < b.ray.reflectionCount;
+        return a.branch < b.branch;
+    }
+};
+
+int energyBand(float energy, int bands) {
+    if (energy >= 1.0f) return 0;
+    if (energy <= 0.0f) return bands - 1;
+    return std::min(bands - 1, -std::ilogb(energy) - 1);
+}
+
+} // namespace
+
+void TraceStats::add(const TraceStats& other) {
+    primaryRays += other.primaryRays;
+    raysTraced += other.raysTraced;
+    intersectionTests += other.intersectionTests;
+    segments += other.segments;
+    for (int i = 0; i < DEPTH_BUCKETS; ++i) {
+        segmentsByDepth[i] += other.segmentsByDepth[i];
+    }
+    misses += other.misses;
+    depthLimited += other.depthLimited;
+    refractions += other.refractions;
+    dispersionSplits += other.dispersionSplits;
+    energyCulled += other.energyCulled;
+    rouletteKilled += other.rouletteKilled;
+    budgetLimited += other.budgetLimited;
+}
+
+Tracer::Tracer(TraceKernel kernel, unsigned int threadCount)
+    : m_kernel(kernel),
+      m_threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())) {
+    if (m_threadCount > 1) {
+        m_pool = std::make_unique<WorkerPool>(m_threadCount - 1, "Trace worker");
+    }
+}
+
+bool Tracer::isSimdAvailable() {
+#ifdef RAYTRACER_HAS_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+glm::vec2 Tracer::primaryDirection(int i, int count) {
+    float angle = 2.0f * 3.14159f * float(i) / float(count);
+    return glm::vec2(std::cos(angle), std::sin(angle));
+}
+
+Ray Tracer::primaryRay(const TraceScene& scene, const TraceSettings& settings, int i) {
+    Ray ray;
+    ray.origin = scene.lightOrigin;
+    ray.direction = primaryDirection(i, settings.rayCount);
+    ray.length = settings.maxRayLength;
+    ray.color = settings.primaryColor;
+    limitToEnergy(settings, ray);
+    return ray;
+}
+
+float Tracer::reflectionLength(const TraceSettings& settings, int reflectionCount) {
+    // Make each subsequent reflection progressively shorter
+    float lengthFactor = settings.reflectionLengthFactor * std::pow(0.7f, reflectionCount - 1);
+    return settings.maxRayLength * lengthFactor;
+}
+
+float Tracer::attenuate(const TraceSettings& settings, float energy, float distance) {
+    if (settings.attenuationLength <= 0.0f) return energy;
+    return energy * std::exp(-distance / settings.attenuationLength);
+}
+
+float Tracer::reflectance(const glm::vec3& color) {
+    // Rec. 709 luminance weights
+    return glm::clamp(0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b, 0.0f, 1.0f);
+}
+
+TraceHitKind Tracer::classifyHit(const TraceScene& scene, int32_t hitId, std::size_t& index) {
+    index = 0;
+    if (hitId == TRACE_NO_HIT) return TraceHitKind::None;
+    if (hitId == TRACE_MAIN_OBJECT) return TraceHitKind::MainObject;
+    
+    index = static_cast<std::size_t>(hitId - 1);
+    if (index < scene.obstacles.count) return TraceHitKind::Obstacle;
+    index -= scene.obstacles.count;
+    if (index < scene.occluders.segments.count) return TraceHitKind::Segment;
+    index -= scene.occluders.segments.count;
+    if (index < scene.occluders.polygonEdges.count) return TraceHitKind::PolygonEdge;
+    index -= scene.occluders.polygonEdges.count;
+    return TraceHitKind::Arc;
+}
+
+glm::vec2 Tracer::hitNormal(const TraceScene& scene, int32_t hitId, const glm::vec2& point) {
+    std::size_t i;
+    TraceHitKind kind = classifyHit(scene, hitId, i);
+    switch (kind) {
+        case TraceHitKind::Obstacle:
+            return glm::normalize(point - glm::vec2(scene.obstacles.x[i], scene.obstacles.y[i]));
+        case TraceHitKind::Segment:
+        case TraceHitKind::PolygonEdge: {
+            const SegmentView& segments =
+                kind == TraceHitKind::Segment ? scene.occluders.segments : scene.occluders.polygonEdges;
+            glm::vec2 edge(segments.x1[i] - segments.x0[i], segments.y1[i] - segments.y0[i]);
+            return glm::normalize(glm::vec2(-edge.y, edge.x));
+        }
+        case TraceHitKind::Arc:
+            return glm::normalize(point - glm::vec2(scene.occluders.arcs.x[i], scene.occluders.arcs.y[i]));
+        default:
+            return glm::normalize(point - scene.mainPosition);
+    }
+}
+
+bool Tracer::findNearestHit(const Ray& ray, const TraceScene& scene, float& hitDist, int32_t& hitId,
+                            uint64_t& tests) const {
+    float minDist = ray.length;
+    float intersectionDist;
+    hitId = TRACE_NO_HIT;
+    
+    // Check main object
+    ++tests;
+    if (ray.intersectsCircle(scene.mainPosition, scene.mainRadius, intersectionDist)) {
+        minDist = intersectionDist;
+        hitId = TRACE_MAIN_OBJECT;
+    }
+    
+    // Check obstacles, then occluders
+    if (m_kernel == TraceKernel::Grid) {
+        m_grid.findNearest(ray, scene.obstacles, scene.occluders, minDist, hitId, tests);
+    } else {
+        tests += scene.obstacles.count + scene.occluders.count();
+#ifdef RAYTRACER_HAS_SSE2
+        if (m_kernel == TraceKernel::Simd) {
+            findNearestObstacleSse2(ray, scene.obstacles, minDist, hitId);
+        } else
+#endif
+        {
+            findNearestObstacleScalar(ray, scene.obstacles, 0, minDist, hitId);
+        }
+        if (!scene.occluders.empty()) {
+            findNearestOccluder(m_kernel, ray, scene, minDist, hitId);
+        }
+    }
+    
+    // The kernels only see circles from the outside; a ray travelling inside
+    // a refractive obstacle also hits it where it leaves
+    if (ray.medium > TRACE_MAIN_OBJECT) {
+        ++tests;
+        std::size_t i = static_cast<std::size_t>(ray.medium - 1);
+        if (ray.exitsCircle(glm::vec2(scene.obstacles.x[i], scene.obstacles.y[i]), scene.obstacles.radius[i],
+                            intersectionDist) && intersectionDist < minDist) {
+            minDist = intersectionDist;
+            hitId = ray.medium;
+        }
+    }
+    
+    hitDist = minDist;
+    return hitId != TRACE_NO_HIT;
+}
+
+unsigned int Tracer::threadsFor(std::size_t rays) const {
+    return static_cast<unsigned int>(std::min<std::size_t>(m_threadCount,
+        std::max<std::size_t>(1, rays / MIN_RAYS_PER_THREAD)));
+}
+
+void Tracer::runParallel(unsigned int threads, const std::function<void(unsigned int)>& work) const {
+    if (threads <= 1 || !m_pool) {
+        work(0);
+        return;
+    }
+    m_pool->run(threads, work);
+}
+
+void Tracer::trace(const TraceScene& scene, const TraceSettings& settings,
+                   std::vector<TraceSegment>& segments) const {
+    PROFILE_SCOPE("Tracer::trace");
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    
+    segments.clear();
+    m_lastStats = TraceStats();
+    if (settings.rayCount <= 0) {
+        return;
+    }
+    
+    // The grid is rebuilt on every call, so obstacles may move between traces
+    if (m_kernel == TraceKernel::Grid) {
+        PROFILE_SCOPE("Build trace grid");
+        m_grid.build(scene.obstacles, scene.occluders);
+        m_lastStats.buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    
+    if (settings.maxSegments > 0) {
+        traceBudgeted(scene, settings, segments);
+        m_lastStats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return;
+    }
+    
+    unsigned int threads = threadsFor(static_cast<std::size_t>(settings.rayCount));
+    if (threads <= 1) {
+        segments.reserve(static_cast<std::size_t>(settings.rayCount) * (settings.reflections ? 2 : 1));
+        traceRange(scene, settings, 0, settings.rayCount, segments, m_lastStats);
+        m_lastStats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        return;
+    }
+    
+    // Each thread traces a contiguous block of primary rays into its own
+    // buffer; concatenating the buffers in order reproduces the serial output
+    m_threadSegments.resize(threads);
+    m_threadStats.assign(threads, TraceStats());
+    auto rangeBegin = [&](unsigned int t) {
+        return static_cast<int>(static_cast<long long>(settings.rayCount) * t / threads);
+    };
+    runParallel(threads, [&](unsigned int t) {
+        m_threadSegments[t].clear();
+        traceRange(scene, settings, rangeBegin(t), rangeBegin(t + 1), m_threadSegments[t], m_threadStats[t]);
+    });
+    
+    std::size_t total = 0;
+    for (const auto& part : m_threadSegments) {
+        total += part.size();
+    }
+    segments.reserve(total);
+    for (unsigned int t = 0; t < threads; ++t) {
+        segments.insert(segments.end(), m_threadSegments[t].begin(), m_threadSegments[t].end());
+        m_lastStats.add(m_threadStats[t]);
+    }
+    m_lastStats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Tracer::traceRange(const TraceScene& scene, const TraceSettings& settings, int firstRay, int lastRay,
+                        std::vector<TraceSegment>& segments, TraceStats& stats) const {
+    PROFILE_SCOPE("Trace range");
+    stats.primaryRays += static_cast<uint64_t>(lastRay - firstRay);
+    
+    // Rays of the current primary ray's tree in the order they were spawned;
+    // walking it front to back traces the tree breadth first
+    std::vector<PendingRay> pending;
+    for (int i = firstRay; i < lastRay; ++i) {
+        pending.assign(1, PendingRay{primaryRay(scene, settings, i), i, 0, Spectrum()});
+        for (std::size_t next = 0; next < pending.size(); ++next) {
+            const PendingRay ray = pending[next];  // Copied, traceRay may grow pending
+            traceRay(scene, settings, ray, segments, pending, stats);
+        }
+    }
+}
+
+void Tracer::traceBudgeted(const TraceScene& scene, const TraceSettings& settings,
+                           std::vector<TraceSegment>& segments) const {
+    PROFILE_SCOPE("Trace budgeted");
+    const std::size_t rayCount = static_cast<std::size_t>(settings.rayCount);
+    m_lastStats.primaryRays = rayCount;
+    segments.reserve(rayCount * (settings.reflections ? 2 : 1));
+    m_branches.clear();
+    m_bands.resize(ENERGY_BANDS);
+    for (auto& band : m_bands) {
+        band.clear();
+    }
+    
+    // The first wave holds the primary rays, which are always traced
+    m_wave.clear();
+    for (int i = 0; i < settings.rayCount; ++i) {
+        m_wave.push_back(PendingRay{primaryRay(scene, settings, i), i, 0, Spectrum()});
+    }
+    uint64_t remaining = settings.maxSegments > rayCount ? settings.maxSegments - rayCount : 0;
+    while (true) {
+        traceWave(scene, settings, segments);
+        
+        auto band = std::find_if(m_bands.begin(), m_bands.end(),
+                                 [](const std::vector<PendingRay>& rays) { return !rays.empty(); });
+        if (band == m_bands.end() || remaining == 0) break;
+        m_wave.swap(*band);
+        band->clear();
+        if (m_wave.size() > remaining) {
+            std::nth_element(m_wave.begin(), m_wave.begin() + static_cast<std::ptrdiff_t>(remaining), m_wave.end(),
+                             HigherPriority());
+            m_lastStats.budgetLimited += m_wave.size() - remaining;
+            m_wave.resize(static_cast<std::size_t>(remaining));
+        }
+        remaining -= m_wave.size();
+    }
+    for (const auto& band : m_bands) {
+        m_lastStats.budgetLimited += band.size();
+    }
+    
+    // Back to the unbudgeted order: grouped by primary ray (counting sort),
+    // then by depth and branch within each group
+    m_rayStart.assign(rayCount + 1, 0);
+    for (const TraceSegment& segment : segments) {
+        ++m_rayStart[static_cast<std::size_t>(segment.ray) + 1];
+    }
+    for (std::size_t r = 0; r < rayCount; ++r) {
+        m_rayStart[r + 1] += m_rayStart[r];
+    }
+    m_order.resize(segments.size());
+    for (std::size_t k = 0; k < segments.size(); ++k) {
+        m_order[m_rayStart[static_cast<std::size_t>(segments[k].ray)]++] = k;
+    }
+    // m_rayStart[r] now holds the end of group r
+    std::size_t groupBegin = 0;
+    for (std::size_t r = 0; r < rayCount; ++r) {
+        std::sort(m_order.begin() + static_cast<std::ptrdiff_t>(groupBegin),
+                  m_order.begin() + static_cast<std::ptrdiff_t>(m_rayStart[r]), [&](std::size_t a, std::size_t b) {
+            if (segments[a].depth != segments[b].depth) return segments[a].depth < segments[b].depth;
+            return m_branches[a] < m_branches[b];
+        });
+        groupBegin = m_rayStart[r];
+    }
+    m_sorted.resize(segments.size());
+    for (std::size_t k = 0; k < segments.size(); ++k) {
+        m_sorted[k] = segments[m_order[k]];
+    }
+    segments.swap(m_sorted);
+}
+
+void Tracer::traceWave(const TraceScene& scene, const TraceSettings& settings,
+                       std::vector<TraceSegment>& segments) const {
+    unsigned int threads = threadsFor(m_wave.size());
+    m_threadSegments.resize(threads);
+    m_threadSpawned.resize(threads);
+    m_threadBranches.resize(threads);
+    m_threadStats.assign(threads, TraceStats());
+    runParallel(threads, [&](unsigned int t) {
+        std::size_t begin = m_wave.size() * t / threads;
+        std::size_t end = m_wave.size() * (t + 1) / threads;
+        m_threadSegments[t].clear();
+        m_threadSpawned[t].clear();
+        m_threadBranches[t].clear();
+        for (std::size_t k = begin; k < end; ++k) {
+            traceRay(scene, settings, m_wave[k], m_threadSegments[t], m_threadSpawned[t], m_threadStats[t]);
+            m_threadBranches[t].push_back(m_wave[k].branch);
+        }
+    });
+    
+    for (unsigned int t = 0; t < threads; ++t) {
+        segments.insert(segments.end(), m_threadSegments[t].begin(), m_threadSegments[t].end());
+        m_branches.insert(m_branches.end(), m_threadBranches[t].begin(), m_threadBranches[t].end());
+        for (const PendingRay& spawned : m_threadSpawned[t]) {
+            m_bands[static_cast<std::size_t>(energyBand(spawned.ray.energy, ENERGY_BANDS))].push_back(spawned);
+        }
+        m_lastStats.add(m_threadStats[t]);
+    }
+}
+
+void Tracer::traceRay(const TraceScene& scene, const TraceSettings& settings, const PendingRay& pending,
+                      std::vector<TraceSegment>& segments, std::vector<PendingRay>& spawned, TraceStats& stats) const {
+    const Ray& ray = pending.ray;
+    float hitDist;
+    int32_t hitId;
+    bool hit = findNearestHit(ray, scene, hitDist, hitId, stats.intersectionTests);
+    
+    glm::vec2 endPoint = ray.origin + ray.direction * hitDist;
+    float attenuation = attenuate(settings, 1.0f, hitDist);
+    glm::vec3 color = ray.color * ray.energy;
+    if (settings.dispersion > 0.0f) {
+        color *= pending.spectrum.tint();
+    }
+    segments.push_back({ray.origin, endPoint, color, attenuation, pending.primary, ray.reflectionCount, hitId});
+    
+    ++stats.raysTraced;
+    ++stats.segments;
+    ++stats.segmentsByDepth[std::min(ray.reflectionCount, TraceStats::DEPTH_BUCKETS - 1)];
+    
+    if (!hit) {
+        ++stats.misses;
+        return;
+    }
+    if (!settings.reflections || ray.reflectionCount >= settings.maxReflections) {
+        ++stats.depthLimited;
+        return;
+    }
+    spawnRays(scene, settings, pending, hitId, hitDist, spawned, stats);
+}
+
+void Tracer::spawnRays(const TraceScene& scene, const TraceSettings& settings, const PendingRay& parent,
+                       int32_t hitId, float hitDist, std::vector<PendingRay>& spawned, TraceStats& stats) {
+    const Ray& ray = parent.ray;
+    glm::vec2 hitPoint = ray.origin + ray.direction * hitDist;
+    int depth = ray.reflectionCount + 1;
+    uint64_t reflectedBranch = parent.branch * (settings.dispersion > 0.0f ? SPECTRAL_BRANCHES : 2);
+    float incidentEnergy = attenuate(settings, ray.energy, hitDist);
+    
+    std::size_t index;
+    TraceHitKind kind = classifyHit(scene, hitId, index);
+    float ior = kind == TraceHitKind::Obstacle && scene.obstacleIor ? scene.obstacleIor[index] : ObstacleStore::OPAQUE;
+    if (ior <= 0.0f) {
+        float surfaceReflectance = scene.occluderReflectance;
+        if (kind == TraceHitKind::MainObject) {
+            surfaceReflectance = scene.mainReflectance;
+        } else if (kind == TraceHitKind::Obstacle) {
+            surfaceReflectance = scene.obstacleColors ? reflectance(scene.obstacleColors[index]) : 1.0f;
+        }
+        
+        Ray reflected = ray;
+        reflected.direction = ray.calculateReflection(hitNormal(scene, hitId, hitPoint));
+        reflected.origin = hitPoint;
+        reflected.isReflected = true;
+        reflected.reflectionCount = depth;
+        reflected.length = reflectionLength(settings, depth);
+        reflected.energy = incidentEnergy * surfaceReflectance;
+        if (keepSpawnedRay(settings, parent.primary, depth, reflectedBranch, reflected.energy, stats)) {
+            limitToEnergy(settings, reflected);
+            spawned.push_back(PendingRay{reflected, parent.primary, reflectedBranch, parent.spectrum});
+        }
+        return;
+    }
+    
+    // Leaving the obstacle goes back to air; overlapping refractive
+    // obstacles are not nested, entering one leaves the previous medium
+    ++stats.refractions;
+    bool exiting = ray.medium == hitId;
+    float outsideIor = ray.medium > TRACE_MAIN_OBJECT && !exiting
+        ? scene.obstacleIor[static_cast<std::size_t>(ray.medium - 1)] : 1.0f;
+    float n1 = exiting ? ior : outsideIor;
+    float n2 = exiting ? 1.0f : ior;
+    glm::vec2 normal = hitNormal(scene, hitId, hitPoint);
+    if (glm::dot(normal, ray.direction) > 0.0f) {
+        normal = -normal;
+    }
+    
+    if (settings.dispersion > 0.0f) {
+        // Air does not disperse
+        auto binIors = [&](float n, float* bins) {
+            for (int k = 0; k < Spectrum::BINS; ++k) {
+                bins[k] = n == 1.0f ? n : Spectrum::ior(n, settings.dispersion, k);
+            }
+        };
+        alignas(16) float n1Bins[Spectrum::BINS];
+        alignas(16) float n2Bins[Spectrum::BINS];
+        binIors(n1, n1Bins);
+        binIors(n2, n2Bins);
+        spawnDispersed(scene, settings, parent, hitId, hitDist, normal, n1Bins, n2Bins, spawned, stats);
+        return;
+    }
+    
+    glm::vec2 transmittedDirection;
+    float fresnel = ray.calculateRefraction(normal, n1, n2, transmittedDirection);
+    
+    Ray reflected = ray;
+    reflected.direction = ray.calculateReflection(normal);
+    reflected.origin = hitPoint + reflected.direction * Ray::REFRACTION_OFFSET;
+    reflected.isReflected = true;
+    reflected.reflectionCount = depth;
+    // Internal reflections stay inside the obstacle and, like transmitted
+    // light, keep the rest of the incoming ray's length
+    reflected.length = exiting ? ray.length - hitDist : reflectionLength(settings, depth);
+    reflected.energy = incidentEnergy * fresnel;
+    if (keepSpawnedRay(settings, parent.primary, depth, reflectedBranch, reflected.energy, stats)) {
+        limitToEnergy(settings, reflected);
+        spawned.push_back(PendingRay{reflected, parent.primary, reflectedBranch, Spectrum()});
+    }
+    
+    // Total internal reflection transmits nothing
+    if (fresnel >= 1.0f) return;
+    
+    Ray transmitted = ray;
+    transmitted.direction = transmittedDirection;
+    transmitted.origin = hitPoint + transmittedDirection * Ray::REFRACTION_OFFSET;
+    transmitted.reflectionCount = depth;
+    transmitted.length = ray.length - hitDist;
+    transmitted.energy = incidentEnergy * (1.0f - fresnel);
+    transmitted.medium = exiting ? TRACE_NO_HIT : hitId;
+    if (keepSpawnedRay(settings, parent.primary, depth, reflectedBranch + 1, transmitted.energy, stats)) {
+        limitToEnergy(settings, transmitted);
+        spawned.push_back(PendingRay{transmitted, parent.primary, reflectedBranch + 1, Spectrum()});
+    }
+}
+
+void Tracer::spawnDispersed(const TraceScene& scene, const TraceSettings& settings, const PendingRay& parent,
+                            int32_t hitId, float hitDist, glm::vec2 normal, const float* n1, const float* n2,
+                            std::vector<PendingRay>& spawned, TraceStats& stats) {
+    const Ray& ray = parent.ray;
+    glm::vec2 hitPoint = ray.origin + ray.direction * hitDist;
+    int depth = ray.reflectionCount + 1;
+    uint64_t reflectedBranch = parent.branch * SPECTRAL_BRANCHES;
+    float incidentEnergy = attenuate(settings, ray.energy, hitDist);
+    bool exiting = ray.medium == hitId;
+    float remaining = ray.length - hitDist;
+    
+    float cosIncident = std::min(-glm::dot(ray.direction, normal), 1.0f);
+    alignas(16) float eta[Spectrum::BINS];
+    alignas(16) float cosTransmitted[Spectrum::BINS];
+    alignas(16) float fresnel[Spectrum::BINS];
+    refractBins(cosIncident, n1, n2, eta, cosTransmitted, fresnel);
+    
+    // Reflection sends every bin the same way, so it stays one ray
+    PendingRay reflected{ray, parent.primary, reflectedBranch, parent.spectrum};
+    for (int k = 0; k < Spectrum::BINS; ++k) {
+        reflected.spectrum.bin[k] *= fresnel[k];
+    }
+    float reflectedMean = reflected.spectrum.mean();
+    reflected.ray.direction = ray.calculateReflection(normal);
+    reflected.ray.origin = hitPoint + reflected.ray.direction * Ray::REFRACTION_OFFSET;
+    reflected.ray.isReflected = true;
+    reflected.ray.reflectionCount = depth;
+    reflected.ray.length = exiting ? remaining : reflectionLength(settings, depth);
+    reflected.ray.energy = incidentEnergy * reflectedMean;
+    if (keepSpawnedRay(settings, parent.primary, depth, reflectedBranch, reflected.ray.energy, stats) &&
+        reflectedMean > 0.0f) {
+        for (float& bin : reflected.spectrum.bin) {
+            bin /= reflectedMean;
+        }
+        limitToEnergy(settings, reflected.ray);
+        spawned.push_back(reflected);
+    }
+    
+    // Transmitted bins in order of wavelength, which is also the order of
+    // their directions. Consecutive bins share a ray unless their paths end
+    // more than DISPERSION_TOLERANCE apart: light entering the obstacle
+    // crosses at most its diameter before leaving, light leaving it may
+    // travel the rest of the ray's length.
+    float pathLength = remaining;
+    if (!exiting) {
+        pathLength = std::min(pathLength, 2.0f * scene.obstacles.radius[static_cast<std::size_t>(hitId - 1)]);
+    }
+    glm::vec2 directions[Spectrum::BINS];
+    int groups = 0;
+    auto emitGroup = [&](int first, int last) {
+        PendingRay transmitted{ray, parent.primary, reflectedBranch + 1 + static_cast<uint64_t>(first), Spectrum()};
+        for (int k = 0; k < Spectrum::BINS; ++k) {
+            bool inGroup = k >= first && k <= last && fresnel[k] < 1.0f;
+            transmitted.spectrum.bin[k] = inGroup ? parent.spectrum.bin[k] * (1.0f - fresnel[k]) : 0.0f;
+        }
+        float transmittedMean = transmitted.spectrum.mean();
+        glm::vec2 direction = first == last ? directions[first] : glm::normalize(directions[first] + directions[last]);
+        transmitted.ray.direction = direction;
+        transmitted.ray.origin = hitPoint + direction * Ray::REFRACTION_OFFSET;
+        transmitted.ray.reflectionCount = depth;
+        transmitted.ray.length = remaining;
+        transmitted.ray.energy = incidentEnergy * transmittedMean;
+        transmitted.ray.medium = exiting ? TRACE_NO_HIT : hitId;
+        if (groups++ > 0) {
+            ++stats.dispersionSplits;
+        }
+        if (keepSpawnedRay(settings, parent.primary, depth, transmitted.branch, transmitted.ray.energy, stats) &&
+            transmittedMean > 0.0f) {
+            for (float& bin : transmitted.spectrum.bin) {
+                bin /= transmittedMean;
+            }
+            limitToEnergy(settings, transmitted.ray);
+            spawned.push_back(transmitted);
+        }
+    };
+    
+    int first = -1;
+    int last = -1;
+    for (int k = 0; k < Spectrum::BINS; ++k) {
+        // Bins already split off into other rays, or totally reflected
+        if (parent.spectrum.bin[k] <= 0.0f || fresnel[k] >= 1.0f) continue;
+        directions[k] = eta[k] * ray.direction + (eta[k] * cosIncident - cosTransmitted[k]) * normal;
+        if (first >= 0 && glm::length(directions[k] - directions[first]) * pathLength > DISPERSION_TOLERANCE) {
+            emitGroup(first, last);
+            first = -1;
+        }
+        if (first < 0) {
+            first = k;
+        }
+        last = k;
+    }
+    if (first >= 0) {
+        emitGroup(first, last);
+    }
+}
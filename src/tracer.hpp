@@ -0,0 +1,255 @@
+#pragma once
+#include "ray.hpp"
+#include "spectrum.hpp"
+#include "obstacle_store.hpp"
+#include "occluder_store.hpp"
+#include "trace_grid.hpp"
+#include "worker_pool.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Hit ids reported in TraceSegment::hitId. Obstacle i is reported as i + 1,
+// matching the circle order of the GPU circle buffer (main object first).
+// Occluders follow the obstacles: segments, then polygon edges, then arcs
+// (see Tracer::classifyHit).
+constexpr int32_t TRACE_NO_HIT = -1;
+constexpr int32_t TRACE_MAIN_OBJECT = 0;
+
+// Kind of primitive a hit id refers to
+enum class TraceHitKind { None, MainObject, Obstacle, Segment, PolygonEdge, Arc };
+
+// Geometry the rays are traced against
+struct TraceScene {
+    glm::vec2 lightOrigin{0.0f};
+    glm::vec2 mainPosition{0.0f};
+    float mainRadius{0.0f};
+    CircleView obstacles;
+    const float* obstacleIor = nullptr;  // Per obstacle (ObstacleStore::iors); nullptr if all are opaque
+    // Per obstacle (ObstacleStore::colors); opaque obstacles reflect the
+    // luminance of their color. nullptr reflects all light.
+    const glm::vec3* obstacleColors = nullptr;
+    OccluderView occluders;
+    // Fraction of the energy reflected by the main object (usually the
+    // luminance of its color) and by the walls, which are light gray
+    float mainReflectance{1.0f};
+    float occluderReflectance{0.8f};
+};
+
+struct TraceSettings {
+    // Number of primary rays emitted evenly around the light
+    int rayCount = 90;
+    
+    bool reflections = true;
+    // Deepest bounce, counting reflections and refractions alike
+    int maxReflections = Ray::MAX_REFLECTIONS;
+    
+    // Rays end where their energy falls below this: reflected and
+    // transmitted rays are dropped, and every ray is cut off at the
+    // distance where attenuation takes it there
+    float minEnergy = 0.01f;
+    
+    // Distance over which a ray loses all but 1/e of its energy; 0 turns
+    // distance attenuation off. Hits lose energy to the material's
+    // reflectance, or split it by the Fresnel equations for glass.
+    float attenuationLength = 1000.0f;
+    
+    // Dispersion of refractive obstacles, as the Cauchy B coefficient in
+    // square micrometres (crown glass is about 0.004); 0 turns it off.
+    // With dispersion each ray carries Spectrum::BINS wavelength bins, each
+    // refracted with its own index, and a transmitted ray only splits into
+    // several where the bins' paths diverge.
+    float dispersion = 0.0f;
+    
+    // Spawned rays below this energy play Russian roulette: they survive
+    // with probability energy / rouletteEnergy and then carry
+    // rouletteEnergy, so the expected energy is unchanged. 0 disables it.
+    float rouletteEnergy = 0.1f;
+    
+    // Most segments one trace call emits, 0 for no limit. Primary rays are
+    // always traced; the rest of the budget goes to the spawned rays in
+    // order of energy (see Tracer::trace).
+    uint64_t maxSegments = 0;
+    
+    // Maximum length of rays (how far they can travel)
+    // Increase for larger scenes, decrease for better performance
+    float maxRayLength = 2000.0f;
+    
+    // How much length is preserved after reflection; each further
+    // reflection is shortened by another factor of 0.7
+    float reflectionLengthFactor = 0.05f;
+    
+    glm::vec3 primaryColor{0.9f};
+};
+
+// One traced line segment, from the ray origin to its hit point (or full length)
+struct TraceSegment {
+    glm::vec2 origin;
+    glm::vec2 end;
+    glm::vec3 color;    // Ray color scaled by the energy at the origin
+    float attenuation;  // Fraction of that energy left at the end
+    int32_t ray;    // Index of the primary ray this segment descends from
+    int32_t depth;  // 0 for primary rays, n after n reflections or refractions
+    int32_t hitId;  // TRACE_NO_HIT, TRACE_MAIN_OBJECT or primitive index + 1 (see Tracer::classifyHit)
+};
+
+// Work done by one Tracer::trace call
+struct TraceStats {
+    static constexpr int DEPTH_BUCKETS = Ray::MAX_REFLECTIONS + 1;  // Deeper segments go to the last bucket
+    
+    uint64_t primaryRays = 0;
+    uint64_t raysTraced = 0;          // Nearest-hit queries: primary, reflected and transmitted rays
+    uint64_t intersectionTests = 0;   // Ray-primitive tests, main object included
+    uint64_t segments = 0;
+    uint64_t segmentsByDepth[DEPTH_BUCKETS] = {};
+    uint64_t misses = 0;              // Chains that ended without a hit
+    uint64_t depthLimited = 0;        // Chains cut off by maxReflections or disabled reflections
+    uint64_t refractions = 0;         // Hits on refractive obstacles, each splitting the ray
+    uint64_t dispersionSplits = 0;    // Extra transmitted rays where wavelength bins diverged
+    uint64_t energyCulled = 0;        // Reflected or transmitted rays dropped below minEnergy
+    uint64_t rouletteKilled = 0;      // Spawned rays that lost the Russian roulette
+    uint64_t budgetLimited = 0;       // Spawned rays left untraced by maxSegments
+    double traceMs = 0.0;             // Wall time of the trace call
+    double buildMs = 0.0;             // Grid kernel: rebuilding the grid, part of traceMs
+    
+    double testsPerRay() const { return raysTraced ? double(intersectionTests) / raysTraced : 0.0; }
+    double raysPerSecond() const { return traceMs > 0.0 ? raysTraced / (traceMs / 1000.0) : 0.0; }
+    
+    void add(const TraceStats& other);
+};
+
+// Inner loop used to find the nearest obstacle along a ray
+enum class TraceKernel {
+    Scalar,  // One primitive per step (reference)
+    Simd,    // Four primitives per step with SSE2; scalar where SSE2 is unavailable
+    Grid     // Walks a TraceGrid rebuilt for every trace; for large or moving scenes
+};
+
+// CPU tracer. The scalar single-threaded configuration is the reference the
+// other backends (SIMD, threaded, GPU) are validated against; all of them
+// produce the same segments in the same order.
+class Tracer {
+public:
+    // threadCount > 1 splits the primary rays into contiguous ranges traced
+    // in parallel; 0 uses all hardware threads. The worker threads are
+    // started here and reused by every trace. A Tracer keeps per-thread
+    // scratch buffers, so one instance must not trace concurrently.
+    explicit Tracer(TraceKernel kernel = TraceKernel::Scalar, unsigned int threadCount = 1);
+    
+    TraceKernel getKernel() const { return m_kernel; }
+    void setKernel(TraceKernel kernel) { m_kernel = kernel; }
+    unsigned int getThreadCount() const { return m_threadCount; }
+    
+    // True if TraceKernel::Simd uses vector instructions in this build
+    static bool isSimdAvailable();
+    
+    // Traces all primary rays and the rays they spawn: a mirror reflection
+    // off opaque primitives, a Fresnel-weighted reflection and Snell's law
+    // transmission off refractive obstacles. The segments of one primary
+    // ray are emitted consecutively, breadth first, so depth never
+    // decreases within them.
+    //
+    // With a segment budget the spawned rays are traced in waves: each wave
+    // is the band of pending rays with the highest energy (bands are a
+    // factor of two wide), traced in parallel. The wave that does not fit
+    // is cut to its highest-energy rays. Which rays are traced only depends
+    // on the scene and the settings, never on the kernel or thread count,
+    // and a budget that is not reached gives the same output as none.
+    void trace(const TraceScene& scene, const TraceSettings& settings,
+               std::vector<TraceSegment>& segments) const;
+    
+    // Counters of the last trace call
+    const TraceStats& getLastStats() const { return m_lastStats; }
+    
+    // Primary ray direction for ray index i out of count
+    static glm::vec2 primaryDirection(int i, int count);
+    
+    // Length of a ray after its n-th reflection (n >= 1)
+    static float reflectionLength(const TraceSettings& settings, int reflectionCount);
+    
+    // Energy left after travelling a distance (see attenuationLength)
+    static float attenuate(const TraceSettings& settings, float energy, float distance);
+    // Reflectance of an opaque material of the given color: its luminance
+    static float reflectance(const glm::vec3& color);
+    
+    // Kind of primitive a hit id refers to, and its index among the
+    // primitives of that kind (polygon edges are counted across polygons)
+    static TraceHitKind classifyHit(const TraceScene& scene, int32_t hitId, std::size_t& index);
+    
+    // Unit normal at a hit point on the primitive identified by a hit id.
+    // Circles and arcs point away from the center; segment normals may face
+    // either side, which gives the same reflection.
+    static glm::vec2 hitNormal(const TraceScene& scene, int32_t hitId, const glm::vec2& point);
+
+private:
+    // Fewer rays than this per thread are traced on the calling thread only
+    static constexpr int MIN_RAYS_PER_THREAD = 256;
+    // Energy bands of the budgeted trace: band b holds energies in
+    // [2^-(b+1), 2^-b), the last band everything below
+    static constexpr int ENERGY_BANDS = 24;
+    // Dispersion mode: wavelength bins stay in one transmitted ray while
+    // their paths end less than this far apart (about a line width)
+    static constexpr float DISPERSION_TOLERANCE = 1.0f;
+    // Dispersion mode: children per ray in the branch numbering, the
+    // reflection and up to one transmitted ray per bin
+    static constexpr uint64_t SPECTRAL_BRANCHES = Spectrum::BINS + 1;
+    
+    // A ray waiting to be traced. branch numbers the rays of one depth in a
+    // primary ray's tree (parent * 2, plus 1 for transmitted rays; parent *
+    // SPECTRAL_BRANCHES, plus 1 + first bin with dispersion), which orders
+    // them breadth first and seeds their Russian roulette.
+    struct PendingRay {
+        Ray ray;
+        int32_t primary;
+        uint64_t branch;
+        Spectrum spectrum;  // Dispersion mode only
+    };
+    
+    TraceKernel m_kernel;
+    unsigned int m_threadCount;
+    mutable std::vector<std::vector<TraceSegment>> m_threadSegments;
+    mutable std::vector<TraceStats> m_threadStats;
+    mutable TraceStats m_lastStats;
+    mutable TraceGrid m_grid;  // Grid kernel only
+    std::unique_ptr<WorkerPool> m_pool;  // threadCount - 1 workers, none if single-threaded
+    
+    // Budgeted trace scratch, reused between calls
+    mutable std::vector<PendingRay> m_wave;
+    mutable std::vector<std::vector<PendingRay>> m_bands;
+    mutable std::vector<std::vector<PendingRay>> m_threadSpawned;
+    mutable std::vector<std::vector<uint64_t>> m_threadBranches;
+    mutable std::vector<uint64_t> m_branches;  // Branch of each emitted segment
+    mutable std::vector<std::size_t> m_rayStart;
+    mutable std::vector<std::size_t> m_order;
+    mutable std::vector<TraceSegment> m_sorted;
+    
+    static Ray primaryRay(const TraceScene& scene, const TraceSettings& settings, int i);
+    unsigned int threadsFor(std::size_t rays) const;
+    // Runs work(t) for t in [0, threads), t = 0 on the calling thread
+    void runParallel(unsigned int threads, const std::function<void(unsigned int)>& work) const;
+    
+    void traceRange(const TraceScene& scene, const TraceSettings& settings, int firstRay, int lastRay,
+                    std::vector<TraceSegment>& segments, TraceStats& stats) const;
+    void traceBudgeted(const TraceScene& scene, const TraceSettings& settings,
+                       std::vector<TraceSegment>& segments) const;
+    // Traces m_wave; segments are appended in wave order and spawned rays
+    // sorted into m_bands
+    void traceWave(const TraceScene& scene, const TraceSettings& settings, std::vector<TraceSegment>& segments) const;
+    // Emits the segment of one ray and queues the rays it spawns
+    void traceRay(const TraceScene& scene, const TraceSettings& settings, const PendingRay& pending,
+                  std::vector<TraceSegment>& segments, std::vector<PendingRay>& spawned, TraceStats& stats) const;
+    // Queues the rays spawned at a hit point; reflections only unless the
+    // hit obstacle is refractive
+    static void spawnRays(const TraceScene& scene, const TraceSettings& settings, const PendingRay& parent,
+                          int32_t hitId, float hitDist, std::vector<PendingRay>& spawned, TraceStats& stats);
+    // spawnRays for a refractive hit in dispersion mode: the Fresnel terms
+    // of all bins are computed at once, and bins whose transmitted paths
+    // diverge go into separate rays
+    static void spawnDispersed(const TraceScene& scene, const TraceSettings& settings, const PendingRay& parent,
+                               int32_t hitId, float hitDist, glm::vec2 normal, const float* n1, const float* n2,
+                               std::vector<PendingRay>& spawned, TraceStats& stats);
+    bool findNearestHit(const Ray& ray, const TraceScene& scene, float& hitDist, int32_t& hitId,
+                        uint64_t& tests) const;
+};
@@ -66,6 +66,10 @@ Window::Window(int width, int height, const std::string& title)
     glViewport(0, 0, fbWidth, fbHeight);
 }
 
+void Window::setSwapInterval(int interval) {
+    glfwSwapInterval(interval);
+}
+
 Window::~Window() {
     if (m_window) {
         glfwDestroyWindow(m_window);
@@ -17,6 +17,9 @@ public:
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
 
+    // 1 waits for vblank on swap, 0 presents immediately
+    void setSwapInterval(int interval);
+
     void toggleBorderlessFullscreen();
     bool isBorderlessFullscreen() const { return m_isBorderlessFullscreen; }
 
@@ -0,0 +1,71 @@
+#include "worker_pool.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int workerCount, const char* name)
+    : m_name(name) {
+    m_workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back(&WorkerPool::workerLoop, this, i + 1);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(unsigned int threads, const std::function<void(unsigned int)>& work) {
+    threads = std::min(threads, getThreadCount());
+    if (threads <= 1) {
+        work(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_work = &work;
+        m_jobThreads = threads;
+        m_pending = threads - 1;
+        ++m_job;
+    }
+    m_wake.notify_all();
+    work(0);
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_pending == 0; });
+    m_work = nullptr;
+}
+
+void WorkerPool::workerLoop(unsigned int index) {
+    uint64_t lastJob = 0;
+    bool named = false;
+    while (true) {
+        const std::function<void(unsigned int)>* work;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Jobs that need fewer threads leave this worker asleep
+            m_wake.wait(lock, [&]() { return m_stopping || (m_job != lastJob && index < m_jobThreads); });
+            if (m_stopping) return;
+            lastJob = m_job;
+            work = m_work;
+        }
+        
+        // Registered on first use, so an idle pool adds no profiler rows
+        if (!named && Profiler::isEnabled()) {
+            Profiler::setThreadName(m_name);
+            named = true;
+        }
+        (*work)(index);
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pending == 0) {
+            m_done.notify_one();
+        }
+    }
+}
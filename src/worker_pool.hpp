@@ -0,0 +1,42 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run one parallel job at a time. run()
+// wakes the workers a job needs, runs its own share on the calling thread
+// and returns once every share is done, so short jobs (one per trace wave)
+// cost a wake-up rather than a thread creation each.
+class WorkerPool {
+public:
+    // Starts workerCount threads, named name in the profiler
+    WorkerPool(unsigned int workerCount, const char* name);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    // Workers plus the calling thread
+    unsigned int getThreadCount() const { return static_cast<unsigned int>(m_workers.size()) + 1; }
+    
+    // Runs work(t) for t in [0, threads), t = 0 on the calling thread.
+    // threads is capped at getThreadCount(). One caller at a time.
+    void run(unsigned int threads, const std::function<void(unsigned int)>& work);
+
+private:
+    const char* m_name;
+    std::vector<std::thread> m_workers;
+    
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(unsigned int)>* m_work = nullptr;
+    unsigned int m_jobThreads = 0;  // Threads of the current job
+    unsigned int m_pending = 0;     // Workers still running their share
+    uint64_t m_job = 0;             // Incremented per job
+    bool m_stopping = false;
+    
+    void workerLoop(unsigned int index);
+};